@@ -0,0 +1,44 @@
+#pragma once
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#ifdef _MSC_VER
+#include <malloc.h>
+#endif
+
+namespace s3d
+{
+
+//cache line size, also wide enough for any SIMD store we issue
+const size_t kSurfaceAlignment = 64;
+
+//throws std::bad_alloc
+inline void* alignedAlloc(size_t size, size_t alignment = kSurfaceAlignment) {
+  void* p = NULL;
+#ifdef _MSC_VER
+  p = _aligned_malloc(size, alignment);
+#else
+  if (posix_memalign(&p, alignment, size) != 0)
+    p = NULL;
+#endif
+  if (p == NULL)
+    throw std::bad_alloc();
+
+  return p;
+}
+
+inline void alignedFree(void* p) {
+#ifdef _MSC_VER
+  _aligned_free(p);
+#else
+  free(p);
+#endif
+}
+
+//round n up to a multiple of m (m is a power of two)
+inline size_t alignUp(size_t n, size_t m) {
+  return (n + m - 1) & ~(m - 1);
+}
+
+}// namespace s3d
@@ -0,0 +1,289 @@
+#include "BinnedRenderer.h"
+#include "DepthBuffer.h"
+#include "FrameTiles.h"
+#include "PixelFormat.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+namespace s3d
+{
+
+static_assert(kBinTileSize == kFrameTileSize, "a frame tile has to belong to one bin");
+
+namespace
+{
+
+//pixel range a primitive can touch along x (y with useY), one pixel of slack
+//for the span filler that out of range ones fall back to. false when it
+//misses [0, size)
+bool pixelRange(const Point3<double>* points, int count, bool useY, int size, int& first, int& last) {
+  double lo = useY ? points[0].y_ : points[0].x_;
+  double hi = lo;
+  for (int i = 1; i < count; ++i) {
+    const double v = useY ? points[i].y_ : points[i].x_;
+    lo = min(lo, v);
+    hi = max(hi, v);
+  }
+  lo = ::floor(lo) - 1.;
+  hi = ::ceil(hi) + 1.;
+  if (!(lo < size) || !(hi >= 0.))
+    return false;
+
+  first = lo < 0. ? 0 : static_cast<int>(lo);
+  last = hi >= size ? size - 1 : static_cast<int>(hi);
+  return true;
+}
+
+}
+
+BinnedRenderer::BinnedRenderer(const RendererBuffer& buffer, int threads)
+  : buffer_(buffer), depth_(NULL), frameTiles_(NULL), pixelTarget_(NULL), blendMode_(kBlendReplace), generation_(0), busyWorkers_(0), quit_(false) {
+  tileColumns_ = (buffer.getWidth() + kBinTileSize - 1) / kBinTileSize;
+  tileRows_ = (buffer.getHeight() + kBinTileSize - 1) / kBinTileSize;
+  bins_.resize(tileColumns_ * tileRows_);
+  nextTile_.store(0);
+
+  if (threads <= 0)
+    threads = max(1U, thread::hardware_concurrency());
+
+  for (int i = 1; i < threads; ++i) {
+    workers_.push_back(thread(&BinnedRenderer::workerLoop, this));
+  }
+}
+
+BinnedRenderer::~BinnedRenderer() {
+  {
+    lock_guard<mutex> lock(mutex_);
+    quit_ = true;
+  }
+  startCond_.notify_all();
+
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+}
+
+void BinnedRenderer::setDepthBuffer(DepthBuffer* depth) {
+  assert(!depth || (depth->getWidth() == buffer_.getWidth() && depth->getHeight() == buffer_.getHeight()));
+  depth_ = depth;
+}
+
+void BinnedRenderer::setFrameTiles(FrameTiles* tiles) {
+  frameTiles_ = tiles;
+}
+
+void BinnedRenderer::setPixelTarget(PixelBuffer* target) {
+  assert(!target || (target->getWidth() == buffer_.getWidth() && target->getHeight() == buffer_.getHeight()));
+  pixelTarget_ = target;
+}
+
+void BinnedRenderer::fillTriangle3D_Depth(const Point3<double>& p0, const Point3<double>& p1, const Point3<double>& p2, const Color& c) {
+  BinnedPrimitive tri;
+  points_.push_back(p0);
+  points_.push_back(p1);
+  points_.push_back(p2);
+  tri.c_[0] = tri.c_[1] = tri.c_[2] = c;
+  tri.texture_ = NULL;
+  tri.shading_ = kShadeFlat;
+  bin(tri, 3);
+}
+
+void BinnedRenderer::fillTriangle3D_Gouraud(const Point3<double>& p0, const Point3<double>& p1, const Point3<double>& p2,
+                                            const Color& c0, const Color& c1, const Color& c2) {
+  BinnedPrimitive tri;
+  points_.push_back(p0);
+  points_.push_back(p1);
+  points_.push_back(p2);
+  tri.c_[0] = c0;
+  tri.c_[1] = c1;
+  tri.c_[2] = c2;
+  tri.texture_ = NULL;
+  tri.shading_ = kShadeGouraud;
+  bin(tri, 3);
+}
+
+void BinnedRenderer::fillTriangle3D_Textured(const Point3<double>& p0, const Point3<double>& p1, const Point3<double>& p2,
+                                             const Point2<double>& uv0, const Point2<double>& uv1, const Point2<double>& uv2,
+                                             const Texture& texture) {
+  BinnedPrimitive tri;
+  points_.push_back(p0);
+  points_.push_back(p1);
+  points_.push_back(p2);
+  tri.uv_[0] = uv0;
+  tri.uv_[1] = uv1;
+  tri.uv_[2] = uv2;
+  tri.texture_ = &texture;
+  tri.shading_ = kShadeTextured;
+  bin(tri, 3);
+}
+
+void BinnedRenderer::fillConvexPolygon3D_Depth(const Point3<double>* points, int count, const Color& c) {
+  assert(count >= 3 && count <= kMaxConvexEdges);
+  BinnedPrimitive poly;
+  points_.insert(points_.end(), points, points + count);
+  poly.c_[0] = c;
+  poly.texture_ = NULL;
+  poly.shading_ = kShadePolygon;
+  bin(poly, count);
+}
+
+void BinnedRenderer::drawIndexedTriangles(const Point4<double>* vertices, int vertexCount,
+                                          const uint32_t* indices, int triangleCount, const Color* colors) {
+  for (int t = 0; t < triangleCount; ++t, indices += 3) {
+    assert(indices[0] < uint32_t(vertexCount) && indices[1] < uint32_t(vertexCount) && indices[2] < uint32_t(vertexCount));
+    const Point4<double>& v0 = vertices[indices[0]];
+    const Point4<double>& v1 = vertices[indices[1]];
+    const Point4<double>& v2 = vertices[indices[2]];
+    fillTriangle3D_Depth(Point3<double>(v0.x_, v0.y_, v0.z_), Point3<double>(v1.x_, v1.y_, v1.z_),
+                         Point3<double>(v2.x_, v2.y_, v2.z_), colors[t]);
+  }
+}
+
+void BinnedRenderer::drawIndexedPolygons(const Point4<double>* vertices, int vertexCount, const uint32_t* indices,
+                                          const uint8_t* vertexCounts, int polygonCount, const Color* colors) {
+  Point3<double> points[kMaxConvexEdges];
+  for (int k = 0; k < polygonCount; indices += vertexCounts[k], ++k) {
+    const int count = vertexCounts[k];
+    assert(count >= 3 && count <= kMaxConvexEdges);
+    for (int i = 0; i < count; ++i) {
+      assert(indices[i] < uint32_t(vertexCount));
+      const Point4<double>& v = vertices[indices[i]];
+      points[i] = Point3<double>(v.x_, v.y_, v.z_);
+    }
+    fillConvexPolygon3D_Depth(points, count, colors[k]);
+  }
+}
+
+void BinnedRenderer::drawIndexedTrianglesGouraud(const Point4<double>* vertices, const Color* vertexColors, int vertexCount,
+                                                 const uint32_t* indices, int triangleCount) {
+  for (int t = 0; t < triangleCount; ++t, indices += 3) {
+    const uint32_t i0 = indices[0], i1 = indices[1], i2 = indices[2];
+    assert(i0 < uint32_t(vertexCount) && i1 < uint32_t(vertexCount) && i2 < uint32_t(vertexCount));
+    fillTriangle3D_Gouraud(Point3<double>(vertices[i0].x_, vertices[i0].y_, vertices[i0].z_),
+                           Point3<double>(vertices[i1].x_, vertices[i1].y_, vertices[i1].z_),
+                           Point3<double>(vertices[i2].x_, vertices[i2].y_, vertices[i2].z_),
+                           vertexColors[i0], vertexColors[i1], vertexColors[i2]);
+  }
+}
+
+void BinnedRenderer::bin(BinnedPrimitive& prim, int count) {
+  prim.first_ = static_cast<uint32_t>(points_.size() - count);
+  prim.count_ = count;
+  prim.blendMode_ = blendMode_;
+
+  const Point3<double>* points = &points_[prim.first_];
+  int minX, maxX, minY, maxY;
+  if (!pixelRange(points, count, false, buffer_.getWidth(), minX, maxX) ||
+      !pixelRange(points, count, true, buffer_.getHeight(), minY, maxY)) {
+    points_.resize(prim.first_);
+    return;
+  }
+
+  const uint32_t index = static_cast<uint32_t>(primitives_.size());
+  primitives_.push_back(prim);
+
+  for (int ty = minY / kBinTileSize; ty <= maxY / kBinTileSize; ++ty) {
+    for (int tx = minX / kBinTileSize; tx <= maxX / kBinTileSize; ++tx) {
+      bins_[ty * tileColumns_ + tx].push_back(index);
+    }
+  }
+}
+
+void BinnedRenderer::flush() {
+  if (primitives_.empty())
+    return;
+
+  //the tile renderers only read the palette lookup
+  if (pixelTarget_ && pixelTarget_->getFormat() == kPixelFormatIndexed8)
+    pixelTarget_->getPalette().prepareLookup();
+
+  nextTile_.store(0);
+  {
+    lock_guard<mutex> lock(mutex_);
+    ++generation_;
+    busyWorkers_ = static_cast<int>(workers_.size());
+  }
+  startCond_.notify_all();
+
+  rasterizeTiles();
+
+  {
+    unique_lock<mutex> lock(mutex_);
+    doneCond_.wait(lock, [this] { return busyWorkers_ == 0; });
+  }
+
+  primitives_.clear();
+  points_.clear();
+  for (auto& bin : bins_) {
+    bin.clear();
+  }
+}
+
+void BinnedRenderer::workerLoop() {
+  unsigned seen = 0;
+  for (;;) {
+    {
+      unique_lock<mutex> lock(mutex_);
+      startCond_.wait(lock, [this, seen] { return quit_ || generation_ != seen; });
+      if (quit_)
+        return;
+      seen = generation_;
+    }
+
+    rasterizeTiles();
+
+    {
+      lock_guard<mutex> lock(mutex_);
+      if (--busyWorkers_ == 0)
+        doneCond_.notify_one();
+    }
+  }
+}
+
+void BinnedRenderer::rasterizeTiles() {
+  const int tileCount = static_cast<int>(bins_.size());
+  for (;;) {
+    const int tile = nextTile_.fetch_add(1);
+    if (tile >= tileCount)
+      return;
+
+    if (!bins_[tile].empty())
+      rasterizeTile(tile);
+  }
+}
+
+void BinnedRenderer::rasterizeTile(int tile) {
+  const int x0 = (tile % tileColumns_) * kBinTileSize;
+  const int y0 = (tile / tileColumns_) * kBinTileSize;
+
+  Renderer renderer(buffer_);
+  renderer.setDepthBuffer(depth_);
+  renderer.setFrameTiles(frameTiles_);
+  renderer.setPixelTarget(pixelTarget_);
+  renderer.setScissor(RectI(x0, y0, kBinTileSize - 1, kBinTileSize - 1));
+
+  for (uint32_t index : bins_[tile]) {
+    const BinnedPrimitive& tri = primitives_[index];
+    const Point3<double>* p = &points_[tri.first_];
+    renderer.setBlendMode(tri.blendMode_);
+    switch (tri.shading_) {
+    case kShadeFlat:
+      renderer.fillTriangle3D_Depth(p[0], p[1], p[2], tri.c_[0]);
+      break;
+    case kShadePolygon:
+      renderer.fillConvexPolygon3D_Depth(p, tri.count_, tri.c_[0]);
+      break;
+    case kShadeGouraud:
+      renderer.fillTriangle3D_Gouraud(p[0], p[1], p[2], tri.c_[0], tri.c_[1], tri.c_[2]);
+      break;
+    case kShadeTextured:
+      renderer.fillTriangle3D_Textured(p[0], p[1], p[2], tri.uv_[0], tri.uv_[1], tri.uv_[2], *tri.texture_);
+      break;
+    }
+  }
+}
+
+}// namespace s3d
@@ -0,0 +1,136 @@
+#pragma once
+#include "Renderer.h"
+#include "Rasterizer.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <boost/noncopyable.hpp>
+
+namespace s3d
+{
+
+//screen tiles are whole depth tiles / raster blocks, so no block ever
+//straddles two screen tiles
+const int kBinTileSize = 64;
+
+//records triangles and polygons into the screen tiles their bounds touch, flush()
+//then rasterizes whole tiles on a pool of threads. a tile belongs to one thread at
+//a time and replays its primitives in submission order through a Renderer
+//scissored to the tile, so the output is identical to drawing the same
+//primitives serially with a single Renderer.
+class BinnedRenderer : private boost::noncopyable {
+public:
+  //threads counts the calling thread, 0 picks one per hardware thread
+  explicit BinnedRenderer(const RendererBuffer& buffer, int threads = 0);
+  ~BinnedRenderer();
+
+  //optional, not owned, see Renderer::setDepthBuffer
+  void setDepthBuffer(DepthBuffer* depth);
+
+  //optional, not owned, see Renderer::setFrameTiles. frame tiles are screen tiles,
+  //so each one is only touched by the thread drawing it
+  void setFrameTiles(FrameTiles* tiles);
+
+  //optional, not owned, see Renderer::setPixelTarget. the palette of an indexed
+  //target must not change while a flush() runs
+  void setPixelTarget(PixelBuffer* target);
+
+  //applies to the triangles submitted after it, see Renderer::setBlendMode
+  void setBlendMode(BlendMode mode) {
+    blendMode_ = mode;
+  }
+  BlendMode getBlendMode() const {
+    return blendMode_;
+  }
+
+  //same contract as Renderer::fillTriangle3D_Depth, drawn at the next flush()
+  void fillTriangle3D_Depth(const Point3<double>& p0, const Point3<double>& p1, const Point3<double>& p2, const Color& c);
+
+  //same contract as Renderer::fillTriangle3D_Gouraud
+  void fillTriangle3D_Gouraud(const Point3<double>& p0, const Point3<double>& p1, const Point3<double>& p2,
+                              const Color& c0, const Color& c1, const Color& c2);
+
+  //same contract as Renderer::fillTriangle3D_Textured, texture must outlive the next flush()
+  void fillTriangle3D_Textured(const Point3<double>& p0, const Point3<double>& p1, const Point3<double>& p2,
+                               const Point2<double>& uv0, const Point2<double>& uv1, const Point2<double>& uv2,
+                               const Texture& texture);
+
+  //same contract as Renderer::fillConvexPolygon3D_Depth, binned whole so every tile
+  //fills it from the same depth plane
+  void fillConvexPolygon3D_Depth(const Point3<double>* points, int count, const Color& c);
+
+  //same contract as Renderer::drawIndexedTriangles
+  void drawIndexedTriangles(const Point4<double>* vertices, int vertexCount,
+                            const uint32_t* indices, int triangleCount, const Color* colors);
+
+  //same contract as Renderer::drawIndexedPolygons
+  void drawIndexedPolygons(const Point4<double>* vertices, int vertexCount, const uint32_t* indices,
+                           const uint8_t* vertexCounts, int polygonCount, const Color* colors);
+
+  //same contract as Renderer::drawIndexedTrianglesGouraud
+  void drawIndexedTrianglesGouraud(const Point4<double>* vertices, const Color* vertexColors, int vertexCount,
+                                   const uint32_t* indices, int triangleCount);
+
+  //rasterizes everything recorded so far and returns when the buffers are complete
+  void flush();
+
+  int getThreadCount() const {
+    return static_cast<int>(workers_.size()) + 1;
+  }
+
+  RendererBuffer& getBuffer() {
+    return buffer_;
+  }
+
+private:
+  enum Shading {
+    kShadeFlat,
+    kShadePolygon,
+    kShadeGouraud,
+    kShadeTextured
+  };
+
+  //a triangle, or a convex polygon of count_ points with kShadePolygon.
+  //the points are points_[first_, first_ + count_)
+  struct BinnedPrimitive {
+    uint32_t first_;
+    int count_;
+    Color c_[3];
+    Point2<double> uv_[3];
+    const Texture* texture_;
+    Shading shading_;
+    BlendMode blendMode_;
+  };
+
+  //bins the count points last added to points_, drops them when off screen
+  void bin(BinnedPrimitive& prim, int count);
+  void workerLoop();
+  void rasterizeTiles();
+  void rasterizeTile(int tile);
+
+  RendererBuffer buffer_;
+  DepthBuffer* depth_;
+  FrameTiles* frameTiles_;
+  PixelBuffer* pixelTarget_;
+  BlendMode blendMode_;
+  int tileColumns_;
+  int tileRows_;
+
+  std::vector<BinnedPrimitive> primitives_;
+  std::vector<Point3<double>> points_;
+  std::vector<std::vector<uint32_t>> bins_;   //primitive indices per tile, in submission order
+
+  std::vector<std::thread> workers_;
+  std::mutex mutex_;
+  std::condition_variable startCond_;
+  std::condition_variable doneCond_;
+  unsigned generation_;
+  int busyWorkers_;
+  bool quit_;
+  std::atomic<int> nextTile_;
+};
+
+}// namespace s3d
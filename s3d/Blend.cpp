@@ -0,0 +1,267 @@
+#include "Blend.h"
+#include "Simd.h"
+
+#include <cassert>
+
+namespace s3d
+{
+
+namespace
+{
+
+//x / 255 rounded, exact for x <= 255 * 255
+inline uint32_t div255(uint32_t x) {
+  x += 128;
+  return (x + (x >> 8)) >> 8;
+}
+
+template<int Mode>
+inline uint32_t blendPixelT(uint32_t src, uint32_t dst) {
+  if (Mode == kBlendReplace)
+    return src;
+
+  const uint32_t a = src >> 24;
+  uint32_t out = 0;
+  for (int c = 0; c < 32; c += 8) {
+    const uint32_t s = (src >> c) & 0xff;
+    const uint32_t d = (dst >> c) & 0xff;
+    uint32_t v;
+    if (Mode == kBlendSourceOver)
+      v = div255(s * (c == 24 ? 255 : a) + d * (255 - a));
+    else if (Mode == kBlendAdditive)
+      v = s + d > 255 ? 255 : s + d;
+    else
+      v = div255(s * d);
+    out |= v << c;
+  }
+  return out;
+}
+
+template<int Mode>
+void blendSpanScalarT(uint32_t* dst, int count, uint32_t p) {
+  for (int i = 0; i < count; ++i) {
+    dst[i] = blendPixelT<Mode>(p, dst[i]);
+  }
+}
+
+void blendSpanScalar(uint32_t* dst, int count, uint32_t p, BlendMode mode) {
+  switch (mode) {
+  case kBlendSourceOver:
+    return blendSpanScalarT<kBlendSourceOver>(dst, count, p);
+  case kBlendAdditive:
+    return blendSpanScalarT<kBlendAdditive>(dst, count, p);
+  case kBlendMultiply:
+    return blendSpanScalarT<kBlendMultiply>(dst, count, p);
+  default:
+    return blendSpanScalarT<kBlendReplace>(dst, count, p);
+  }
+}
+
+#ifdef S3D_SSE2
+//channels widened to 16 bits, two pixels per register
+S3D_FORCEINLINE __m128i div255x8(__m128i x) {
+  x = _mm_add_epi16(x, _mm_set1_epi16(128));
+  return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+
+//source over factors of two pixels: (a, a, a, 255) for src and 255 - a for dst
+S3D_FORCEINLINE void sourceOverFactors(__m128i alpha2, __m128i& fs, __m128i& fd) {
+  const __m128i a = _mm_shufflelo_epi16(_mm_shufflehi_epi16(alpha2, 0), 0);
+  fs = _mm_or_si128(a, _mm_setr_epi16(0, 0, 0, 255, 0, 0, 0, 255));
+  fd = _mm_sub_epi16(_mm_set1_epi16(255), a);
+}
+
+template<int Mode>
+S3D_FORCEINLINE __m128i blend4(__m128i s, __m128i d) {
+  if (Mode == kBlendReplace)
+    return s;
+  if (Mode == kBlendAdditive)
+    return _mm_adds_epu8(s, d);
+
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i sLo = _mm_unpacklo_epi8(s, zero), sHi = _mm_unpackhi_epi8(s, zero);
+  const __m128i dLo = _mm_unpacklo_epi8(d, zero), dHi = _mm_unpackhi_epi8(d, zero);
+  if (Mode == kBlendMultiply) {
+    return _mm_packus_epi16(div255x8(_mm_mullo_epi16(sLo, dLo)), div255x8(_mm_mullo_epi16(sHi, dHi)));
+  }
+
+  //alpha in lane 3 of each widened pixel
+  __m128i fsLo, fdLo, fsHi, fdHi;
+  sourceOverFactors(_mm_srli_epi64(sLo, 48), fsLo, fdLo);
+  sourceOverFactors(_mm_srli_epi64(sHi, 48), fsHi, fdHi);
+  const __m128i lo = _mm_add_epi16(_mm_mullo_epi16(sLo, fsLo), _mm_mullo_epi16(dLo, fdLo));
+  const __m128i hi = _mm_add_epi16(_mm_mullo_epi16(sHi, fsHi), _mm_mullo_epi16(dHi, fdHi));
+  return _mm_packus_epi16(div255x8(lo), div255x8(hi));
+}
+
+template<int Mode>
+void blendSpanSSE2T(uint32_t* dst, int count, uint32_t p) {
+  const __m128i s = _mm_set1_epi32(static_cast<int>(p));
+  int i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m128i* d = reinterpret_cast<__m128i*>(dst + i);
+    _mm_storeu_si128(d, blend4<Mode>(s, _mm_loadu_si128(d)));
+  }
+  blendSpanScalarT<Mode>(dst + i, count - i, p);
+}
+
+void blendSpanSSE2(uint32_t* dst, int count, uint32_t p, BlendMode mode) {
+  switch (mode) {
+  case kBlendSourceOver:
+    return blendSpanSSE2T<kBlendSourceOver>(dst, count, p);
+  case kBlendAdditive:
+    return blendSpanSSE2T<kBlendAdditive>(dst, count, p);
+  case kBlendMultiply:
+    return blendSpanSSE2T<kBlendMultiply>(dst, count, p);
+  default:
+    return blendSpanSSE2T<kBlendReplace>(dst, count, p);
+  }
+}
+
+template<int Mode>
+void blendMaskedRowT(uint32_t* dst, const uint32_t* src, int count, unsigned mask) {
+  int x = 0;
+  for (; x + 4 <= count; x += 4) {
+    const unsigned nibble = (mask >> x) & 0xF;
+    if (nibble == 0)
+      continue;
+
+    __m128i* d = reinterpret_cast<__m128i*>(dst + x);
+    const __m128i old = _mm_loadu_si128(d);
+    const __m128i pixels = blend4<Mode>(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x)), old);
+    if (nibble == 0xF) {
+      _mm_storeu_si128(d, pixels);
+    } else {
+      const __m128i select = _mm_setr_epi32(-int(nibble & 1), -int((nibble >> 1) & 1),
+                                            -int((nibble >> 2) & 1), -int((nibble >> 3) & 1));
+      _mm_storeu_si128(d, _mm_or_si128(_mm_and_si128(select, pixels), _mm_andnot_si128(select, old)));
+    }
+  }
+  for (; x < count; ++x) {
+    if (mask & (1U << x))
+      dst[x] = blendPixelT<Mode>(src[x], dst[x]);
+  }
+}
+#else
+template<int Mode>
+void blendMaskedRowT(uint32_t* dst, const uint32_t* src, int count, unsigned mask) {
+  for (int x = 0; x < count; ++x) {
+    if (mask & (1U << x))
+      dst[x] = blendPixelT<Mode>(src[x], dst[x]);
+  }
+}
+#endif
+
+#ifdef S3D_AVX2
+S3D_TARGET_AVX2 S3D_FORCEINLINE __m256i div255x16(__m256i x) {
+  x = _mm256_add_epi16(x, _mm256_set1_epi16(128));
+  return _mm256_srli_epi16(_mm256_add_epi16(x, _mm256_srli_epi16(x, 8)), 8);
+}
+
+//8 pixels per step, the unpacks and packs stay within 128 bit lanes so the order is kept
+template<int Mode>
+S3D_TARGET_AVX2 void blendSpanAVX2T(uint32_t* dst, int count, uint32_t p) {
+  const __m256i s = _mm256_set1_epi32(static_cast<int>(p));
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i sLo = _mm256_unpacklo_epi8(s, zero);
+  const uint32_t a = p >> 24;
+  //constant source, so the factors are too
+  const __m256i fs = _mm256_setr_epi16(short(a), short(a), short(a), 255, short(a), short(a), short(a), 255,
+                                       short(a), short(a), short(a), 255, short(a), short(a), short(a), 255);
+  const __m256i fd = _mm256_set1_epi16(short(255 - a));
+  const __m256i sWeighted = _mm256_mullo_epi16(sLo, fs);
+
+  int i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256i* d = reinterpret_cast<__m256i*>(dst + i);
+    const __m256i old = _mm256_loadu_si256(d);
+    __m256i pixels;
+    if (Mode == kBlendAdditive) {
+      pixels = _mm256_adds_epu8(s, old);
+    } else {
+      const __m256i dLo = _mm256_unpacklo_epi8(old, zero), dHi = _mm256_unpackhi_epi8(old, zero);
+      __m256i lo, hi;
+      if (Mode == kBlendMultiply) {
+        lo = _mm256_mullo_epi16(sLo, dLo);
+        hi = _mm256_mullo_epi16(sLo, dHi);
+      } else {
+        lo = _mm256_add_epi16(sWeighted, _mm256_mullo_epi16(dLo, fd));
+        hi = _mm256_add_epi16(sWeighted, _mm256_mullo_epi16(dHi, fd));
+      }
+      pixels = _mm256_packus_epi16(div255x16(lo), div255x16(hi));
+    }
+    _mm256_storeu_si256(d, pixels);
+  }
+  blendSpanScalarT<Mode>(dst + i, count - i, p);
+}
+
+S3D_TARGET_AVX2 void blendSpanAVX2(uint32_t* dst, int count, uint32_t p, BlendMode mode) {
+  switch (mode) {
+  case kBlendSourceOver:
+    return blendSpanAVX2T<kBlendSourceOver>(dst, count, p);
+  case kBlendAdditive:
+    return blendSpanAVX2T<kBlendAdditive>(dst, count, p);
+  case kBlendMultiply:
+    return blendSpanAVX2T<kBlendMultiply>(dst, count, p);
+  default:
+    return blendSpanScalarT<kBlendReplace>(dst, count, p);
+  }
+}
+#endif
+
+BlendSpanFunc blendSpanFor(SimdLevel level) {
+  switch (level) {
+#ifdef S3D_AVX2
+  case kSimdAVX2:
+    return blendSpanAVX2;
+#endif
+#ifdef S3D_SSE2
+  case kSimdSSE2:
+    return blendSpanSSE2;
+#endif
+  default:
+    return blendSpanScalar;
+  }
+}
+
+}
+
+uint32_t blendPixel(uint32_t src, uint32_t dst, BlendMode mode) {
+  switch (mode) {
+  case kBlendSourceOver:
+    return blendPixelT<kBlendSourceOver>(src, dst);
+  case kBlendAdditive:
+    return blendPixelT<kBlendAdditive>(src, dst);
+  case kBlendMultiply:
+    return blendPixelT<kBlendMultiply>(src, dst);
+  default:
+    return src;
+  }
+}
+
+BlendSpanFunc g_blendSpan32 = blendSpanFor(detectSimdLevel());
+
+SimdLevel selectBlendSpan(SimdLevel level) {
+  const SimdLevel supported = detectSimdLevel();
+  if (level > supported)
+    level = supported;
+
+  g_blendSpan32 = blendSpanFor(level);
+  return level;
+}
+
+void blendMaskedRow(uint32_t* dst, const uint32_t* src, int count, unsigned mask, BlendMode mode) {
+  assert(count <= 8);
+  switch (mode) {
+  case kBlendSourceOver:
+    return blendMaskedRowT<kBlendSourceOver>(dst, src, count, mask);
+  case kBlendAdditive:
+    return blendMaskedRowT<kBlendAdditive>(dst, src, count, mask);
+  case kBlendMultiply:
+    return blendMaskedRowT<kBlendMultiply>(dst, src, count, mask);
+  default:
+    return blendMaskedRowT<kBlendReplace>(dst, src, count, mask);
+  }
+}
+
+}// namespace s3d
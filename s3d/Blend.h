@@ -0,0 +1,36 @@
+#pragma once
+#include <cstdint>
+#include "CpuFeatures.h"
+
+namespace s3d
+{
+
+//how a fill combines its color with the pixel already there, per channel.
+//alpha is Color's alpha byte, 255 is opaque
+enum BlendMode {
+  kBlendReplace,      //dst = src, the default
+  kBlendSourceOver,   //dst = src * a + dst * (1 - a), alpha: a + dst.a * (1 - a)
+  kBlendAdditive,     //dst = min(src + dst, 255)
+  kBlendMultiply      //dst = src * dst / 255
+};
+
+//one pixel, exact rounding of the / 255. the SIMD paths give the same result
+uint32_t blendPixel(uint32_t src, uint32_t dst, BlendMode mode);
+
+typedef void (*BlendSpanFunc)(uint32_t* dst, int count, uint32_t p, BlendMode mode);
+
+//the span blender picked for this cpu at startup
+extern BlendSpanFunc g_blendSpan32;
+
+//blends p into count pixels starting at dst
+inline void blendSpan32(uint32_t* dst, int count, uint32_t p, BlendMode mode) {
+  g_blendSpan32(dst, count, p, mode);
+}
+
+//forces a code path as selectSpanFill does, returns the level in use
+SimdLevel selectBlendSpan(SimdLevel level);
+
+//blends src[i] into dst[i] for the pixels selected by mask (bit i), count <= 8
+void blendMaskedRow(uint32_t* dst, const uint32_t* src, int count, unsigned mask, BlendMode mode);
+
+}// namespace s3d
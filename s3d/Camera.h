@@ -43,6 +43,18 @@ public:
     return matWorldToScreen_;
   }
 
+  //the matrices above in the scalar of the vertices they transform. they are
+  //composed in double, only the result is rounded
+  template<typename T>
+  Matrix<T, 4U, 4U> getWorldToCameraMatrix() const {
+    return Matrix<T, 4U, 4U>(matWorldToCamera_);
+  }
+
+  template<typename T>
+  Matrix<T, 4U, 4U> getCameraToScreenMatrix() const {
+    return Matrix<T, 4U, 4U>(matCameraToScreen_);
+  }
+
   bool isSphereOutOfView(const Point4FD& position, double radius);
   bool isBackFacePlane(const Vector4FD& n);
 
@@ -62,6 +74,14 @@ public:
     return n_;
   }
 
+  double getNearClipZ() const {
+    return nearClipZ_;
+  }
+
+  double getFarClipZ() const {
+    return farClipZ_;
+  }
+
 protected:
   Matrix4x4FD buildWorldToCameraMatrix4x4FD();
   Matrix4x4FD buildCameraToPerspectiveMatrix4x4FD();
@@ -0,0 +1,271 @@
+#include "ColorBatch.h"
+#include "Simd.h"
+
+namespace s3d
+{
+
+namespace
+{
+
+//x / 255 rounded, exact for x <= 255 * 255
+inline uint32_t div255(uint32_t x) {
+  x += 128;
+  return (x + (x >> 8)) >> 8;
+}
+
+inline uint32_t modulatePixel(uint32_t a, uint32_t b) {
+  uint32_t out = 0;
+  for (int c = 0; c < 32; c += 8) {
+    out |= div255(((a >> c) & 0xff) * ((b >> c) & 0xff)) << c;
+  }
+  return out;
+}
+
+inline uint32_t addPixelSaturate(uint32_t a, uint32_t b) {
+  uint32_t out = 0;
+  for (int c = 0; c < 32; c += 8) {
+    const uint32_t v = ((a >> c) & 0xff) + ((b >> c) & 0xff);
+    out |= (v > 255 ? 255 : v) << c;
+  }
+  return out;
+}
+
+inline uint32_t lerpPixel(uint32_t a, uint32_t b, int t) {
+  uint32_t out = 0;
+  for (int c = 0; c < 32; c += 8) {
+    out |= ((((a >> c) & 0xff) * (256 - t) + ((b >> c) & 0xff) * t + 128) >> 8) << c;
+  }
+  return out;
+}
+
+inline uint32_t scalePixel(uint32_t p, uint32_t intensity) {
+  uint32_t out = p & 0xff000000U;
+  for (int c = 0; c < 24; c += 8) {
+    const uint32_t v = (((p >> c) & 0xff) * intensity) >> 8;
+    out |= (v > 255 ? 255 : v) << c;
+  }
+  return out;
+}
+
+void modulateColorsScalar(uint32_t* dst, const uint32_t* a, const uint32_t* b, int count) {
+  for (int i = 0; i < count; ++i) {
+    dst[i] = modulatePixel(a[i], b[i]);
+  }
+}
+
+void addColorsSaturateScalar(uint32_t* dst, const uint32_t* a, const uint32_t* b, int count) {
+  for (int i = 0; i < count; ++i) {
+    dst[i] = addPixelSaturate(a[i], b[i]);
+  }
+}
+
+void lerpColorsScalar(uint32_t* dst, const uint32_t* a, const uint32_t* b, int t, int count) {
+  for (int i = 0; i < count; ++i) {
+    dst[i] = lerpPixel(a[i], b[i], t);
+  }
+}
+
+void scaleColorsScalar(uint32_t* dst, const uint32_t* src, const uint16_t* intensities, int count) {
+  for (int i = 0; i < count; ++i) {
+    dst[i] = scalePixel(src[i], intensities[i]);
+  }
+}
+
+#ifdef S3D_SSE2
+//channels widened to 16 bits, two pixels per register
+S3D_FORCEINLINE __m128i div255x8(__m128i x) {
+  x = _mm_add_epi16(x, _mm_set1_epi16(128));
+  return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+
+S3D_FORCEINLINE __m128i load4(const uint32_t* p) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+}
+
+S3D_FORCEINLINE void store4(uint32_t* p, __m128i v) {
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v);
+}
+
+void modulateColorsSSE2(uint32_t* dst, const uint32_t* a, const uint32_t* b, int count) {
+  const __m128i zero = _mm_setzero_si128();
+  int i = 0;
+  for (; i + 4 <= count; i += 4) {
+    const __m128i va = load4(a + i), vb = load4(b + i);
+    const __m128i lo = _mm_mullo_epi16(_mm_unpacklo_epi8(va, zero), _mm_unpacklo_epi8(vb, zero));
+    const __m128i hi = _mm_mullo_epi16(_mm_unpackhi_epi8(va, zero), _mm_unpackhi_epi8(vb, zero));
+    store4(dst + i, _mm_packus_epi16(div255x8(lo), div255x8(hi)));
+  }
+  modulateColorsScalar(dst + i, a + i, b + i, count - i);
+}
+
+void addColorsSaturateSSE2(uint32_t* dst, const uint32_t* a, const uint32_t* b, int count) {
+  int i = 0;
+  for (; i + 4 <= count; i += 4) {
+    store4(dst + i, _mm_adds_epu8(load4(a + i), load4(b + i)));
+  }
+  addColorsSaturateScalar(dst + i, a + i, b + i, count - i);
+}
+
+//a * (256 - t) + b * t + 128 stays below 1 << 16, so unsigned 16 bit lanes hold it
+void lerpColorsSSE2(uint32_t* dst, const uint32_t* a, const uint32_t* b, int t, int count) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i ta = _mm_set1_epi16(short(256 - t)), tb = _mm_set1_epi16(short(t));
+  const __m128i half = _mm_set1_epi16(128);
+  int i = 0;
+  for (; i + 4 <= count; i += 4) {
+    const __m128i va = load4(a + i), vb = load4(b + i);
+    __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(va, zero), ta),
+                               _mm_mullo_epi16(_mm_unpacklo_epi8(vb, zero), tb));
+    __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(va, zero), ta),
+                               _mm_mullo_epi16(_mm_unpackhi_epi8(vb, zero), tb));
+    lo = _mm_srli_epi16(_mm_add_epi16(lo, half), 8);
+    hi = _mm_srli_epi16(_mm_add_epi16(hi, half), 8);
+    store4(dst + i, _mm_packus_epi16(lo, hi));
+  }
+  lerpColorsScalar(dst + i, a + i, b + i, t, count - i);
+}
+
+//(c << 8) * f >> 16 is c * f / 256 without leaving 16 bits. the pack saturates
+//signed words, so the products are clamped to 255 first (x - max(x - 255, 0)).
+//the alpha lanes get a factor of 256
+void scaleColorsSSE2(uint32_t* dst, const uint32_t* src, const uint16_t* intensities, int count) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i colorLanes = _mm_setr_epi16(-1, -1, -1, 0, -1, -1, -1, 0);
+  const __m128i alphaFactor = _mm_setr_epi16(0, 0, 0, 256, 0, 0, 0, 256);
+  const __m128i max255 = _mm_set1_epi16(255);
+  int i = 0;
+  for (; i + 4 <= count; i += 4) {
+    const __m128i v = load4(src + i);
+    __m128i f = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(intensities + i));
+    f = _mm_unpacklo_epi16(f, f);
+    const __m128i fLo = _mm_or_si128(_mm_and_si128(_mm_unpacklo_epi32(f, f), colorLanes), alphaFactor);
+    const __m128i fHi = _mm_or_si128(_mm_and_si128(_mm_unpackhi_epi32(f, f), colorLanes), alphaFactor);
+    __m128i lo = _mm_mulhi_epu16(_mm_slli_epi16(_mm_unpacklo_epi8(v, zero), 8), fLo);
+    __m128i hi = _mm_mulhi_epu16(_mm_slli_epi16(_mm_unpackhi_epi8(v, zero), 8), fHi);
+    lo = _mm_sub_epi16(lo, _mm_subs_epu16(lo, max255));
+    hi = _mm_sub_epi16(hi, _mm_subs_epu16(hi, max255));
+    store4(dst + i, _mm_packus_epi16(lo, hi));
+  }
+  scaleColorsScalar(dst + i, src + i, intensities + i, count - i);
+}
+#endif
+
+#ifdef S3D_AVX2
+//8 pixels per step, the unpacks and packs stay within 128 bit lanes so the order is kept
+S3D_TARGET_AVX2 S3D_FORCEINLINE __m256i div255x16(__m256i x) {
+  x = _mm256_add_epi16(x, _mm256_set1_epi16(128));
+  return _mm256_srli_epi16(_mm256_add_epi16(x, _mm256_srli_epi16(x, 8)), 8);
+}
+
+S3D_TARGET_AVX2 S3D_FORCEINLINE __m256i load8(const uint32_t* p) {
+  return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+}
+
+S3D_TARGET_AVX2 S3D_FORCEINLINE void store8(uint32_t* p, __m256i v) {
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v);
+}
+
+S3D_TARGET_AVX2 void modulateColorsAVX2(uint32_t* dst, const uint32_t* a, const uint32_t* b, int count) {
+  const __m256i zero = _mm256_setzero_si256();
+  int i = 0;
+  for (; i + 8 <= count; i += 8) {
+    const __m256i va = load8(a + i), vb = load8(b + i);
+    const __m256i lo = _mm256_mullo_epi16(_mm256_unpacklo_epi8(va, zero), _mm256_unpacklo_epi8(vb, zero));
+    const __m256i hi = _mm256_mullo_epi16(_mm256_unpackhi_epi8(va, zero), _mm256_unpackhi_epi8(vb, zero));
+    store8(dst + i, _mm256_packus_epi16(div255x16(lo), div255x16(hi)));
+  }
+  modulateColorsScalar(dst + i, a + i, b + i, count - i);
+}
+
+S3D_TARGET_AVX2 void addColorsSaturateAVX2(uint32_t* dst, const uint32_t* a, const uint32_t* b, int count) {
+  int i = 0;
+  for (; i + 8 <= count; i += 8) {
+    store8(dst + i, _mm256_adds_epu8(load8(a + i), load8(b + i)));
+  }
+  addColorsSaturateScalar(dst + i, a + i, b + i, count - i);
+}
+
+S3D_TARGET_AVX2 void lerpColorsAVX2(uint32_t* dst, const uint32_t* a, const uint32_t* b, int t, int count) {
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i ta = _mm256_set1_epi16(short(256 - t)), tb = _mm256_set1_epi16(short(t));
+  const __m256i half = _mm256_set1_epi16(128);
+  int i = 0;
+  for (; i + 8 <= count; i += 8) {
+    const __m256i va = load8(a + i), vb = load8(b + i);
+    __m256i lo = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(va, zero), ta),
+                                  _mm256_mullo_epi16(_mm256_unpacklo_epi8(vb, zero), tb));
+    __m256i hi = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(va, zero), ta),
+                                  _mm256_mullo_epi16(_mm256_unpackhi_epi8(vb, zero), tb));
+    lo = _mm256_srli_epi16(_mm256_add_epi16(lo, half), 8);
+    hi = _mm256_srli_epi16(_mm256_add_epi16(hi, half), 8);
+    store8(dst + i, _mm256_packus_epi16(lo, hi));
+  }
+  lerpColorsScalar(dst + i, a + i, b + i, t, count - i);
+}
+
+//intensities 0-3 go to the low lane and 4-7 to the high one before they are spread,
+//min_epu16 does the clamp here
+S3D_TARGET_AVX2 void scaleColorsAVX2(uint32_t* dst, const uint32_t* src, const uint16_t* intensities, int count) {
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i colorLanes = _mm256_setr_epi16(-1, -1, -1, 0, -1, -1, -1, 0, -1, -1, -1, 0, -1, -1, -1, 0);
+  const __m256i alphaFactor = _mm256_setr_epi16(0, 0, 0, 256, 0, 0, 0, 256, 0, 0, 0, 256, 0, 0, 0, 256);
+  const __m256i max255 = _mm256_set1_epi16(255);
+  int i = 0;
+  for (; i + 8 <= count; i += 8) {
+    const __m256i v = load8(src + i);
+    const __m128i f8 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(intensities + i));
+    __m256i f = _mm256_permute4x64_epi64(_mm256_castsi128_si256(f8), 0x50);
+    f = _mm256_unpacklo_epi16(f, f);
+    const __m256i fLo = _mm256_or_si256(_mm256_and_si256(_mm256_unpacklo_epi32(f, f), colorLanes), alphaFactor);
+    const __m256i fHi = _mm256_or_si256(_mm256_and_si256(_mm256_unpackhi_epi32(f, f), colorLanes), alphaFactor);
+    const __m256i lo = _mm256_min_epu16(_mm256_mulhi_epu16(_mm256_slli_epi16(_mm256_unpacklo_epi8(v, zero), 8), fLo), max255);
+    const __m256i hi = _mm256_min_epu16(_mm256_mulhi_epu16(_mm256_slli_epi16(_mm256_unpackhi_epi8(v, zero), 8), fHi), max255);
+    store8(dst + i, _mm256_packus_epi16(lo, hi));
+  }
+  scaleColorsScalar(dst + i, src + i, intensities + i, count - i);
+}
+#endif
+
+struct ColorKernels {
+  ColorBinaryFunc modulate_;
+  ColorBinaryFunc addSaturate_;
+  ColorLerpFunc lerp_;
+  ColorScaleFunc scale_;
+};
+
+ColorKernels colorKernelsFor(SimdLevel level) {
+  switch (level) {
+#ifdef S3D_AVX2
+  case kSimdAVX2:
+    return {modulateColorsAVX2, addColorsSaturateAVX2, lerpColorsAVX2, scaleColorsAVX2};
+#endif
+#ifdef S3D_SSE2
+  case kSimdSSE2:
+    return {modulateColorsSSE2, addColorsSaturateSSE2, lerpColorsSSE2, scaleColorsSSE2};
+#endif
+  default:
+    return {modulateColorsScalar, addColorsSaturateScalar, lerpColorsScalar, scaleColorsScalar};
+  }
+}
+
+}
+
+ColorBinaryFunc g_modulateColors = colorKernelsFor(detectSimdLevel()).modulate_;
+ColorBinaryFunc g_addColorsSaturate = colorKernelsFor(detectSimdLevel()).addSaturate_;
+ColorLerpFunc g_lerpColors = colorKernelsFor(detectSimdLevel()).lerp_;
+ColorScaleFunc g_scaleColors = colorKernelsFor(detectSimdLevel()).scale_;
+
+SimdLevel selectColorBatch(SimdLevel level) {
+  const SimdLevel supported = detectSimdLevel();
+  if (level > supported)
+    level = supported;
+
+  const ColorKernels kernels = colorKernelsFor(level);
+  g_modulateColors = kernels.modulate_;
+  g_addColorsSaturate = kernels.addSaturate_;
+  g_lerpColors = kernels.lerp_;
+  g_scaleColors = kernels.scale_;
+  return level;
+}
+
+}// namespace s3d
@@ -0,0 +1,46 @@
+#pragma once
+#include <cstdint>
+#include "CpuFeatures.h"
+
+namespace s3d
+{
+
+//arrays of packed Color values (getABGRValue) worked on a register of pixels at a
+//time with saturating byte arithmetic, for lighting and tinting many colors at
+//once. dst may be one of the inputs. the SIMD paths give the scalar result exactly
+
+typedef void (*ColorBinaryFunc)(uint32_t* dst, const uint32_t* a, const uint32_t* b, int count);
+typedef void (*ColorLerpFunc)(uint32_t* dst, const uint32_t* a, const uint32_t* b, int t, int count);
+typedef void (*ColorScaleFunc)(uint32_t* dst, const uint32_t* src, const uint16_t* intensities, int count);
+
+//the kernels picked for this cpu at startup
+extern ColorBinaryFunc g_modulateColors;
+extern ColorBinaryFunc g_addColorsSaturate;
+extern ColorLerpFunc g_lerpColors;
+extern ColorScaleFunc g_scaleColors;
+
+//a * b / 255 per channel, rounded, alpha included
+inline void modulateColors(uint32_t* dst, const uint32_t* a, const uint32_t* b, int count) {
+  g_modulateColors(dst, a, b, count);
+}
+
+//min(a + b, 255) per channel, alpha included
+inline void addColorsSaturate(uint32_t* dst, const uint32_t* a, const uint32_t* b, int count) {
+  g_addColorsSaturate(dst, a, b, count);
+}
+
+//(a * (256 - t) + b * t) / 256 per channel, rounded, t in [0, 256]
+inline void lerpColors(uint32_t* dst, const uint32_t* a, const uint32_t* b, int t, int count) {
+  g_lerpColors(dst, a, b, t, count);
+}
+
+//min(c * intensities[i] / 256, 255) for red, green and blue, alpha is kept.
+//intensities are 8.8 fixed point, 256 leaves the color as it is
+inline void scaleColors(uint32_t* dst, const uint32_t* src, const uint16_t* intensities, int count) {
+  g_scaleColors(dst, src, intensities, count);
+}
+
+//forces a code path as selectSpanFill does, returns the level in use
+SimdLevel selectColorBatch(SimdLevel level);
+
+}// namespace s3d
@@ -0,0 +1,174 @@
+#include "CommandBuffer.h"
+#include "Rasterizer.h"
+
+#include <algorithm>
+
+namespace s3d
+{
+
+namespace
+{
+
+Point3<double> toPoint3(const Point4<double>& v) {
+  return Point3<double>(v.x_, v.y_, v.z_);
+}
+
+}
+
+CommandBuffer::CommandBuffer() : blendMode_(kBlendReplace) {
+}
+
+void CommandBuffer::record(CommandType type, int count, const Color& c, const Texture* texture) {
+  Command cmd;
+  cmd.first_ = static_cast<uint32_t>(points_.size() - count);
+  cmd.attr_ = 0;
+  if (type == kCommandGouraud)
+    cmd.attr_ = static_cast<uint32_t>(colors_.size() - count);
+  else if (type == kCommandTextured)
+    cmd.attr_ = static_cast<uint32_t>(uvs_.size() - count);
+  cmd.count_ = static_cast<uint8_t>(count);
+  cmd.type_ = static_cast<uint8_t>(type);
+  cmd.blendMode_ = static_cast<uint8_t>(blendMode_);
+  cmd.color_ = c;
+  cmd.texture_ = texture;
+
+  //blended | shading | texture ordinal | color. every blended draw has the same
+  //key whatever its mode, the modes do not commute so they keep their order
+  cmd.key_ = blendMode_ == kBlendReplace ? 0 : uint64_t(1) << 56;
+  if (blendMode_ == kBlendReplace) {
+    uint64_t ordinal = 0;
+    if (texture) {
+      ordinal = std::find(textures_.begin(), textures_.end(), texture) - textures_.begin();
+      if (ordinal == textures_.size())
+        textures_.push_back(texture);
+    }
+    cmd.key_ |= (uint64_t(type) << 48) | ((ordinal & 0xffffU) << 32) | c.getABGRValue();
+  }
+
+  commands_.push_back(cmd);
+}
+
+void CommandBuffer::fillTriangle3D_Depth(const Point3<double>& p0, const Point3<double>& p1, const Point3<double>& p2, const Color& c) {
+  points_.push_back(p0);
+  points_.push_back(p1);
+  points_.push_back(p2);
+  record(kCommandFlat, 3, c, NULL);
+}
+
+void CommandBuffer::fillConvexPolygon3D_Depth(const Point3<double>* points, int count, const Color& c) {
+  assert(count >= 3 && count <= kMaxConvexEdges);
+  points_.insert(points_.end(), points, points + count);
+  record(kCommandFlat, count, c, NULL);
+}
+
+void CommandBuffer::fillTriangle3D_Gouraud(const Point3<double>& p0, const Point3<double>& p1, const Point3<double>& p2,
+                                           const Color& c0, const Color& c1, const Color& c2) {
+  points_.push_back(p0);
+  points_.push_back(p1);
+  points_.push_back(p2);
+  colors_.push_back(c0);
+  colors_.push_back(c1);
+  colors_.push_back(c2);
+  record(kCommandGouraud, 3, Color(), NULL);
+}
+
+void CommandBuffer::fillTriangle3D_Textured(const Point3<double>& p0, const Point3<double>& p1, const Point3<double>& p2,
+                                            const Point2<double>& uv0, const Point2<double>& uv1, const Point2<double>& uv2,
+                                            const Texture& texture) {
+  points_.push_back(p0);
+  points_.push_back(p1);
+  points_.push_back(p2);
+  uvs_.push_back(uv0);
+  uvs_.push_back(uv1);
+  uvs_.push_back(uv2);
+  record(kCommandTextured, 3, Color(), &texture);
+}
+
+void CommandBuffer::drawIndexedTriangles(const Point4<double>* vertices, int vertexCount,
+                                         const uint32_t* indices, int triangleCount, const Color* colors) {
+  for (int t = 0; t < triangleCount; ++t, indices += 3) {
+    assert(indices[0] < uint32_t(vertexCount) && indices[1] < uint32_t(vertexCount) && indices[2] < uint32_t(vertexCount));
+    fillTriangle3D_Depth(toPoint3(vertices[indices[0]]), toPoint3(vertices[indices[1]]),
+                         toPoint3(vertices[indices[2]]), colors[t]);
+  }
+}
+
+void CommandBuffer::drawIndexedPolygons(const Point4<double>* vertices, int vertexCount, const uint32_t* indices,
+                                        const uint8_t* vertexCounts, int polygonCount, const Color* colors) {
+  for (int k = 0; k < polygonCount; indices += vertexCounts[k], ++k) {
+    for (int i = 0; i < vertexCounts[k]; ++i) {
+      assert(indices[i] < uint32_t(vertexCount));
+      points_.push_back(toPoint3(vertices[indices[i]]));
+    }
+    record(kCommandFlat, vertexCounts[k], colors[k], NULL);
+  }
+}
+
+void CommandBuffer::drawIndexedTrianglesGouraud(const Point4<double>* vertices, const Color* vertexColors, int vertexCount,
+                                                const uint32_t* indices, int triangleCount) {
+  for (int t = 0; t < triangleCount; ++t, indices += 3) {
+    const uint32_t i0 = indices[0], i1 = indices[1], i2 = indices[2];
+    assert(i0 < uint32_t(vertexCount) && i1 < uint32_t(vertexCount) && i2 < uint32_t(vertexCount));
+    fillTriangle3D_Gouraud(toPoint3(vertices[i0]), toPoint3(vertices[i1]), toPoint3(vertices[i2]),
+                           vertexColors[i0], vertexColors[i1], vertexColors[i2]);
+  }
+}
+
+void CommandBuffer::sortByState() {
+  std::stable_sort(commands_.begin(), commands_.end(), [](const Command& a, const Command& b) {
+    return a.key_ < b.key_;
+  });
+}
+
+template<typename TargetRenderer>
+void CommandBuffer::replay(TargetRenderer& renderer) const {
+  const BlendMode savedMode = renderer.getBlendMode();
+  BlendMode mode = savedMode;
+  for (const auto& cmd : commands_) {
+    if (cmd.blendMode_ != mode) {
+      mode = BlendMode(cmd.blendMode_);
+      renderer.setBlendMode(mode);
+    }
+
+    const Point3<double>* p = &points_[cmd.first_];
+    switch (cmd.type_) {
+    case kCommandFlat:
+      if (cmd.count_ == 3)
+        renderer.fillTriangle3D_Depth(p[0], p[1], p[2], cmd.color_);
+      else
+        renderer.fillConvexPolygon3D_Depth(p, cmd.count_, cmd.color_);
+      break;
+    case kCommandGouraud: {
+      const Color* c = &colors_[cmd.attr_];
+      renderer.fillTriangle3D_Gouraud(p[0], p[1], p[2], c[0], c[1], c[2]);
+      break;
+    }
+    case kCommandTextured: {
+      const Point2<double>* uv = &uvs_[cmd.attr_];
+      renderer.fillTriangle3D_Textured(p[0], p[1], p[2], uv[0], uv[1], uv[2], *cmd.texture_);
+      break;
+    }
+    }
+  }
+
+  if (mode != savedMode)
+    renderer.setBlendMode(savedMode);
+}
+
+void CommandBuffer::execute(Renderer& renderer) const {
+  replay(renderer);
+}
+
+void CommandBuffer::execute(BinnedRenderer& renderer) const {
+  replay(renderer);
+}
+
+void CommandBuffer::clear() {
+  commands_.clear();
+  points_.clear();
+  colors_.clear();
+  uvs_.clear();
+  textures_.clear();
+}
+
+}// namespace s3d
@@ -0,0 +1,104 @@
+#pragma once
+#include "Renderer.h"
+#include "BinnedRenderer.h"
+
+#include <vector>
+
+namespace s3d
+{
+
+//draws recorded into one linear buffer instead of rasterized, execute() then
+//replays them into a Renderer or a BinnedRenderer. vertices are copied when
+//recorded, so a buffer can be built away from the renderer (another thread,
+//scene traversal) and replayed over several frames while the scene is static.
+//the draw calls take the same arguments as Renderer's
+class CommandBuffer {
+public:
+  CommandBuffer();
+
+  //recorded with the draws after it, see Renderer::setBlendMode
+  void setBlendMode(BlendMode mode) {
+    blendMode_ = mode;
+  }
+  BlendMode getBlendMode() const {
+    return blendMode_;
+  }
+
+  void fillTriangle3D_Depth(const Point3<double>& p0, const Point3<double>& p1, const Point3<double>& p2, const Color& c);
+
+  void fillConvexPolygon3D_Depth(const Point3<double>* points, int count, const Color& c);
+
+  void fillTriangle3D_Gouraud(const Point3<double>& p0, const Point3<double>& p1, const Point3<double>& p2,
+                              const Color& c0, const Color& c1, const Color& c2);
+
+  //texture is not copied, it must outlive every execute()
+  void fillTriangle3D_Textured(const Point3<double>& p0, const Point3<double>& p1, const Point3<double>& p2,
+                               const Point2<double>& uv0, const Point2<double>& uv1, const Point2<double>& uv2,
+                               const Texture& texture);
+
+  void drawIndexedTriangles(const Point4<double>* vertices, int vertexCount,
+                            const uint32_t* indices, int triangleCount, const Color* colors);
+
+  void drawIndexedPolygons(const Point4<double>* vertices, int vertexCount, const uint32_t* indices,
+                           const uint8_t* vertexCounts, int polygonCount, const Color* colors);
+
+  void drawIndexedTrianglesGouraud(const Point4<double>* vertices, const Color* vertexColors, int vertexCount,
+                                   const uint32_t* indices, int triangleCount);
+
+  //stable sort of the recorded draws by state: kBlendReplace draws first, by
+  //shading, texture and color, then every blended draw in recorded order, whatever
+  //its mode. opaque draws change order, so only sort depth tested scenes
+  void sortByState();
+
+  //replays every draw in recorded (or sorted) order. the buffer is left intact,
+  //the renderer's blend mode is set per draw and restored afterwards
+  void execute(Renderer& renderer) const;
+
+  //records into renderer, drawn at its next flush()
+  void execute(BinnedRenderer& renderer) const;
+
+  void clear();
+
+  //draws recorded
+  size_t size() const {
+    return commands_.size();
+  }
+
+  bool empty() const {
+    return commands_.empty();
+  }
+
+private:
+  enum CommandType {
+    kCommandFlat,
+    kCommandGouraud,
+    kCommandTextured
+  };
+
+  //points_[first_, first_ + count_), for Gouraud and textured draws the
+  //colors_ / uvs_ from attr_ on, one per point
+  struct Command {
+    uint64_t key_;
+    uint32_t first_;
+    uint32_t attr_;
+    uint8_t count_;
+    uint8_t type_;
+    uint8_t blendMode_;
+    Color color_;
+    const Texture* texture_;
+  };
+
+  void record(CommandType type, int count, const Color& c, const Texture* texture);
+
+  template<typename TargetRenderer>
+  void replay(TargetRenderer& renderer) const;
+
+  BlendMode blendMode_;
+  std::vector<Command> commands_;
+  std::vector<Point3<double>> points_;
+  std::vector<Color> colors_;
+  std::vector<Point2<double>> uvs_;
+  std::vector<const Texture*> textures_;   //ordinal of each texture in the sort key
+};
+
+}// namespace s3d
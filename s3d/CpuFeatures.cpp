@@ -0,0 +1,70 @@
+#include "CpuFeatures.h"
+#include "Simd.h"
+
+#ifdef S3D_SSE2
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace s3d
+{
+
+namespace
+{
+
+#ifdef S3D_SSE2
+void cpuid(int leaf, int subleaf, unsigned regs[4]) {
+#ifdef _MSC_VER
+  int r[4];
+  __cpuidex(r, leaf, subleaf);
+  for (int i = 0; i < 4; ++i) {
+    regs[i] = static_cast<unsigned>(r[i]);
+  }
+#else
+  __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+//XCR0, which register states the os saves on context switch
+unsigned long long xgetbv0() {
+#ifdef _MSC_VER
+  return _xgetbv(0);
+#else
+  unsigned eax, edx;
+  __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+  return (static_cast<unsigned long long>(edx) << 32) | eax;
+#endif
+}
+#endif
+
+}
+
+SimdLevel detectSimdLevel() {
+#ifdef S3D_SSE2
+  unsigned regs[4];
+  cpuid(0, 0, regs);
+  const unsigned maxLeaf = regs[0];
+
+  cpuid(1, 0, regs);
+  const bool sse2 = (regs[3] & (1U << 26)) != 0;
+  const bool osxsave = (regs[2] & (1U << 27)) != 0;
+  const bool avx = (regs[2] & (1U << 28)) != 0;
+  if (!sse2)
+    return kSimdNone;
+
+  if (maxLeaf >= 7 && osxsave && avx && (xgetbv0() & 0x6) == 0x6) {
+    cpuid(7, 0, regs);
+    if (regs[1] & (1U << 5))
+      return kSimdAVX2;
+  }
+
+  return kSimdSSE2;
+#else
+  return kSimdNone;
+#endif
+}
+
+}// namespace s3d
@@ -0,0 +1,15 @@
+#pragma once
+
+namespace s3d
+{
+
+enum SimdLevel {
+  kSimdNone,
+  kSimdSSE2,
+  kSimdAVX2
+};
+
+//the widest instruction set both the cpu and the os (register state saving) support
+SimdLevel detectSimdLevel();
+
+}// namespace s3d
@@ -0,0 +1,125 @@
+#include "DepthBuffer.h"
+#include "AlignedMemory.h"
+#include "Simd.h"
+
+using namespace std;
+
+namespace s3d
+{
+
+DepthBuffer::DepthBuffer(int w, int h, DepthFormat format)
+  : buffer_(NULL), format_(format), width_(w), height_(h) {
+  assert(w > 0 && h > 0);
+  const size_t pixelSize = format == kDepth16 ? sizeof(uint16_t) : sizeof(uint32_t);
+  const size_t rowBytes = alignUp(alignUp(w, kDepthTileSize) * pixelSize, kSurfaceAlignment);
+  pitch_ = static_cast<int>(rowBytes / pixelSize);
+  buffer_ = alignedAlloc(rowBytes * h);
+
+  tileColumns_ = (w + kDepthTileSize - 1) / kDepthTileSize;
+  tileRows_ = (h + kDepthTileSize - 1) / kDepthTileSize;
+  tileMin_.resize(tileColumns_ * tileRows_);
+  tileMax_.resize(tileColumns_ * tileRows_);
+  clear();
+}
+
+DepthBuffer::~DepthBuffer() {
+  alignedFree(buffer_);
+}
+
+void DepthBuffer::clear() {
+  const size_t pixelSize = format_ == kDepth16 ? sizeof(uint16_t) : sizeof(uint32_t);
+  memset(buffer_, 0, pitch_ * pixelSize * height_);
+  fill(tileMin_.begin(), tileMin_.end(), 0);
+  fill(tileMax_.begin(), tileMax_.end(), 0);
+}
+
+unsigned DepthBuffer::testAndWriteRow(int x, int y, unsigned mask, float q0, float dqdx,
+                                      float qMin, float qMax, bool test) {
+  assert((x & (kDepthTileSize - 1)) == 0 && x < width_ && y >= 0 && y < height_);
+  assert(qMin >= 0.f && qMax <= 1.f);
+
+#ifdef S3D_SSE2
+  const __m128 step = _mm_set1_ps(dqdx);
+  const __m128 lo = _mm_set1_ps(qMin);
+  const __m128 hi = _mm_set1_ps(qMax);
+  const __m128 base = _mm_set1_ps(q0);
+  const __m128 q03 = _mm_min_ps(_mm_max_ps(_mm_add_ps(base, _mm_mul_ps(_mm_setr_ps(0.f, 1.f, 2.f, 3.f), step)), lo), hi);
+  const __m128 q47 = _mm_min_ps(_mm_max_ps(_mm_add_ps(base, _mm_mul_ps(_mm_setr_ps(4.f, 5.f, 6.f, 7.f), step)), lo), hi);
+  const __m128i selected = _mm_setr_epi32(-int(mask & 1), -int((mask >> 1) & 1), -int((mask >> 2) & 1), -int((mask >> 3) & 1));
+  const __m128i selected2 = _mm_setr_epi32(-int((mask >> 4) & 1), -int((mask >> 5) & 1), -int((mask >> 6) & 1), -int((mask >> 7) & 1));
+
+  if (format_ == kDepth16) {
+    uint16_t* row = static_cast<uint16_t*>(buffer_) + y * pitch_ + x;
+    const __m128 scale = _mm_set1_ps(65535.f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128i d03 = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(q03, scale), half));
+    const __m128i d47 = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(q47, scale), half));
+
+    const __m128i old = _mm_load_si128(reinterpret_cast<const __m128i*>(row));
+    __m128i pass03 = selected, pass47 = selected2;
+    if (test) {
+      const __m128i zero = _mm_setzero_si128();
+      pass03 = _mm_and_si128(pass03, _mm_cmpgt_epi32(d03, _mm_unpacklo_epi16(old, zero)));
+      pass47 = _mm_and_si128(pass47, _mm_cmpgt_epi32(d47, _mm_unpackhi_epi16(old, zero)));
+    }
+
+    const unsigned written = _mm_movemask_ps(_mm_castsi128_ps(pass03)) |
+                             (_mm_movemask_ps(_mm_castsi128_ps(pass47)) << 4);
+    if (written) {
+      //packs_epi32 saturates signed, bias into the signed range and back
+      const __m128i bias = _mm_set1_epi32(0x8000);
+      const __m128i d = _mm_xor_si128(_mm_packs_epi32(_mm_sub_epi32(d03, bias), _mm_sub_epi32(d47, bias)),
+                                      _mm_set1_epi16(-0x8000));
+      const __m128i pass = _mm_packs_epi32(pass03, pass47);
+      _mm_store_si128(reinterpret_cast<__m128i*>(row), _mm_or_si128(_mm_and_si128(pass, d), _mm_andnot_si128(pass, old)));
+    }
+    return written;
+  }
+
+  uint32_t* row = static_cast<uint32_t*>(buffer_) + y * pitch_ + x;
+  //non-negative floats compare like signed integers
+  const __m128i d03 = _mm_castps_si128(q03);
+  const __m128i d47 = _mm_castps_si128(q47);
+  const __m128i old03 = _mm_load_si128(reinterpret_cast<const __m128i*>(row));
+  const __m128i old47 = _mm_load_si128(reinterpret_cast<const __m128i*>(row + 4));
+  __m128i pass03 = selected, pass47 = selected2;
+  if (test) {
+    pass03 = _mm_and_si128(pass03, _mm_cmpgt_epi32(d03, old03));
+    pass47 = _mm_and_si128(pass47, _mm_cmpgt_epi32(d47, old47));
+  }
+
+  const unsigned written = _mm_movemask_ps(_mm_castsi128_ps(pass03)) |
+                           (_mm_movemask_ps(_mm_castsi128_ps(pass47)) << 4);
+  if (written) {
+    _mm_store_si128(reinterpret_cast<__m128i*>(row), _mm_or_si128(_mm_and_si128(pass03, d03), _mm_andnot_si128(pass03, old03)));
+    _mm_store_si128(reinterpret_cast<__m128i*>(row + 4), _mm_or_si128(_mm_and_si128(pass47, d47), _mm_andnot_si128(pass47, old47)));
+  }
+  return written;
+#else
+  unsigned written = 0;
+  for (int i = 0; i < kDepthTileSize; ++i) {
+    if (!(mask & (1U << i)))
+      continue;
+
+    float q = q0 + float(i) * dqdx;
+    q = q < qMin ? qMin : (q > qMax ? qMax : q);
+    const uint32_t d = encode(q);
+    if (format_ == kDepth16) {
+      uint16_t& stored = static_cast<uint16_t*>(buffer_)[y * pitch_ + x + i];
+      if (!test || d > stored) {
+        stored = static_cast<uint16_t>(d);
+        written |= 1U << i;
+      }
+    } else {
+      uint32_t& stored = static_cast<uint32_t*>(buffer_)[y * pitch_ + x + i];
+      if (!test || d > stored) {
+        stored = d;
+        written |= 1U << i;
+      }
+    }
+  }
+  return written;
+#endif
+}
+
+}// namespace s3d
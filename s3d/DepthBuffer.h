@@ -0,0 +1,109 @@
+#pragma once
+#include <cstdint>
+#include <cassert>
+#include <cstring>
+#include <vector>
+#include <boost/noncopyable.hpp>
+#include "Rasterizer.h"
+
+namespace s3d
+{
+
+enum DepthFormat {
+  kDepth16,
+  kDepth32
+};
+
+//tiles line up with the rasterizer blocks so a block never straddles two tiles
+const int kDepthTileSize = kRasterBlockSize;
+
+//depth values are the normalized reciprocal depth near / z in [0, 1], larger is
+//closer and 0 is the cleared far value. 1/z is linear in screen space so it is
+//interpolated without a divide.
+//kDepth16 stores 16-bit fractions, kDepth32 stores the float bits, which order
+//like unsigned integers for non-negative values. both compare as uint32_t units.
+//
+//every tile keeps a conservative [min, max] of its stored values so whole
+//blocks can be rejected (or accepted) without touching the pixels.
+class DepthBuffer : private boost::noncopyable {
+public:
+  DepthBuffer(int w, int h, DepthFormat format);
+  ~DepthBuffer();
+
+  //resets every pixel to the far value
+  void clear();
+
+  //q is clamped to [0, 1]
+  static uint32_t encode(DepthFormat format, float q) {
+    q = q < 0.f ? 0.f : (q > 1.f ? 1.f : q);
+    if (format == kDepth16)
+      return static_cast<uint32_t>(q * 65535.f + 0.5f);
+
+    uint32_t bits;
+    memcpy(&bits, &q, sizeof(bits));
+    return bits;
+  }
+
+  uint32_t encode(float q) const {
+    return encode(format_, q);
+  }
+
+  uint32_t getDepth(int x, int y) const {
+    assert(x >= 0 && x < width_ && y >= 0 && y < height_);
+    if (format_ == kDepth16)
+      return static_cast<const uint16_t*>(buffer_)[y * pitch_ + x];
+    return static_cast<const uint32_t*>(buffer_)[y * pitch_ + x];
+  }
+
+  //depth tests the kDepthTileSize pixels of row y starting at the tile aligned x.
+  //pixel i gets q0 + i * dqdx clamped to [qMin, qMax]. the ones selected by mask
+  //that are closer than the stored value (or all of them when test is false)
+  //are written, the written pixels are returned as a mask.
+  unsigned testAndWriteRow(int x, int y, unsigned mask, float q0, float dqdx,
+                           float qMin, float qMax, bool test);
+
+  int getTileColumns() const {
+    return tileColumns_;
+  }
+  int getTileRows() const {
+    return tileRows_;
+  }
+
+  uint32_t getTileMin(int tx, int ty) const {
+    return tileMin_[ty * tileColumns_ + tx];
+  }
+  uint32_t getTileMax(int tx, int ty) const {
+    return tileMax_[ty * tileColumns_ + tx];
+  }
+
+  //the range may only grow toward what was actually written, see Renderer
+  void setTileRange(int tx, int ty, uint32_t minDepth, uint32_t maxDepth) {
+    assert(minDepth <= maxDepth);
+    tileMin_[ty * tileColumns_ + tx] = minDepth;
+    tileMax_[ty * tileColumns_ + tx] = maxDepth;
+  }
+
+  DepthFormat getFormat() const {
+    return format_;
+  }
+  int getWidth() const {
+    return width_;
+  }
+  int getHeight() const {
+    return height_;
+  }
+
+private:
+  void* buffer_;
+  DepthFormat format_;
+  int width_;
+  int height_;
+  int pitch_;    //in pixels, whole tiles and kSurfaceAlignment bytes
+
+  int tileColumns_;
+  int tileRows_;
+  std::vector<uint32_t> tileMin_;
+  std::vector<uint32_t> tileMax_;
+};
+
+}// namespace s3d
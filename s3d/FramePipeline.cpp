@@ -0,0 +1,82 @@
+#include "FramePipeline.h"
+
+using namespace std;
+
+namespace s3d
+{
+
+FramePipeline::FramePipeline(const RasterStage& raster)
+  : raster_(raster), submitted_(0), rasterized_(0), quit_(false) {
+  thread_ = thread(&FramePipeline::rasterLoop, this);
+}
+
+FramePipeline::~FramePipeline() {
+  {
+    unique_lock<mutex> lock(mutex_);
+    cond_.wait(lock, [this] { return rasterized_ == submitted_; });
+    quit_ = true;
+  }
+  cond_.notify_all();
+  thread_.join();
+}
+
+CommandBuffer& FramePipeline::beginFrame() {
+  unique_lock<mutex> lock(mutex_);
+  //frame submitted_ - 2 used this buffer
+  cond_.wait(lock, [this] { return rasterized_ >= submitted_ - 1; });
+  rethrowError();
+
+  CommandBuffer& commands = buffers_[submitted_ & 1];
+  commands.clear();
+  return commands;
+}
+
+void FramePipeline::submitFrame() {
+  {
+    lock_guard<mutex> lock(mutex_);
+    ++submitted_;
+  }
+  cond_.notify_all();
+}
+
+void FramePipeline::finish() {
+  unique_lock<mutex> lock(mutex_);
+  cond_.wait(lock, [this] { return rasterized_ == submitted_; });
+  rethrowError();
+}
+
+void FramePipeline::rethrowError() {
+  if (error_) {
+    exception_ptr error = error_;
+    error_ = nullptr;
+    rethrow_exception(error);
+  }
+}
+
+void FramePipeline::rasterLoop() {
+  unique_lock<mutex> lock(mutex_);
+  for (;;) {
+    cond_.wait(lock, [this] { return quit_ || rasterized_ < submitted_; });
+    if (rasterized_ == submitted_)
+      return;
+
+    //frames behind an error not reported yet are dropped, not drawn
+    const int frame = rasterized_;
+    if (!error_) {
+      lock.unlock();
+      try {
+        raster_(buffers_[frame & 1], frame);
+      } catch (...) {
+        lock.lock();
+        error_ = current_exception();
+        lock.unlock();
+      }
+      lock.lock();
+    }
+
+    ++rasterized_;
+    cond_.notify_all();
+  }
+}
+
+}// namespace s3d
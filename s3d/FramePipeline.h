@@ -0,0 +1,62 @@
+#pragma once
+#include "CommandBuffer.h"
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <boost/noncopyable.hpp>
+
+namespace s3d
+{
+
+//two stage frame pipeline over a pair of CommandBuffers. the calling thread
+//runs the geometry of frame N + 1 (transform, cull, record) into one buffer
+//while a raster thread executes frame N from the other, so a frame costs about
+//the slower stage instead of both. a recorded buffer is not touched again by
+//the geometry stage until the raster stage is done with it.
+class FramePipeline : private boost::noncopyable {
+public:
+  //called on the raster thread once per submitted frame, in order. frame counts
+  //from 0. an exception thrown from it is rethrown by the next beginFrame() or
+  //finish(), the frames submitted until then are dropped
+  typedef std::function<void(const CommandBuffer& commands, int frame)> RasterStage;
+
+  explicit FramePipeline(const RasterStage& raster);
+
+  //rasterizes what was submitted, then stops the raster thread
+  ~FramePipeline();
+
+  //the cleared buffer for the next frame. waits while the raster thread still
+  //executes the frame before the last one, which used the same buffer
+  CommandBuffer& beginFrame();
+
+  //queues the buffer from beginFrame() for the raster thread and returns at once
+  void submitFrame();
+
+  //waits until every submitted frame is rasterized
+  void finish();
+
+  //frames submitted so far
+  int getFrameCount() const {
+    return submitted_;
+  }
+
+private:
+  void rasterLoop();
+  void rethrowError();
+
+  RasterStage raster_;
+  CommandBuffer buffers_[2];   //frame n records into buffers_[n & 1]
+
+  std::thread thread_;
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  int submitted_;
+  int rasterized_;
+  bool quit_;
+  std::exception_ptr error_;
+};
+
+}// namespace s3d
@@ -0,0 +1,71 @@
+#include "FrameTiles.h"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace s3d
+{
+
+FrameTiles::FrameTiles(const RendererBuffer& buffer)
+  : buffer_(buffer), clearColor_(0) {
+  columns_ = (buffer.getWidth() + kFrameTileSize - 1) / kFrameTileSize;
+  rows_ = (buffer.getHeight() + kFrameTileSize - 1) / kFrameTileSize;
+  //the initial contents are unknown, the first frame clears every tile once
+  flags_.resize(columns_ * rows_, 0);
+}
+
+void FrameTiles::beginFrame(uint32_t clearColor) {
+  const bool sameColor = clearColor == clearColor_;
+  clearColor_ = clearColor;
+  for (auto& flags : flags_) {
+    flags = (sameColor && (flags & kTileHoldsClear)) ? uint8_t(kTileReady | kTileHoldsClear) : uint8_t(0);
+  }
+}
+
+bool FrameTiles::endFrame(RectI& changed) {
+  //tiles that still show the previous frame change as well once they are cleared
+  const bool any = tileBounds(true, changed);
+  for (int ty = 0; ty < rows_; ++ty) {
+    for (int tx = 0; tx < columns_; ++tx) {
+      if (!(flags_[ty * columns_ + tx] & kTileReady))
+        clearTile(tx, ty);
+    }
+  }
+  return any;
+}
+
+bool FrameTiles::getWrittenRect(RectI& rect) const {
+  return tileBounds(false, rect);
+}
+
+void FrameTiles::clearTile(int tx, int ty) {
+  buffer_.fillRect(RectI(tx * kFrameTileSize, ty * kFrameTileSize, kFrameTileSize - 1, kFrameTileSize - 1), clearColor_);
+  flags_[ty * columns_ + tx] |= kTileReady | kTileHoldsClear;
+}
+
+bool FrameTiles::tileBounds(bool withStale, RectI& rect) const {
+  int minX = columns_, minY = rows_, maxX = -1, maxY = -1;
+  for (int ty = 0; ty < rows_; ++ty) {
+    for (int tx = 0; tx < columns_; ++tx) {
+      const uint8_t flags = flags_[ty * columns_ + tx];
+      if (!(flags & kTileWritten) && !(withStale && !(flags & kTileReady)))
+        continue;
+
+      minX = min(minX, tx);
+      maxX = max(maxX, tx);
+      minY = min(minY, ty);
+      maxY = max(maxY, ty);
+    }
+  }
+  if (maxX < 0)
+    return false;
+
+  const int left = minX * kFrameTileSize, top = minY * kFrameTileSize;
+  const int right = min((maxX + 1) * kFrameTileSize, buffer_.getWidth()) - 1;
+  const int bottom = min((maxY + 1) * kFrameTileSize, buffer_.getHeight()) - 1;
+  rect = RectI(left, top, right - left, bottom - top);
+  return true;
+}
+
+}// namespace s3d
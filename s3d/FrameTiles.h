@@ -0,0 +1,71 @@
+#pragma once
+#include "Renderer.h"
+
+#include <cstdint>
+#include <vector>
+#include <boost/noncopyable.hpp>
+
+namespace s3d
+{
+
+//one BinnedRenderer tile, so a tile's flags only ever change on the thread drawing it
+const int kFrameTileBits = 6;
+const int kFrameTileSize = 1 << kFrameTileBits;
+
+//lazy clear of a color buffer in kFrameTileSize^2 tiles.
+//beginFrame() writes no pixels, a tile is cleared the first time a Renderer
+//draws into it (touch), and endFrame() clears only the tiles still showing the
+//previous frame. tiles that were clear and stayed untouched cost nothing.
+//a Renderer touches the tiles of its fills, spans, pixels and clipped lines,
+//anything writing the buffer directly has to call touch() itself.
+class FrameTiles : private boost::noncopyable {
+public:
+  explicit FrameTiles(const RendererBuffer& buffer);
+
+  void beginFrame(uint32_t clearColor);
+
+  //[x0, x1] x [y0, y1] inside the buffer is about to be written
+  void touch(int x0, int y0, int x1, int y1) {
+    assert(x0 >= 0 && y0 >= 0 && x1 < buffer_.getWidth() && y1 < buffer_.getHeight());
+    for (int ty = y0 >> kFrameTileBits; ty <= (y1 >> kFrameTileBits); ++ty) {
+      for (int tx = x0 >> kFrameTileBits; tx <= (x1 >> kFrameTileBits); ++tx) {
+        uint8_t& flags = flags_[ty * columns_ + tx];
+        if (!(flags & kTileReady))
+          clearTile(tx, ty);
+        flags = static_cast<uint8_t>((flags | kTileWritten) & ~kTileHoldsClear);
+      }
+    }
+  }
+
+  //clears the stale tiles. changed gets the bounds (right/bottom inclusive) of
+  //every tile whose pixels differ from the last endFrame, false when there are none
+  bool endFrame(RectI& changed);
+
+  //bounds of the tiles written since beginFrame, false when there are none
+  bool getWrittenRect(RectI& rect) const;
+
+  int getColumns() const {
+    return columns_;
+  }
+  int getRows() const {
+    return rows_;
+  }
+
+private:
+  enum {
+    kTileReady = 0x1,       //holds the clear color or this frame's pixels
+    kTileWritten = 0x2,     //touched since beginFrame
+    kTileHoldsClear = 0x4   //nothing but the clear color
+  };
+
+  void clearTile(int tx, int ty);
+  bool tileBounds(bool withStale, RectI& rect) const;
+
+  RendererBuffer buffer_;
+  int columns_;
+  int rows_;
+  uint32_t clearColor_;
+  std::vector<uint8_t> flags_;
+};
+
+}// namespace s3d
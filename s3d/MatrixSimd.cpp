@@ -0,0 +1,392 @@
+#include "MatrixSimd.h"
+#include "Simd.h"
+#include "math/Math.h"
+
+namespace s3d
+{
+
+static_assert(sizeof(Matrix4x4F) == 16 * sizeof(float) && sizeof(Point4F) == 4 * sizeof(float),
+              "MatrixSimd needs packed float matrices and points");
+static_assert(sizeof(Matrix4x4FD) == 16 * sizeof(double) && sizeof(Point4FD) == 4 * sizeof(double),
+              "MatrixSimd needs packed double matrices and points");
+
+namespace
+{
+
+template<typename T>
+void transformVerticesScalar(const T* m, const T* x, const T* y, const T* z,
+                             T* outX, T* outY, T* outZ, T* outW, int count, bool divide) {
+  for (int i = 0; i < count; ++i) {
+    const T vx = x[i], vy = y[i], vz = z[i];
+    T rx = vx * m[0] + vy * m[4] + vz * m[8] + m[12];
+    T ry = vx * m[1] + vy * m[5] + vz * m[9] + m[13];
+    T rz = vx * m[2] + vy * m[6] + vz * m[10] + m[14];
+    const T rw = vx * m[3] + vy * m[7] + vz * m[11] + m[15];
+    if (divide) {
+      rx /= rw;
+      ry /= rw;
+      rz /= rw;
+    } else {
+      outW[i] = rw;
+    }
+
+    outX[i] = rx;
+    outY[i] = ry;
+    outZ[i] = rz;
+  }
+}
+
+template<typename T>
+void transformPointsScalar(const T* m, const T* in, T* out, int count, bool divide) {
+  for (int i = 0; i < count * 4; i += 4) {
+    transformVerticesScalar(m, in + i, in + i + 1, in + i + 2, out + i, out + i + 1, out + i + 2, out + i + 3, 1, divide);
+    if (divide)
+      out[i + 3] = T(1);
+  }
+}
+
+#ifdef S3D_SSE2
+//four vertices per register, every matrix element broadcast once up front
+void transformVerticesFSSE2(const float* m, const float* x, const float* y, const float* z,
+                            float* outX, float* outY, float* outZ, float* outW, int count, bool divide) {
+  __m128 mm[16];
+  for (int i = 0; i < 16; ++i) {
+    mm[i] = _mm_set1_ps(m[i]);
+  }
+
+  int i = 0;
+  for (; i + 4 <= count; i += 4) {
+    const __m128 vx = _mm_loadu_ps(x + i), vy = _mm_loadu_ps(y + i), vz = _mm_loadu_ps(z + i);
+    __m128 r[4];
+    for (int c = 0; c < 4; ++c) {
+      r[c] = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, mm[c]), _mm_mul_ps(vy, mm[4 + c])),
+                                   _mm_mul_ps(vz, mm[8 + c])), mm[12 + c]);
+    }
+
+    if (divide) {
+      r[0] = _mm_div_ps(r[0], r[3]);
+      r[1] = _mm_div_ps(r[1], r[3]);
+      r[2] = _mm_div_ps(r[2], r[3]);
+    } else {
+      _mm_storeu_ps(outW + i, r[3]);
+    }
+
+    _mm_storeu_ps(outX + i, r[0]);
+    _mm_storeu_ps(outY + i, r[1]);
+    _mm_storeu_ps(outZ + i, r[2]);
+  }
+
+  transformVerticesScalar(m, x + i, y + i, z + i, outX + i, outY + i, outZ + i,
+                          divide ? outW : outW + i, count - i, divide);
+}
+
+void transformVerticesFDSSE2(const double* m, const double* x, const double* y, const double* z,
+                             double* outX, double* outY, double* outZ, double* outW, int count, bool divide) {
+  __m128d mm[16];
+  for (int i = 0; i < 16; ++i) {
+    mm[i] = _mm_set1_pd(m[i]);
+  }
+
+  int i = 0;
+  for (; i + 2 <= count; i += 2) {
+    const __m128d vx = _mm_loadu_pd(x + i), vy = _mm_loadu_pd(y + i), vz = _mm_loadu_pd(z + i);
+    __m128d r[4];
+    for (int c = 0; c < 4; ++c) {
+      r[c] = _mm_add_pd(_mm_add_pd(_mm_add_pd(_mm_mul_pd(vx, mm[c]), _mm_mul_pd(vy, mm[4 + c])),
+                                   _mm_mul_pd(vz, mm[8 + c])), mm[12 + c]);
+    }
+
+    if (divide) {
+      r[0] = _mm_div_pd(r[0], r[3]);
+      r[1] = _mm_div_pd(r[1], r[3]);
+      r[2] = _mm_div_pd(r[2], r[3]);
+    } else {
+      _mm_storeu_pd(outW + i, r[3]);
+    }
+
+    _mm_storeu_pd(outX + i, r[0]);
+    _mm_storeu_pd(outY + i, r[1]);
+    _mm_storeu_pd(outZ + i, r[2]);
+  }
+
+  transformVerticesScalar(m, x + i, y + i, z + i, outX + i, outY + i, outZ + i,
+                          divide ? outW : outW + i, count - i, divide);
+}
+
+void transformPointsFSSE2(const float* m, const float* in, float* out, int count, bool divide) {
+  __m128 mm[16];
+  for (int i = 0; i < 16; ++i) {
+    mm[i] = _mm_set1_ps(m[i]);
+  }
+
+  int i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m128 vx = _mm_loadu_ps(in + i * 4), vy = _mm_loadu_ps(in + i * 4 + 4);
+    __m128 vz = _mm_loadu_ps(in + i * 4 + 8), vw = _mm_loadu_ps(in + i * 4 + 12);
+    _MM_TRANSPOSE4_PS(vx, vy, vz, vw);
+
+    __m128 r[4];
+    for (int c = 0; c < 4; ++c) {
+      r[c] = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, mm[c]), _mm_mul_ps(vy, mm[4 + c])),
+                                   _mm_mul_ps(vz, mm[8 + c])), mm[12 + c]);
+    }
+
+    if (divide) {
+      r[0] = _mm_div_ps(r[0], r[3]);
+      r[1] = _mm_div_ps(r[1], r[3]);
+      r[2] = _mm_div_ps(r[2], r[3]);
+      r[3] = _mm_set1_ps(1.f);
+    }
+
+    _MM_TRANSPOSE4_PS(r[0], r[1], r[2], r[3]);
+    for (int c = 0; c < 4; ++c) {
+      _mm_storeu_ps(out + i * 4 + c * 4, r[c]);
+    }
+  }
+
+  transformPointsScalar(m, in + i * 4, out + i * 4, count - i, divide);
+}
+
+//two points, each in two registers (x y and z w)
+void transformPointsFDSSE2(const double* m, const double* in, double* out, int count, bool divide) {
+  __m128d mm[16];
+  for (int i = 0; i < 16; ++i) {
+    mm[i] = _mm_set1_pd(m[i]);
+  }
+
+  int i = 0;
+  for (; i + 2 <= count; i += 2) {
+    const double* p = in + i * 4;
+    const __m128d xy0 = _mm_loadu_pd(p), zw0 = _mm_loadu_pd(p + 2);
+    const __m128d xy1 = _mm_loadu_pd(p + 4), zw1 = _mm_loadu_pd(p + 6);
+    const __m128d vx = _mm_unpacklo_pd(xy0, xy1), vy = _mm_unpackhi_pd(xy0, xy1), vz = _mm_unpacklo_pd(zw0, zw1);
+
+    __m128d r[4];
+    for (int c = 0; c < 4; ++c) {
+      r[c] = _mm_add_pd(_mm_add_pd(_mm_add_pd(_mm_mul_pd(vx, mm[c]), _mm_mul_pd(vy, mm[4 + c])),
+                                   _mm_mul_pd(vz, mm[8 + c])), mm[12 + c]);
+    }
+
+    if (divide) {
+      r[0] = _mm_div_pd(r[0], r[3]);
+      r[1] = _mm_div_pd(r[1], r[3]);
+      r[2] = _mm_div_pd(r[2], r[3]);
+      r[3] = _mm_set1_pd(1.);
+    }
+
+    double* o = out + i * 4;
+    _mm_storeu_pd(o, _mm_unpacklo_pd(r[0], r[1]));
+    _mm_storeu_pd(o + 2, _mm_unpacklo_pd(r[2], r[3]));
+    _mm_storeu_pd(o + 4, _mm_unpackhi_pd(r[0], r[1]));
+    _mm_storeu_pd(o + 6, _mm_unpackhi_pd(r[2], r[3]));
+  }
+
+  transformPointsScalar(m, in + i * 4, out + i * 4, count - i, divide);
+}
+#endif
+
+#ifdef S3D_AVX2
+S3D_TARGET_AVX2 void transformVerticesFAVX2(const float* m, const float* x, const float* y, const float* z,
+                                            float* outX, float* outY, float* outZ, float* outW, int count, bool divide) {
+  __m256 mm[16];
+  for (int i = 0; i < 16; ++i) {
+    mm[i] = _mm256_set1_ps(m[i]);
+  }
+
+  int i = 0;
+  for (; i + 8 <= count; i += 8) {
+    const __m256 vx = _mm256_loadu_ps(x + i), vy = _mm256_loadu_ps(y + i), vz = _mm256_loadu_ps(z + i);
+    __m256 r[4];
+    for (int c = 0; c < 4; ++c) {
+      r[c] = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(vx, mm[c]), _mm256_mul_ps(vy, mm[4 + c])),
+                                         _mm256_mul_ps(vz, mm[8 + c])), mm[12 + c]);
+    }
+
+    if (divide) {
+      r[0] = _mm256_div_ps(r[0], r[3]);
+      r[1] = _mm256_div_ps(r[1], r[3]);
+      r[2] = _mm256_div_ps(r[2], r[3]);
+    } else {
+      _mm256_storeu_ps(outW + i, r[3]);
+    }
+
+    _mm256_storeu_ps(outX + i, r[0]);
+    _mm256_storeu_ps(outY + i, r[1]);
+    _mm256_storeu_ps(outZ + i, r[2]);
+  }
+
+  transformVerticesFSSE2(m, x + i, y + i, z + i, outX + i, outY + i, outZ + i,
+                         divide ? outW : outW + i, count - i, divide);
+}
+
+S3D_TARGET_AVX2 void transformVerticesFDAVX2(const double* m, const double* x, const double* y, const double* z,
+                                             double* outX, double* outY, double* outZ, double* outW, int count, bool divide) {
+  __m256d mm[16];
+  for (int i = 0; i < 16; ++i) {
+    mm[i] = _mm256_set1_pd(m[i]);
+  }
+
+  int i = 0;
+  for (; i + 4 <= count; i += 4) {
+    const __m256d vx = _mm256_loadu_pd(x + i), vy = _mm256_loadu_pd(y + i), vz = _mm256_loadu_pd(z + i);
+    __m256d r[4];
+    for (int c = 0; c < 4; ++c) {
+      r[c] = _mm256_add_pd(_mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(vx, mm[c]), _mm256_mul_pd(vy, mm[4 + c])),
+                                         _mm256_mul_pd(vz, mm[8 + c])), mm[12 + c]);
+    }
+
+    if (divide) {
+      r[0] = _mm256_div_pd(r[0], r[3]);
+      r[1] = _mm256_div_pd(r[1], r[3]);
+      r[2] = _mm256_div_pd(r[2], r[3]);
+    } else {
+      _mm256_storeu_pd(outW + i, r[3]);
+    }
+
+    _mm256_storeu_pd(outX + i, r[0]);
+    _mm256_storeu_pd(outY + i, r[1]);
+    _mm256_storeu_pd(outZ + i, r[2]);
+  }
+
+  transformVerticesFDSSE2(m, x + i, y + i, z + i, outX + i, outY + i, outZ + i,
+                          divide ? outW : outW + i, count - i, divide);
+}
+
+//eight points, two per register (p0 p4, p1 p5, ...), transposed within the lanes
+S3D_TARGET_AVX2 void transformPointsFAVX2(const float* m, const float* in, float* out, int count, bool divide) {
+  __m256 mm[16];
+  for (int i = 0; i < 16; ++i) {
+    mm[i] = _mm256_set1_ps(m[i]);
+  }
+
+  int i = 0;
+  for (; i + 8 <= count; i += 8) {
+    const float* p = in + i * 4;
+    const __m256 p01 = _mm256_loadu_ps(p), p23 = _mm256_loadu_ps(p + 8);
+    const __m256 p45 = _mm256_loadu_ps(p + 16), p67 = _mm256_loadu_ps(p + 24);
+    const __m256 p04 = _mm256_permute2f128_ps(p01, p45, 0x20), p15 = _mm256_permute2f128_ps(p01, p45, 0x31);
+    const __m256 p26 = _mm256_permute2f128_ps(p23, p67, 0x20), p37 = _mm256_permute2f128_ps(p23, p67, 0x31);
+    //x0 x1 y0 y1, x2 x3 y2 y3, z0 z1 w0 w1, z2 z3 w2 w3 and the same for points 4 to 7
+    const __m256 xy01 = _mm256_unpacklo_ps(p04, p15), xy23 = _mm256_unpacklo_ps(p26, p37);
+    const __m256 zw01 = _mm256_unpackhi_ps(p04, p15), zw23 = _mm256_unpackhi_ps(p26, p37);
+    const __m256 vx = _mm256_shuffle_ps(xy01, xy23, 0x44);
+    const __m256 vy = _mm256_shuffle_ps(xy01, xy23, 0xee);
+    const __m256 vz = _mm256_shuffle_ps(zw01, zw23, 0x44);
+
+    __m256 r[4];
+    for (int c = 0; c < 4; ++c) {
+      r[c] = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(vx, mm[c]), _mm256_mul_ps(vy, mm[4 + c])),
+                                         _mm256_mul_ps(vz, mm[8 + c])), mm[12 + c]);
+    }
+
+    if (divide) {
+      r[0] = _mm256_div_ps(r[0], r[3]);
+      r[1] = _mm256_div_ps(r[1], r[3]);
+      r[2] = _mm256_div_ps(r[2], r[3]);
+      r[3] = _mm256_set1_ps(1.f);
+    }
+
+    const __m256 rxy01 = _mm256_unpacklo_ps(r[0], r[1]), rzw01 = _mm256_unpacklo_ps(r[2], r[3]);
+    const __m256 rxy23 = _mm256_unpackhi_ps(r[0], r[1]), rzw23 = _mm256_unpackhi_ps(r[2], r[3]);
+    const __m256 q04 = _mm256_shuffle_ps(rxy01, rzw01, 0x44), q15 = _mm256_shuffle_ps(rxy01, rzw01, 0xee);
+    const __m256 q26 = _mm256_shuffle_ps(rxy23, rzw23, 0x44), q37 = _mm256_shuffle_ps(rxy23, rzw23, 0xee);
+    float* o = out + i * 4;
+    _mm256_storeu_ps(o, _mm256_permute2f128_ps(q04, q15, 0x20));
+    _mm256_storeu_ps(o + 8, _mm256_permute2f128_ps(q26, q37, 0x20));
+    _mm256_storeu_ps(o + 16, _mm256_permute2f128_ps(q04, q15, 0x31));
+    _mm256_storeu_ps(o + 24, _mm256_permute2f128_ps(q26, q37, 0x31));
+  }
+
+  transformPointsFSSE2(m, in + i * 4, out + i * 4, count - i, divide);
+}
+
+//four points, one per register, transposed to x, y, z and back
+S3D_TARGET_AVX2 void transformPointsFDAVX2(const double* m, const double* in, double* out, int count, bool divide) {
+  __m256d mm[16];
+  for (int i = 0; i < 16; ++i) {
+    mm[i] = _mm256_set1_pd(m[i]);
+  }
+
+  int i = 0;
+  for (; i + 4 <= count; i += 4) {
+    const double* p = in + i * 4;
+    const __m256d p0 = _mm256_loadu_pd(p), p1 = _mm256_loadu_pd(p + 4);
+    const __m256d p2 = _mm256_loadu_pd(p + 8), p3 = _mm256_loadu_pd(p + 12);
+    //x0 x1 z0 z1, y0 y1 w0 w1, and the same for points 2 and 3
+    const __m256d xz01 = _mm256_unpacklo_pd(p0, p1), yw01 = _mm256_unpackhi_pd(p0, p1);
+    const __m256d xz23 = _mm256_unpacklo_pd(p2, p3), yw23 = _mm256_unpackhi_pd(p2, p3);
+    const __m256d vx = _mm256_permute2f128_pd(xz01, xz23, 0x20);
+    const __m256d vy = _mm256_permute2f128_pd(yw01, yw23, 0x20);
+    const __m256d vz = _mm256_permute2f128_pd(xz01, xz23, 0x31);
+
+    __m256d r[4];
+    for (int c = 0; c < 4; ++c) {
+      r[c] = _mm256_add_pd(_mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(vx, mm[c]), _mm256_mul_pd(vy, mm[4 + c])),
+                                         _mm256_mul_pd(vz, mm[8 + c])), mm[12 + c]);
+    }
+
+    if (divide) {
+      r[0] = _mm256_div_pd(r[0], r[3]);
+      r[1] = _mm256_div_pd(r[1], r[3]);
+      r[2] = _mm256_div_pd(r[2], r[3]);
+      r[3] = _mm256_set1_pd(1.);
+    }
+
+    //x0 y0 x2 y2, x1 y1 x3 y3, z0 w0 z2 w2, z1 w1 z3 w3
+    const __m256d xy02 = _mm256_unpacklo_pd(r[0], r[1]), xy13 = _mm256_unpackhi_pd(r[0], r[1]);
+    const __m256d zw02 = _mm256_unpacklo_pd(r[2], r[3]), zw13 = _mm256_unpackhi_pd(r[2], r[3]);
+    double* o = out + i * 4;
+    _mm256_storeu_pd(o, _mm256_permute2f128_pd(xy02, zw02, 0x20));
+    _mm256_storeu_pd(o + 4, _mm256_permute2f128_pd(xy13, zw13, 0x20));
+    _mm256_storeu_pd(o + 8, _mm256_permute2f128_pd(xy02, zw02, 0x31));
+    _mm256_storeu_pd(o + 12, _mm256_permute2f128_pd(xy13, zw13, 0x31));
+  }
+
+  transformPointsFDSSE2(m, in + i * 4, out + i * 4, count - i, divide);
+}
+#endif
+
+struct MatrixKernels {
+  TransformVerticesF verticesF_;
+  TransformVerticesFD verticesFD_;
+  TransformPointsF pointsF_;
+  TransformPointsFD pointsFD_;
+};
+
+MatrixKernels matrixKernelsFor(SimdLevel level) {
+  switch (level) {
+#ifdef S3D_AVX2
+  case kSimdAVX2:
+    return {transformVerticesFAVX2, transformVerticesFDAVX2, transformPointsFAVX2, transformPointsFDAVX2};
+#endif
+#ifdef S3D_SSE2
+  case kSimdSSE2:
+    return {transformVerticesFSSE2, transformVerticesFDSSE2, transformPointsFSSE2, transformPointsFDSSE2};
+#endif
+  default:
+    return {transformVerticesScalar<float>, transformVerticesScalar<double>,
+            transformPointsScalar<float>, transformPointsScalar<double>};
+  }
+}
+
+}
+
+TransformVerticesF g_transformVerticesF = matrixKernelsFor(detectSimdLevel()).verticesF_;
+TransformVerticesFD g_transformVerticesFD = matrixKernelsFor(detectSimdLevel()).verticesFD_;
+TransformPointsF g_transformPointsF = matrixKernelsFor(detectSimdLevel()).pointsF_;
+TransformPointsFD g_transformPointsFD = matrixKernelsFor(detectSimdLevel()).pointsFD_;
+
+SimdLevel selectMatrixSimd(SimdLevel level) {
+  const SimdLevel supported = detectSimdLevel();
+  if (level > supported)
+    level = supported;
+
+  const MatrixKernels kernels = matrixKernelsFor(level);
+  g_transformVerticesF = kernels.verticesF_;
+  g_transformVerticesFD = kernels.verticesFD_;
+  g_transformPointsF = kernels.pointsF_;
+  g_transformPointsFD = kernels.pointsFD_;
+  return level;
+}
+
+}// namespace s3d
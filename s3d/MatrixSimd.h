@@ -0,0 +1,53 @@
+#pragma once
+#include "CpuFeatures.h"
+#include "math/Math.h"
+
+namespace s3d
+{
+
+//batch vertex transforms for the geometry stages, picked for the cpu at runtime.
+//single products and Point4 * Matrix transforms stay inline in Matrix.h and Math.h.
+//matrices are 16 values row after row, points x, y, z, w. every path does the
+//multiplies and adds in the same order as the scalar one, so they agree exactly
+
+//(x, y, z, 1) * m for count vertices held as separate x, y and z arrays. with
+//divide x, y and z come out divided by w and outW may be null, without it w is
+//written to outW. the outputs may be the inputs
+typedef void (*TransformVerticesF)(const float* m, const float* x, const float* y, const float* z,
+                                   float* outX, float* outY, float* outZ, float* outW, int count, bool divide);
+typedef void (*TransformVerticesFD)(const double* m, const double* x, const double* y, const double* z,
+                                    double* outX, double* outY, double* outZ, double* outW, int count, bool divide);
+
+//the same for count points stored x, y, z, w one after another, their w taken as
+//1. they are turned into arrays in registers. out may be in, w is 1 with divide
+typedef void (*TransformPointsF)(const float* m, const float* in, float* out, int count, bool divide);
+typedef void (*TransformPointsFD)(const double* m, const double* in, double* out, int count, bool divide);
+
+//the kernels picked for this cpu at startup
+extern TransformVerticesF g_transformVerticesF;
+extern TransformVerticesFD g_transformVerticesFD;
+extern TransformPointsF g_transformPointsF;
+extern TransformPointsFD g_transformPointsFD;
+
+inline void transformVertices(const Matrix4x4F& m, const float* x, const float* y, const float* z,
+                              float* outX, float* outY, float* outZ, float* outW, int count, bool divide) {
+  g_transformVerticesF(m[0], x, y, z, outX, outY, outZ, outW, count, divide);
+}
+
+inline void transformVertices(const Matrix4x4FD& m, const double* x, const double* y, const double* z,
+                              double* outX, double* outY, double* outZ, double* outW, int count, bool divide) {
+  g_transformVerticesFD(m[0], x, y, z, outX, outY, outZ, outW, count, divide);
+}
+
+inline void transformVertices(const Matrix4x4F& m, const Point4F* in, Point4F* out, int count, bool divide) {
+  g_transformPointsF(m[0], &in->x_, &out->x_, count, divide);
+}
+
+inline void transformVertices(const Matrix4x4FD& m, const Point4FD* in, Point4FD* out, int count, bool divide) {
+  g_transformPointsFD(m[0], &in->x_, &out->x_, count, divide);
+}
+
+//forces a code path as selectSpanFill does, returns the level in use
+SimdLevel selectMatrixSimd(SimdLevel level);
+
+}// namespace s3d
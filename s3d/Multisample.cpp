@@ -0,0 +1,123 @@
+#include "Multisample.h"
+#include "Simd.h"
+
+namespace s3d
+{
+
+static_assert(kMultisampleCount == 4, "the resolve averages with a shift by 2");
+
+namespace
+{
+
+typedef void (*ResolveRowFunc)(uint32_t* dst, const uint32_t* const samples[kMultisampleCount], int count);
+
+void resolveRowScalar(uint32_t* dst, const uint32_t* const samples[kMultisampleCount], int count) {
+  for (int x = 0; x < count; ++x) {
+    uint32_t p = 0;
+    for (int c = 0; c < 32; c += 8) {
+      uint32_t sum = 2;
+      for (int s = 0; s < kMultisampleCount; ++s) {
+        sum += (samples[s][x] >> c) & 0xFF;
+      }
+      p |= (sum >> 2) << c;
+    }
+    dst[x] = p;
+  }
+}
+
+#ifdef S3D_SSE2
+//4 pixels per step, channels widened to 16 bits so the sum of 4 samples cannot overflow
+void resolveRowSSE2(uint32_t* dst, const uint32_t* const samples[kMultisampleCount], int count) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i round = _mm_set1_epi16(2);
+
+  int x = 0;
+  for (; x + 4 <= count; x += 4) {
+    __m128i lo = round, hi = round;
+    for (int s = 0; s < kMultisampleCount; ++s) {
+      const __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(samples[s] + x));
+      lo = _mm_add_epi16(lo, _mm_unpacklo_epi8(p, zero));
+      hi = _mm_add_epi16(hi, _mm_unpackhi_epi8(p, zero));
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x),
+                     _mm_packus_epi16(_mm_srli_epi16(lo, 2), _mm_srli_epi16(hi, 2)));
+  }
+
+  const uint32_t* const tail[kMultisampleCount] = {samples[0] + x, samples[1] + x, samples[2] + x, samples[3] + x};
+  resolveRowScalar(dst + x, tail, count - x);
+}
+#endif
+
+#ifdef S3D_AVX2
+//8 pixels per step, the unpacks and packs stay within 128 bit lanes so the order is kept
+S3D_TARGET_AVX2 void resolveRowAVX2(uint32_t* dst, const uint32_t* const samples[kMultisampleCount], int count) {
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i round = _mm256_set1_epi16(2);
+
+  int x = 0;
+  for (; x + 8 <= count; x += 8) {
+    __m256i lo = round, hi = round;
+    for (int s = 0; s < kMultisampleCount; ++s) {
+      const __m256i p = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(samples[s] + x));
+      lo = _mm256_add_epi16(lo, _mm256_unpacklo_epi8(p, zero));
+      hi = _mm256_add_epi16(hi, _mm256_unpackhi_epi8(p, zero));
+    }
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x),
+                        _mm256_packus_epi16(_mm256_srli_epi16(lo, 2), _mm256_srli_epi16(hi, 2)));
+  }
+
+  const uint32_t* const tail[kMultisampleCount] = {samples[0] + x, samples[1] + x, samples[2] + x, samples[3] + x};
+  resolveRowSSE2(dst + x, tail, count - x);
+}
+#endif
+
+ResolveRowFunc resolveRowFor(SimdLevel level) {
+  switch (level) {
+#ifdef S3D_AVX2
+  case kSimdAVX2:
+    return resolveRowAVX2;
+#endif
+#ifdef S3D_SSE2
+  case kSimdSSE2:
+    return resolveRowSSE2;
+#endif
+  default:
+    return resolveRowScalar;
+  }
+}
+
+ResolveRowFunc g_resolveRow = resolveRowFor(detectSimdLevel());
+
+}
+
+MultisampleBuffer::MultisampleBuffer(int w, int h) {
+  for (int s = 0; s < kMultisampleCount; ++s) {
+    planes_[s].reset(new OffscreenRendererBuffer(w, h));
+  }
+}
+
+void MultisampleBuffer::clear(uint32_t p) {
+  for (int s = 0; s < kMultisampleCount; ++s) {
+    planes_[s]->clear(p);
+  }
+}
+
+void MultisampleBuffer::resolve(RendererBuffer& dst) const {
+  assert(dst.getWidth() == getWidth() && dst.getHeight() == getHeight());
+  for (int y = 0; y < getHeight(); ++y) {
+    const uint32_t* const samples[kMultisampleCount] = {planes_[0]->getRow(y), planes_[1]->getRow(y),
+                                                        planes_[2]->getRow(y), planes_[3]->getRow(y)};
+    g_resolveRow(dst.getRow(y), samples, getWidth());
+  }
+}
+
+SimdLevel selectMultisampleResolve(SimdLevel level) {
+  const SimdLevel supported = detectSimdLevel();
+  if (level > supported)
+    level = supported;
+
+  g_resolveRow = resolveRowFor(level);
+  return level;
+}
+
+}// namespace s3d
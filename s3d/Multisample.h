@@ -0,0 +1,44 @@
+#pragma once
+#include "OffscreenBuffer.h"
+#include "Rasterizer.h"
+#include "CpuFeatures.h"
+
+#include <memory>
+#include <boost/noncopyable.hpp>
+
+namespace s3d
+{
+
+//kMultisampleCount color planes, plane s holds sample s of every pixel (see
+//Rasterizer.h for the sample positions). a Renderer with a multisample buffer
+//shades each covered pixel once and writes the color to the samples it covers,
+//resolve() then averages the planes into the color buffer
+class MultisampleBuffer : private boost::noncopyable {
+public:
+  MultisampleBuffer(int w, int h);
+
+  RendererBuffer& getSampleBuffer(int s) {
+    assert(s >= 0 && s < kMultisampleCount);
+    return *planes_[s];
+  }
+
+  void clear(uint32_t p);
+
+  //dst[x, y] = the per channel rounded average of the samples, dst must be the same size
+  void resolve(RendererBuffer& dst) const;
+
+  int getWidth() const {
+    return planes_[0]->getWidth();
+  }
+  int getHeight() const {
+    return planes_[0]->getHeight();
+  }
+
+private:
+  std::unique_ptr<OffscreenRendererBuffer> planes_[kMultisampleCount];
+};
+
+//forces a resolve code path as selectSpanFill does, returns the level in use
+SimdLevel selectMultisampleResolve(SimdLevel level);
+
+}// namespace s3d
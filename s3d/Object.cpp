@@ -1,27 +1,69 @@
 #include "Object.h"
+#include "MatrixSimd.h"
 #include "math/Math.h"
 
+#include <algorithm>
+
 namespace s3d
 {
 
+  template<typename T>
+  const std::vector<uint32_t>& BasicObject<T>::getEdgeList() {
+    if (edgeListValid_)
+      return edgeList_;
+
+    //an edge is the key (smaller index << 32 | larger index), duplicates sort next to each other
+    std::vector<uint64_t> keys;
+    keys.reserve(polygons_.size() * 4);
+    for (const auto& poly : polygons_) {
+      for (size_t i = 0; i < poly.size(); ++i) {
+        const uint32_t a = poly[i];
+        const uint32_t b = poly[(i + 1) % poly.size()];
+        keys.push_back(a < b ? (uint64_t(a) << 32 | b) : (uint64_t(b) << 32 | a));
+      }
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+    edgeList_.clear();
+    edgeList_.reserve(keys.size() * 2);
+    for (uint64_t key : keys) {
+      edgeList_.push_back(static_cast<uint32_t>(key >> 32));
+      edgeList_.push_back(static_cast<uint32_t>(key));
+    }
+
+    edgeListValid_ = true;
+    return edgeList_;
+  }
+
+
+  template class BasicObject<float>;
+  template class BasicObject<double>;
 
-  void addToWorld(Object& obj, double x, double y, double z) {
+  template<typename T>
+  void addToWorld(BasicObject<T>& obj, double x, double y, double z) {
+    const Matrix4x4FD identity = {1, 0, 0, 0,
+                                  0, 1, 0, 0,
+                                  0, 0, 1, 0,
+                                  0, 0, 0, 1};
+    addToWorld(obj, identity, x, y, z);
+  }
+
+  template<typename T>
+  void addToWorld(BasicObject<T>& obj, const Matrix4x4FD& orientation, double x, double y, double z) {
     Matrix4x4FD translateMat = {1, 0, 0, 0,
                                 0, 1, 0, 0,
                                 0, 0, 1, 0,
                                 x, y, z, 1};
 
-    obj.setWorldPosition({x, y, z});
-    obj.transVertexList_.clear();
-    auto it = obj.localVertexList_.begin();
-    while (it != obj.localVertexList_.end()) {
-      const auto pt4 = *it;
-      obj.transVertexList_.push_back(pt4 * translateMat);
-      ++it;
-    }
+    obj.setWorldPosition(typename BasicObject<T>::PointType(T(x), T(y), T(z)));
+    obj.transVertexList_.resize(obj.localVertexList_.size());
+    transformVertices(Matrix<T, 4U, 4U>(orientation * translateMat), obj.localVertexList_.data(), obj.transVertexList_.data(),
+                      static_cast<int>(obj.localVertexList_.size()), true);
   }
 
-  void backFaceRemove(Object& obj, const Point4FD& viewLine, double /*farZ*/) {
+  template<typename T>
+  void backFaceRemove(BasicObject<T>& obj, const Point4FD& viewLine, double /*farZ*/) {
     for (auto itp : obj.polygons_) {
       //if (itp.normal_.dotProduct(viewLine) > 0.) {
         obj.transPolygons_.push_back(itp);
@@ -59,7 +101,8 @@ namespace s3d
    return rotateYMat  * rotateXMat * rotateZMat;
   }
 
-  void setCamera(Object& obj, const Point4FD& pt, double anglex, double angley, double anglez) {
+  template<typename T>
+  void setCamera(BasicObject<T>& obj, const Point4FD& pt, double anglex, double angley, double anglez) {
     const auto cosx = ::cos(anglex);
     const auto sinx = ::sin(anglex);
 
@@ -114,14 +157,12 @@ namespace s3d
                               0,     0,    0, 1};
 
     const auto mat = translateMat * rotateYMat  * rotateXMat * rotateZMat;
-    auto transVerit = obj.transVertexList_.begin();
-    while (transVerit != obj.transVertexList_.end()) {
-      *transVerit = *transVerit * mat;
-      ++transVerit;
-    }
+    transformVertices(Matrix<T, 4U, 4U>(mat), obj.transVertexList_.data(), obj.transVertexList_.data(),
+                      static_cast<int>(obj.transVertexList_.size()), true);
   }
 
-  void perspectiveProject(Object& obj, double viewWidth, double viewHeight) {
+  template<typename T>
+  void perspectiveProject(BasicObject<T>& obj, double viewWidth, double viewHeight) {
     //viewing distance = 1
     //widthHeighRatio = viewWidth / viewHeight
     //px = x / z, [-1,1]
@@ -149,15 +190,12 @@ namespace s3d
                         xalpha, ybeta, 0,  1};
 
     const auto mat = pmat * vmat;
-    auto transVerit = obj.transVertexList_.begin();
-    while (transVerit != obj.transVertexList_.end()) {
-      const auto pt = *transVerit;
-      *transVerit = pt * mat;
-      ++transVerit;
-    }
+    transformVertices(Matrix<T, 4U, 4U>(mat), obj.transVertexList_.data(), obj.transVertexList_.data(),
+                      static_cast<int>(obj.transVertexList_.size()), true);
   }
 
-  void perspectiveProject(Object& obj, double fieldOfViewDegree, double viewWidth, double viewHeight) {
+  template<typename T>
+  void perspectiveProject(BasicObject<T>& obj, double fieldOfViewDegree, double viewWidth, double viewHeight) {
     const double viewingDistance = viewWidth * 0.5  / ::tan(degreeToRadius(fieldOfViewDegree / 2.));
 
     Matrix4x4FD pmat = {viewingDistance, 0,               0, 0,
@@ -171,11 +209,19 @@ namespace s3d
                         viewWidth * 0.5, (viewHeight - 1) - viewHeight*0.5, 0, 1};
 
     const auto mat = pmat * vmat;
-    auto transVerit = obj.transVertexList_.begin();
-    while (transVerit != obj.transVertexList_.end()) {
-      const auto pt = *transVerit;
-      *transVerit = pt * mat;
-      ++transVerit;
-    }
+    transformVertices(Matrix<T, 4U, 4U>(mat), obj.transVertexList_.data(), obj.transVertexList_.data(),
+                      static_cast<int>(obj.transVertexList_.size()), true);
   }
+  #define S3D_INSTANTIATE_OBJECT_FUNCTIONS(T) \
+    template void addToWorld(BasicObject<T>&, double, double, double); \
+    template void addToWorld(BasicObject<T>&, const Matrix4x4FD&, double, double, double); \
+    template void backFaceRemove(BasicObject<T>&, const Point4FD&, double); \
+    template void setCamera(BasicObject<T>&, const Point4FD&, double, double, double); \
+    template void perspectiveProject(BasicObject<T>&, double, double); \
+    template void perspectiveProject(BasicObject<T>&, double, double, double);
+
+  S3D_INSTANTIATE_OBJECT_FUNCTIONS(float)
+  S3D_INSTANTIATE_OBJECT_FUNCTIONS(double)
+  #undef S3D_INSTANTIATE_OBJECT_FUNCTIONS
+
 }// s3d
\ No newline at end of file
@@ -10,18 +10,30 @@
 namespace s3d
 {
 
-class Object {
+//the scalar of the object vertices and the transforms run on them. double
+//unless S3D_GEOMETRY_FLOAT is defined, float halves the vertex memory and
+//doubles the SIMD width. matrices are still composed in double either way
+#ifdef S3D_GEOMETRY_FLOAT
+typedef float GeometryScalar;
+#else
+typedef double GeometryScalar;
+#endif
+
+template<typename T>
+class BasicObject {
 public:
-  typedef Point4<double> PointType;
-  typedef Point4<double> VectorType;
+  typedef T value_type;
+  typedef Point4<T> PointType;
+  typedef Point4<T> VectorType;
 
   typedef VertexList<PointType> VertexListType;
-  typedef Polygon<3U> PolygonType;
+  //triangles, quads and larger convex polygons side by side
+  typedef Polygon<kMaxPolygonVertices> PolygonType;
 
-  Object(int id, const std::string& name) : id_(id), name_(name), direction_(0, 0, 1.f){
+  BasicObject(int id, const std::string& name) : transEdgesClipped_(false), id_(id), name_(name), edgeListValid_(false), direction_(0, 0, 1.f){
   }
 
-  ~Object() {
+  ~BasicObject() {
   }
   
 
@@ -35,16 +47,27 @@ public:
     localVertexList_.push_back(pt);
   }
 
+  //a vertex of the other precision, as the loaders give them
+  template<typename U>
+  void addVertex(const Point4<U>& pt) {
+    localVertexList_.push_back(PointType(pt));
+  }
+
   void addPolygon(const PolygonType& p) {
     const auto v0 = localVertexList_[p.at(1)] - localVertexList_[p.at(0)];
     const auto v1 = localVertexList_[p.at(2)] - localVertexList_[p.at(0)];
 
     PolygonType padded = p;
-    padded.normal_ = v0.crossProduct(v1);
+    padded.normal_ = Vector4FD(v0.crossProduct(v1));
     //padded.normal_.normalizeSelf();
     polygons_.push_back(padded);
+    edgeListValid_ = false;
   }
 
+  //every edge of polygons_ once as a pair of vertex indices (smaller first, sorted),
+  //shared edges are not repeated. rebuilt on the first call after addPolygon
+  const std::vector<uint32_t>& getEdgeList();
+
   void setWorldPosition(const PointType& pt) {
     worldPosition_ = pt;
   }
@@ -54,12 +77,30 @@ public:
   std::vector<PolygonType> polygons_;
   std::vector<PolygonType> transPolygons_;
 
+  //one per vertex for the Gouraud polygons, empty when the object has none.
+  //the caller fills it, loaders do not (PLG files carry no vertex colors):
+  //without it polygons flagged kPolygonAttrShadeModeGOURAUDFlag draw flat in
+  //their polygon color
+  std::vector<Color> vertexColors_;
+  //vertexColors_ for transVertexList_, clip vertices included. per frame like
+  //transVertexList_, empty when the object has no vertex colors
+  std::vector<Color> transVertexColors_;
+
+  //getEdgeList() cut at the clip planes by objectToScreen, indices into
+  //transVertexList_. per frame, only set when some vertex needed clipping,
+  //otherwise transEdgesClipped_ is false and getEdgeList() applies as it is
+  std::vector<uint32_t> transEdgeList_;
+  bool transEdgesClipped_;
+
   PointType worldPosition_;
 
 private:
   int id_;
   std::string name_;
 
+  std::vector<uint32_t> edgeList_;
+  bool edgeListValid_;
+
   float maxRadius_;
   float averageRadius_;
 
@@ -70,20 +111,35 @@ private:
 
 };
 
+//both are instantiated in Object.cpp, Object is the one the build is configured for
+typedef BasicObject<float> ObjectF;
+typedef BasicObject<double> ObjectFD;
+typedef BasicObject<GeometryScalar> Object;
+
 typedef std::shared_ptr<Object> ObjectPtr;
 
 Matrix4x4FD buildRotateMatrix4x4(double anglex, double angley, double anglez);
 
-void addToWorld(Object& obj, double x, double y, double z);
+template<typename T>
+void addToWorld(BasicObject<T>& obj, double x, double y, double z);
+
+//local -> orientation -> moved to (x, y, z) in one pass over the vertices,
+//for objects that are rotated every frame instead of rotating localVertexList_ first
+template<typename T>
+void addToWorld(BasicObject<T>& obj, const Matrix4x4FD& orientation, double x, double y, double z);
 
-void backFaceRemove(Object& obj, const Point4FD& viewLine, double farZ = 1000);
+template<typename T>
+void backFaceRemove(BasicObject<T>& obj, const Point4FD& viewLine, double farZ = 1000);
 
-void setCamera(Object& obj, const Point4FD& pt, double anglex, double angley, double anglez);
+template<typename T>
+void setCamera(BasicObject<T>& obj, const Point4FD& pt, double anglex, double angley, double anglez);
 
 //perspective projection with viewing distance 1 and viewing angle 90
-void perspectiveProject(Object& obj, double viewWidth, double viewHeight);
+template<typename T>
+void perspectiveProject(BasicObject<T>& obj, double viewWidth, double viewHeight);
 
-void perspectiveProject(Object& obj, double fieldOfViewDegree, double viewWidth, double viewHeight);
+template<typename T>
+void perspectiveProject(BasicObject<T>& obj, double fieldOfViewDegree, double viewWidth, double viewHeight);
 
 
 }// s3d
\ No newline at end of file
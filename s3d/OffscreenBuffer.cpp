@@ -0,0 +1,56 @@
+#include "OffscreenBuffer.h"
+#include "AlignedMemory.h"
+
+#include <fstream>
+#include <vector>
+
+using namespace std;
+
+namespace s3d
+{
+
+OffscreenRendererBuffer::OffscreenRendererBuffer(int w, int h)
+  : RendererBuffer(allocatePixels(w, h), w, h, alignedPitch(w)) {
+  clear(0);
+}
+
+OffscreenRendererBuffer::~OffscreenRendererBuffer() {
+  alignedFree(getBuffer());
+}
+
+int OffscreenRendererBuffer::alignedPitch(int w) {
+  assert(w > 0);
+  return static_cast<int>(alignUp(w * sizeof(uint32_t), kSurfaceAlignment) / sizeof(uint32_t));
+}
+
+uint32_t* OffscreenRendererBuffer::allocatePixels(int w, int h) {
+  assert(w > 0 && h > 0);
+  const size_t bytes = size_t(alignedPitch(w)) * h * sizeof(uint32_t);
+  return static_cast<uint32_t*>(alignedAlloc(bytes));
+}
+
+void OffscreenRendererBuffer::saveToPPM(const std::string& filename) const {
+  ofstream fout(filename.c_str(), ios_base::out | ios_base::binary);
+  if (!fout)
+    throw ImageWriteException("saveToPPM open file failed");
+
+  fout << "P6\n" << getWidth() << " " << getHeight() << "\n255\n";
+
+  vector<char> line(getWidth() * 3);
+  for (int y = 0; y < getHeight() && fout; ++y) {
+    const uint32_t* row = getRow(y);
+    for (int x = 0; x < getWidth(); ++x) {
+      const Color c(row[x]);
+      line[x * 3] = static_cast<char>(c.getRed());
+      line[x * 3 + 1] = static_cast<char>(c.getGreen());
+      line[x * 3 + 2] = static_cast<char>(c.getBlue());
+    }
+
+    fout.write(line.data(), line.size());
+  }
+
+  if (!fout)
+    throw ImageWriteException("saveToPPM write failed");
+}
+
+}// namespace s3d
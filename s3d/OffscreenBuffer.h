@@ -0,0 +1,32 @@
+#pragma once
+#include "Renderer.h"
+
+#include <string>
+#include <stdexcept>
+#include <boost/noncopyable.hpp>
+
+namespace s3d
+{
+
+class ImageWriteException : public std::runtime_error {
+public:
+  ImageWriteException(const char * const & msg) : std::runtime_error(msg) {
+  }
+};
+
+//a RendererBuffer that owns its pixels, no window or DIB section needed.
+//rows start on kSurfaceAlignment boundaries so the pitch may exceed the width.
+class OffscreenRendererBuffer : public RendererBuffer, private boost::noncopyable {
+public:
+  OffscreenRendererBuffer(int w, int h);
+  ~OffscreenRendererBuffer();
+
+  //binary PPM (P6), throws ImageWriteException
+  void saveToPPM(const std::string& filename) const;
+
+private:
+  static int alignedPitch(int w);
+  static uint32_t* allocatePixels(int w, int h);
+};
+
+}// namespace s3d
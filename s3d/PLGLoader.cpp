@@ -2,6 +2,10 @@
 #include <fstream>
 #include <iostream>
 #include <string>
+#include <sstream>
+#include <cstring>
+#include <cctype>
+#include <cstdlib>
 
 using namespace std;
 
@@ -16,7 +20,7 @@ PLGLoader::PLGLoader() {
 PLGLoader::~PLGLoader() {
 }
 
-void PLGLoader::parse(const std::string& filename, std::string& name, VertexList<Point4<double>>& vlist, std::vector<Polygon<3>>& polys, float scale) {
+void PLGLoader::parse(const std::string& filename, std::string& name, VertexList<Point4<double>>& vlist, std::vector<Polygon<kMaxPolygonVertices>>& polys, float scale) {
   fstream fin;
   fin.open(filename.c_str(), ios_base::in);
   if (!fin) 
@@ -33,7 +37,9 @@ void PLGLoader::parse(const std::string& filename, std::string& name, VertexList
       if (*linestr.begin() == '#')
         continue;
 
-      sscanf_s(linestr.c_str(), "%s %d %d", cname, 256 ,& num_verts, &num_polys);
+      string objName;
+      istringstream(linestr) >> objName >> num_verts >> num_polys;
+      objName.copy(cname, sizeof(cname) - 1);
       assert(strlen(cname) > 0 && num_verts > 0 && num_polys > 0);
       break;
     }
@@ -53,9 +59,9 @@ void PLGLoader::parse(const std::string& filename, std::string& name, VertexList
       if (*linestr.begin() == '#')
         continue;
 
-      int v1,v2,v3;
+      int v1 = 0, v2 = 0, v3 = 0;
 
-      sscanf_s(linestr.c_str(), "%d %d %d", &v1, &v2, &v3);
+      istringstream(linestr) >> v1 >> v2 >> v3;
       vlist.push_back({(double)v1 * scale, (double)v2* scale, (double)v3* scale});
       if (++vertsRead == num_verts)
         break;
@@ -75,18 +81,28 @@ void PLGLoader::parse(const std::string& filename, std::string& name, VertexList
       if (*linestr.begin() == '#')
         continue;
 
-      unsigned int v1, v2, v3;
       int desc = 0;
       unsigned int num = 0;
-      char strDesc[64] = {0};
-      sscanf_s(linestr.c_str(), "%s %d %d %d %d", strDesc, 64, &num, &v1, &v2, &v3);
-
-      if (strDesc[0] == '0' && toupper(strDesc[1]) == 'X')
-        sscanf_s(strDesc, "%x", &desc);
+      string strDesc;
+      istringstream polyin(linestr);
+      polyin >> strDesc >> num;
+      if (num < 3 || num > kMaxPolygonVertices)
+        throw PLGLoaderException("polygon vertex count out of range");
+
+      if (strDesc.size() > 1 && strDesc[0] == '0' && toupper(strDesc[1]) == 'X')
+        desc = static_cast<int>(strtol(strDesc.c_str(), NULL, 16));
       else
-        desc = atoi(strDesc);
-
-      Polygon<3> poly = {v1, v2, v3};
+        desc = atoi(strDesc.c_str());
+
+      Polygon<kMaxPolygonVertices> poly;
+      poly.clear();
+      for (unsigned int i = 0; i < num; ++i) {
+        unsigned int v = 0;
+        polyin >> v;
+        if (!polyin || v >= vlist.size())
+          throw PLGLoaderException("polygon vertex index missing or out of range");
+        poly.push_back(v);
+      }
 
 
       const int PLX_COLOR_MODE_RGB_FLAG = 0x8000;
@@ -124,7 +140,7 @@ void PLGLoader::parse(const std::string& filename, std::string& name, VertexList
           } break;
 
           case PLX_SHADE_MODE_GOURAUD_FLAG: {
-         
+            poly.setAttr(kPolygonAttrShadeModeGOURAUDFlag);
           // the vertices from this polygon all need normals, set that in the flags attribute
 
           } break;
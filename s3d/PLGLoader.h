@@ -10,13 +10,15 @@ public:
   PLGLoader();
   ~PLGLoader();
 
-  void parse(const std::string& filename, std::string& name, VertexList<Point4<double>>& vlist, std::vector<Polygon<3>>& polys, float scale);
+  //Gouraud polygons only get kPolygonAttrShadeModeGOURAUDFlag, their vertex
+  //colors are left to the caller (see BasicObject::vertexColors_)
+  void parse(const std::string& filename, std::string& name, VertexList<Point4<double>>& vlist, std::vector<Polygon<kMaxPolygonVertices>>& polys, float scale);
 
 };
 
-class PLGLoaderException : public std::exception {
+class PLGLoaderException : public std::runtime_error {
 public:
-  PLGLoaderException(const char * const & msg) : exception(msg) {
+  PLGLoaderException(const char * const & msg) : std::runtime_error(msg) {
   }
 };
 
@@ -0,0 +1,345 @@
+#include "Pipeline.h"
+#include "Rasterizer.h"
+#include "MatrixSimd.h"
+
+#include <algorithm>
+
+namespace s3d
+{
+
+static_assert(kMaxPolygonVertices <= kMaxConvexEdges, "an object polygon has to fit the convex filler");
+
+namespace
+{
+
+enum ClipPlane {
+  kClipPlaneNear = 0x1,
+  kClipPlaneFar = 0x2
+};
+
+//clip space w is the camera z, so the planes are w = near and w = far
+struct ClipVolume {
+  double nearW_;
+  double farW_;
+  unsigned planes_;
+};
+
+const size_t kMaxClippedVertices = kMaxPolygonVertices + 2;
+
+template<typename T>
+unsigned clipOutcode(const Point4<T>& pt, const ClipVolume& volume) {
+  unsigned code = 0;
+  if (pt.w_ < volume.nearW_)
+    code |= kClipPlaneNear;
+  if ((volume.planes_ & kClipPlaneFar) && pt.w_ > volume.farW_)
+    code |= kClipPlaneFar;
+  return code;
+}
+
+//signed distance to the plane, negative outside
+template<typename T>
+double clipDistance(const Point4<T>& pt, unsigned plane, const ClipVolume& volume) {
+  return plane == kClipPlaneNear ? pt.w_ - volume.nearW_ : volume.farW_ - pt.w_;
+}
+
+uint8_t lerpChannel(uint8_t c0, uint8_t c1, double t) {
+  return static_cast<uint8_t>(c0 + (c1 - c0) * t + 0.5);
+}
+
+//appends the point where the edge crosses the plane. always interpolated from the
+//inside end, so both polygons sharing the edge get the very same vertex
+template<typename T>
+uint32_t addClipVertex(BasicObject<T>& obj, uint32_t inside, uint32_t outside, unsigned plane, const ClipVolume& volume) {
+  const Point4<T> a = obj.transVertexList_[inside];
+  const Point4<T> b = obj.transVertexList_[outside];
+  const double da = clipDistance(a, plane, volume);
+  const double t = da / (da - clipDistance(b, plane, volume));
+
+  Point4<T> pt;
+  pt.x_ = T(a.x_ + (b.x_ - a.x_) * t);
+  pt.y_ = T(a.y_ + (b.y_ - a.y_) * t);
+  pt.z_ = T(a.z_ + (b.z_ - a.z_) * t);
+  pt.w_ = T(a.w_ + (b.w_ - a.w_) * t);
+  obj.transVertexList_.push_back(pt);
+
+  if (!obj.transVertexColors_.empty()) {
+    const Color c0 = obj.transVertexColors_[inside];
+    const Color c1 = obj.transVertexColors_[outside];
+    obj.transVertexColors_.push_back(Color(lerpChannel(c0.getRed(), c1.getRed(), t),
+                                           lerpChannel(c0.getGreen(), c1.getGreen(), t),
+                                           lerpChannel(c0.getBlue(), c1.getBlue(), t),
+                                           lerpChannel(c0.getAlpha(), c1.getAlpha(), t)));
+  }
+
+  return static_cast<uint32_t>(obj.transVertexList_.size() - 1);
+}
+
+//Sutherland-Hodgman against each plane of planes in turn. indices has room for
+//kMaxClippedVertices, returns the count left, 0 when nothing is left
+template<typename T>
+size_t clipPolygon(BasicObject<T>& obj, uint32_t* indices, size_t count, unsigned planes, const ClipVolume& volume) {
+  uint32_t scratch[kMaxClippedVertices];
+  uint32_t* in = indices;
+  uint32_t* out = scratch;
+  for (unsigned plane = kClipPlaneNear; plane <= kClipPlaneFar; plane <<= 1) {
+    if (!(planes & plane))
+      continue;
+
+    size_t outCount = 0;
+    for (size_t i = 0; i < count; ++i) {
+      const uint32_t a = in[i];
+      const uint32_t b = in[i + 1 < count ? i + 1 : 0];
+      const bool aInside = clipDistance(obj.transVertexList_[a], plane, volume) >= 0.;
+      const bool bInside = clipDistance(obj.transVertexList_[b], plane, volume) >= 0.;
+      if (aInside)
+        out[outCount++] = a;
+      if (aInside != bInside)
+        out[outCount++] = aInside ? addClipVertex(obj, a, b, plane, volume) : addClipVertex(obj, b, a, plane, volume);
+    }
+
+    std::swap(in, out);
+    count = outCount;
+    if (count < 3)
+      return 0;
+  }
+
+  if (in != indices)
+    std::copy(in, in + count, indices);
+  return count;
+}
+
+//clips obj.transPolygons_ in clip space, the new vertices go to the end of
+//obj.transVertexList_. a polygon grown past kMaxPolygonVertices is split in
+//pieces sharing its first vertex. false when no vertex was outside
+template<typename T>
+bool clipPolygons(BasicObject<T>& obj, const ClipVolume& volume) {
+  const size_t vertexCount = obj.transVertexList_.size();
+  std::vector<uint8_t> outcodes(vertexCount);
+  unsigned anyOut = 0;
+  for (size_t i = 0; i < vertexCount; ++i) {
+    outcodes[i] = static_cast<uint8_t>(clipOutcode(obj.transVertexList_[i], volume));
+    anyOut |= outcodes[i];
+  }
+
+  if (!anyOut)
+    return false;
+
+  std::vector<typename BasicObject<T>::PolygonType> polygons;
+  polygons.swap(obj.transPolygons_);
+  obj.transPolygons_.reserve(polygons.size());
+  for (const auto& poly : polygons) {
+    unsigned allOut = ~0U, someOut = 0;
+    for (auto index : poly) {
+      allOut &= outcodes[index];
+      someOut |= outcodes[index];
+    }
+
+    if (allOut)
+      continue;
+
+    if (!someOut) {
+      obj.transPolygons_.push_back(poly);
+      continue;
+    }
+
+    uint32_t indices[kMaxClippedVertices];
+    std::copy(poly.begin(), poly.end(), indices);
+    const size_t count = clipPolygon(obj, indices, poly.size(), someOut, volume);
+    for (size_t first = 1; first + 1 < count;) {
+      const size_t last = std::min(count, first + kMaxPolygonVertices - 1);
+      typename BasicObject<T>::PolygonType piece = poly;
+      piece.clear();
+      piece.push_back(indices[0]);
+      for (size_t i = first; i < last; ++i) {
+        piece.push_back(indices[i]);
+      }
+
+      obj.transPolygons_.push_back(piece);
+      first = last - 1;
+    }
+  }
+
+  return true;
+}
+
+//obj.getEdgeList(), back facing edges included, cut at the same planes into
+//obj.transEdgeList_ for the wireframe. an end outside a plane is moved onto it
+template<typename T>
+void clipEdges(BasicObject<T>& obj, const ClipVolume& volume) {
+  const std::vector<uint32_t>& edges = obj.getEdgeList();
+  obj.transEdgeList_.clear();
+  obj.transEdgeList_.reserve(edges.size());
+  for (size_t i = 0; i < edges.size(); i += 2) {
+    uint32_t a = edges[i], b = edges[i + 1];
+    bool visible = true;
+    for (unsigned plane = kClipPlaneNear; plane <= kClipPlaneFar && visible; plane <<= 1) {
+      if (!(volume.planes_ & plane))
+        continue;
+
+      const bool aInside = clipDistance(obj.transVertexList_[a], plane, volume) >= 0.;
+      const bool bInside = clipDistance(obj.transVertexList_[b], plane, volume) >= 0.;
+      if (!aInside && !bInside)
+        visible = false;
+      else if (!aInside)
+        a = addClipVertex(obj, b, a, plane, volume);
+      else if (!bInside)
+        b = addClipVertex(obj, a, b, plane, volume);
+    }
+
+    if (visible) {
+      obj.transEdgeList_.push_back(a);
+      obj.transEdgeList_.push_back(b);
+    }
+  }
+  obj.transEdgesClipped_ = true;
+}
+
+}
+
+template<typename T>
+bool objectToScreen(BasicObject<T>& obj, CameraUVN& camera, double radius, bool clipFar) {
+  obj.transPolygons_.clear();
+  obj.transEdgesClipped_ = false;
+
+  const Point4FD sphererPt = Point4FD(obj.worldPosition_) * camera.getWorldToCameraMatrix4x4FD();
+  if (camera.isSphereOutOfView(sphererPt, radius))
+    return false;
+
+  //the camera transform is affine, w stays 1 without the divide
+  const int vertexCount = static_cast<int>(obj.transVertexList_.size());
+  transformVertices(camera.getWorldToCameraMatrix<T>(), obj.transVertexList_.data(), obj.transVertexList_.data(),
+                    vertexCount, false);
+
+  for (auto& itp : obj.polygons_) {
+    const auto u = obj.transVertexList_[itp.at(1)] - obj.transVertexList_[itp.at(0)];
+    const auto v = obj.transVertexList_[itp.at(2)] - obj.transVertexList_[itp.at(0)];
+
+    const Vector4<T> normal = u.crossProduct(v);
+    itp.normal_ = Vector4FD(normal);
+    Vector4<T> vp(obj.transVertexList_[itp.at(0)], Point4<T>(camera.getPosition()));
+    if (vp.dotProduct(normal) > 0.) {
+      itp.setState(kPolygonStateVisible);
+      obj.transPolygons_.push_back(itp);
+    }
+  }
+
+  if (obj.vertexColors_.size() == obj.transVertexList_.size())
+    obj.transVertexColors_ = obj.vertexColors_;
+  else
+    obj.transVertexColors_.clear();
+
+  //to clip space, the divide waits until the polygons crossing near / far are cut
+  transformVertices(camera.getCameraToScreenMatrix<T>(), obj.transVertexList_.data(), obj.transVertexList_.data(),
+                    vertexCount, false);
+
+  const double nearZ = camera.getNearClipZ();
+  const ClipVolume volume = {nearZ, camera.getFarClipZ(), kClipPlaneNear | (clipFar ? unsigned(kClipPlaneFar) : 0U)};
+  if (clipPolygons(obj, volume))
+    clipEdges(obj, volume);
+
+  //the screen transform leaves z at 1, keep near / z for the depth buffer instead
+  for (auto& pt : obj.transVertexList_) {
+    pt.x_ /= pt.w_;
+    pt.y_ /= pt.w_;
+    pt.z_ = T(nearZ / pt.w_);
+    pt.w_ = T(1);
+  }
+
+  return true;
+}
+
+namespace
+{
+
+//the renderers take double screen vertices
+inline const Point4FD* screenVertices(const ObjectFD& obj, std::vector<Point4FD>& /*widened*/) {
+  return obj.transVertexList_.data();
+}
+
+inline const Point4FD* screenVertices(const ObjectF& obj, std::vector<Point4FD>& widened) {
+  widened.clear();
+  widened.reserve(obj.transVertexList_.size());
+  for (const auto& pt : obj.transVertexList_) {
+    widened.push_back(Point4FD(pt));
+  }
+  return widened.data();
+}
+
+template<typename TargetRenderer, typename T>
+void drawObjectImpl(TargetRenderer& renderer, BasicObject<T>& obj) {
+  const bool hasVertexColors = obj.transVertexColors_.size() == obj.transVertexList_.size();
+  std::vector<uint32_t> indices, polygonIndices, gouraudIndices;
+  std::vector<uint8_t> polygonCounts;
+  std::vector<Color> colors, polygonColors;
+  indices.reserve(obj.transPolygons_.size() * 3);
+  colors.reserve(obj.transPolygons_.size());
+  for (const auto& itp : obj.transPolygons_) {
+    if (hasVertexColors && itp.hasAttr(kPolygonAttrShadeModeGOURAUDFlag)) {
+      //vertex colors are not planar past 3 vertices, so larger polygons go in as a fan
+      for (size_t i = 1; i + 1 < itp.size(); ++i) {
+        gouraudIndices.push_back(itp[0]);
+        gouraudIndices.push_back(itp[i]);
+        gouraudIndices.push_back(itp[i + 1]);
+      }
+    } else if (itp.size() == 3) {
+      indices.insert(indices.end(), itp.begin(), itp.end());
+      colors.push_back(itp.getColor());
+    } else {
+      polygonIndices.insert(polygonIndices.end(), itp.begin(), itp.end());
+      polygonCounts.push_back(static_cast<uint8_t>(itp.size()));
+      polygonColors.push_back(itp.getColor());
+    }
+  }
+
+  std::vector<Point4FD> widened;
+  const Point4FD* vertices = screenVertices(obj, widened);
+  const int vertexCount = static_cast<int>(obj.transVertexList_.size());
+  renderer.drawIndexedTriangles(vertices, vertexCount,
+                                indices.data(), static_cast<int>(colors.size()), colors.data());
+  if (!polygonCounts.empty()) {
+    renderer.drawIndexedPolygons(vertices, vertexCount, polygonIndices.data(),
+                                 polygonCounts.data(), static_cast<int>(polygonCounts.size()), polygonColors.data());
+  }
+  if (!gouraudIndices.empty()) {
+    renderer.drawIndexedTrianglesGouraud(vertices, obj.transVertexColors_.data(), vertexCount,
+                                         gouraudIndices.data(), static_cast<int>(gouraudIndices.size() / 3));
+  }
+}
+
+}
+
+template<typename T>
+void drawObject(Renderer& renderer, BasicObject<T>& obj) {
+  drawObjectImpl(renderer, obj);
+}
+
+template<typename T>
+void drawObject(BinnedRenderer& renderer, BasicObject<T>& obj) {
+  drawObjectImpl(renderer, obj);
+}
+
+template<typename T>
+void drawObject(CommandBuffer& commands, BasicObject<T>& obj) {
+  drawObjectImpl(commands, obj);
+}
+
+template<typename T>
+void drawObjectWireframe(Renderer& renderer, BasicObject<T>& obj, const Color& c) {
+  const std::vector<uint32_t>& edges = obj.transEdgesClipped_ ? obj.transEdgeList_ : obj.getEdgeList();
+  std::vector<Point4FD> widened;
+  renderer.drawIndexedLines(screenVertices(obj, widened), static_cast<int>(obj.transVertexList_.size()),
+                            edges.data(), static_cast<int>(edges.size() / 2), c);
+}
+
+#define S3D_INSTANTIATE_PIPELINE(T) \
+  template bool objectToScreen(BasicObject<T>&, CameraUVN&, double, bool); \
+  template void drawObject(Renderer&, BasicObject<T>&); \
+  template void drawObject(BinnedRenderer&, BasicObject<T>&); \
+  template void drawObject(CommandBuffer&, BasicObject<T>&); \
+  template void drawObjectWireframe(Renderer&, BasicObject<T>&, const Color&);
+
+S3D_INSTANTIATE_PIPELINE(float)
+S3D_INSTANTIATE_PIPELINE(double)
+#undef S3D_INSTANTIATE_PIPELINE
+
+}// namespace s3d
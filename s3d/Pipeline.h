@@ -0,0 +1,44 @@
+#pragma once
+#include "Object.h"
+#include "Camera.h"
+#include "Renderer.h"
+#include "BinnedRenderer.h"
+#include "CommandBuffer.h"
+
+namespace s3d
+{
+
+//world -> camera -> screen for an object already placed with addToWorld.
+//front facing polygons are collected in obj.transPolygons_.
+//screen space vertices keep near / z in z_ for depth testing.
+//polygons crossing the near plane, and the far plane with clipFar, are clipped
+//in homogeneous space before the divide. the cut vertices are appended to
+//obj.transVertexList_ (and obj.transVertexColors_) for this frame only, the
+//wireframe edges are clipped the same way into obj.transEdgeList_.
+//returns false when the bounding sphere is out of the view volume.
+template<typename T>
+bool objectToScreen(BasicObject<T>& obj, CameraUVN& camera, double radius, bool clipFar = false);
+
+//fill of obj.transPolygons_ using the sub-pixel screen space obj.transVertexList_,
+//depth tested when the renderer has a depth buffer. Gouraud polygons are smooth
+//shaded from obj.transVertexColors_ when the object has them, the rest are flat.
+//flat polygons of more than 3 vertices are filled whole by drawIndexedPolygons.
+//the renderers take double vertices, a float object is widened once per call.
+template<typename T>
+void drawObject(Renderer& renderer, BasicObject<T>& obj);
+
+//records the same polygons, they are drawn at renderer.flush()
+template<typename T>
+void drawObject(BinnedRenderer& renderer, BasicObject<T>& obj);
+
+//records the same polygons into commands, see CommandBuffer::execute
+template<typename T>
+void drawObject(CommandBuffer& commands, BasicObject<T>& obj);
+
+//wireframe of every obj.polygons_ edge, back facing ones included, each shared
+//edge drawn once from obj.getEdgeList(), or from obj.transEdgeList_ when
+//objectToScreen had to clip them. no depth test
+template<typename T>
+void drawObjectWireframe(Renderer& renderer, BasicObject<T>& obj, const Color& c);
+
+}// namespace s3d
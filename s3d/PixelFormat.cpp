@@ -0,0 +1,251 @@
+#include "PixelFormat.h"
+#include "OffscreenBuffer.h"
+#include "AlignedMemory.h"
+#include "Simd.h"
+
+#include <cstring>
+#include <fstream>
+
+using namespace std;
+
+namespace s3d
+{
+
+namespace
+{
+
+void convertRowRGB565Scalar(uint16_t* dst, const uint32_t* src, int count) {
+  for (int i = 0; i < count; ++i) {
+    dst[i] = packRGB565(src[i]);
+  }
+}
+
+#ifdef S3D_SSE2
+void convertRowRGB565SSE2(uint16_t* dst, const uint32_t* src, int count) {
+  const __m128i redMask = _mm_set1_epi32(0xf800);
+  const __m128i greenMask = _mm_set1_epi32(0x07e0);
+  const __m128i blueMask = _mm_set1_epi32(0x001f);
+  int i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 4));
+    lo = _mm_or_si128(_mm_or_si128(_mm_and_si128(_mm_srli_epi32(lo, 8), redMask),
+                                   _mm_and_si128(_mm_srli_epi32(lo, 5), greenMask)),
+                      _mm_and_si128(_mm_srli_epi32(lo, 3), blueMask));
+    hi = _mm_or_si128(_mm_or_si128(_mm_and_si128(_mm_srli_epi32(hi, 8), redMask),
+                                   _mm_and_si128(_mm_srli_epi32(hi, 5), greenMask)),
+                      _mm_and_si128(_mm_srli_epi32(hi, 3), blueMask));
+    //sign extended, the signed saturating pack then keeps the low 16 bits as they are
+    lo = _mm_srai_epi32(_mm_slli_epi32(lo, 16), 16);
+    hi = _mm_srai_epi32(_mm_slli_epi32(hi, 16), 16);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packs_epi32(lo, hi));
+  }
+
+  convertRowRGB565Scalar(dst + i, src + i, count - i);
+}
+#endif
+
+ConvertRowFunc convertRowFor(SimdLevel level) {
+  switch (level) {
+#ifdef S3D_SSE2
+  case kSimdAVX2:
+  case kSimdSSE2:
+    return convertRowRGB565SSE2;
+#endif
+  default:
+    return convertRowRGB565Scalar;
+  }
+}
+
+uint32_t expandChannel(uint32_t value, int bits) {
+  return (value * 255 + ((1 << bits) - 1) / 2) / ((1 << bits) - 1);
+}
+
+}
+
+ConvertRowFunc g_convertRowRGB565 = convertRowFor(detectSimdLevel());
+
+SimdLevel selectPixelConvert(SimdLevel level) {
+  const SimdLevel supported = detectSimdLevel();
+  if (level > supported)
+    level = supported;
+
+  g_convertRowRGB565 = convertRowFor(level);
+  return level;
+}
+
+int getBytesPerPixel(PixelFormat format) {
+  switch (format) {
+  case kPixelFormatRGB565:
+    return 2;
+  case kPixelFormatIndexed8:
+    return 1;
+  default:
+    return 4;
+  }
+}
+
+Palette::Palette() {
+  for (int i = 0; i < 256; ++i) {
+    entries_[i] = (expandChannel(i >> 5, 3) << 16) | (expandChannel((i >> 2) & 7, 3) << 8) | expandChannel(i & 3, 2);
+  }
+}
+
+void Palette::setEntry(int index, uint32_t argb) {
+  assert(index >= 0 && index < 256);
+  entries_[index] = argb;
+  lookup_.clear();
+}
+
+void Palette::buildLookup() const {
+  lookup_.resize(1 << 15);
+  for (uint32_t key = 0; key < lookup_.size(); ++key) {
+    const int r = expandChannel(key >> 10, 5), g = expandChannel((key >> 5) & 31, 5), b = expandChannel(key & 31, 5);
+    int best = 0, bestDistance = INT32_MAX;
+    for (int i = 0; i < 256 && bestDistance; ++i) {
+      const Color c(entries_[i]);
+      const int dr = c.getRed() - r, dg = c.getGreen() - g, db = c.getBlue() - b;
+      const int distance = dr * dr + dg * dg + db * db;
+      if (distance < bestDistance) {
+        bestDistance = distance;
+        best = i;
+      }
+    }
+
+    lookup_[key] = static_cast<uint8_t>(best);
+  }
+}
+
+PixelBuffer::PixelBuffer(int w, int h, PixelFormat format) : format_(format), width_(w), height_(h) {
+  assert(w > 0 && h > 0);
+  pitch_ = static_cast<int>(alignUp(w * getBytesPerPixel(format), kSurfaceAlignment));
+  pixels_ = static_cast<uint8_t*>(alignedAlloc(size_t(pitch_) * h));
+  clear(0);
+}
+
+PixelBuffer::~PixelBuffer() {
+  alignedFree(pixels_);
+}
+
+void PixelBuffer::setPixel(int x, int y, uint32_t argb) {
+  assert(x >= 0 && x < width_);
+  uint8_t* row = getRow(y);
+  switch (format_) {
+  case kPixelFormatRGB565:
+    reinterpret_cast<uint16_t*>(row)[x] = packRGB565(argb);
+    break;
+  case kPixelFormatIndexed8:
+    row[x] = palette_.findNearest(argb);
+    break;
+  default:
+    reinterpret_cast<uint32_t*>(row)[x] = argb;
+    break;
+  }
+}
+
+uint32_t PixelBuffer::getPixel(int x, int y) const {
+  assert(x >= 0 && x < width_);
+  const uint8_t* row = getRow(y);
+  switch (format_) {
+  case kPixelFormatRGB565:
+    return unpackRGB565(reinterpret_cast<const uint16_t*>(row)[x]);
+  case kPixelFormatIndexed8:
+    return palette_.getEntry(row[x]);
+  default:
+    return reinterpret_cast<const uint32_t*>(row)[x];
+  }
+}
+
+void PixelBuffer::fillSpan(int x0, int x1, int y, uint32_t argb) {
+  if (y < 0 || y >= height_)
+    return;
+
+  if (x0 < 0)
+    x0 = 0;
+  if (x1 >= width_)
+    x1 = width_ - 1;
+  if (x0 > x1)
+    return;
+
+  uint8_t* row = getRow(y);
+  const int count = x1 - x0 + 1;
+  switch (format_) {
+  case kPixelFormatRGB565:
+    fillSpan16(reinterpret_cast<uint16_t*>(row) + x0, count, packRGB565(argb));
+    break;
+  case kPixelFormatIndexed8:
+    memset(row + x0, palette_.findNearest(argb), count);
+    break;
+  default:
+    fillSpan32(reinterpret_cast<uint32_t*>(row) + x0, count, argb);
+    break;
+  }
+}
+
+void PixelBuffer::fillRect(const RectI& rect, uint32_t argb) {
+  const int top = rect.getTop() < 0 ? 0 : rect.getTop();
+  const int bottom = rect.getBottom() >= height_ ? height_ - 1 : rect.getBottom();
+  for (int y = top; y <= bottom; ++y) {
+    fillSpan(rect.getLeft(), rect.getRight(), y, argb);
+  }
+}
+
+void PixelBuffer::clear(uint32_t argb) {
+  fillRect(RectI(0, 0, width_ - 1, height_ - 1), argb);
+}
+
+void PixelBuffer::present(const RendererBuffer& src) {
+  present(src, RectI(0, 0, width_ - 1, height_ - 1));
+}
+
+void PixelBuffer::present(const RendererBuffer& src, const RectI& rect) {
+  assert(src.getWidth() == width_ && src.getHeight() == height_);
+  const int left = std::max(rect.getLeft(), 0), right = std::min(rect.getRight(), width_ - 1);
+  const int top = std::max(rect.getTop(), 0), bottom = std::min(rect.getBottom(), height_ - 1);
+  if (left > right)
+    return;
+
+  const int count = right - left + 1;
+  for (int y = top; y <= bottom; ++y) {
+    const uint32_t* in = src.getRow(y) + left;
+    uint8_t* row = getRow(y);
+    switch (format_) {
+    case kPixelFormatRGB565:
+      g_convertRowRGB565(reinterpret_cast<uint16_t*>(row) + left, in, count);
+      break;
+    case kPixelFormatIndexed8:
+      for (int x = 0; x < count; ++x) {
+        row[left + x] = palette_.findNearest(in[x]);
+      }
+      break;
+    default:
+      memcpy(reinterpret_cast<uint32_t*>(row) + left, in, count * sizeof(uint32_t));
+      break;
+    }
+  }
+}
+
+void PixelBuffer::saveToPPM(const std::string& filename) const {
+  ofstream fout(filename.c_str(), ios_base::out | ios_base::binary);
+  if (!fout)
+    throw ImageWriteException("saveToPPM open file failed");
+
+  fout << "P6\n" << width_ << " " << height_ << "\n255\n";
+
+  vector<char> line(width_ * 3);
+  for (int y = 0; y < height_ && fout; ++y) {
+    for (int x = 0; x < width_; ++x) {
+      const Color c(getPixel(x, y));
+      line[x * 3] = static_cast<char>(c.getRed());
+      line[x * 3 + 1] = static_cast<char>(c.getGreen());
+      line[x * 3 + 2] = static_cast<char>(c.getBlue());
+    }
+
+    fout.write(line.data(), line.size());
+  }
+
+  if (!fout)
+    throw ImageWriteException("saveToPPM write failed");
+}
+
+}// namespace s3d
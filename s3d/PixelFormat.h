@@ -0,0 +1,149 @@
+#pragma once
+#include "Renderer.h"
+
+#include <string>
+#include <vector>
+#include <boost/noncopyable.hpp>
+
+namespace s3d
+{
+
+//layout of one pixel in a PixelBuffer
+enum PixelFormat {
+  kPixelFormatARGB8888,   //a Color value, what RendererBuffer holds
+  kPixelFormatRGB565,     //5 bits red (high), 6 green, 5 blue, no alpha
+  kPixelFormatIndexed8    //an index into the buffer's Palette
+};
+
+int getBytesPerPixel(PixelFormat format);
+
+inline uint16_t packRGB565(uint32_t argb) {
+  return static_cast<uint16_t>(((argb >> 8) & 0xf800U) | ((argb >> 5) & 0x07e0U) | ((argb >> 3) & 0x001fU));
+}
+
+//the low bits are filled from the high ones, so 0xffff comes back as white
+inline uint32_t unpackRGB565(uint16_t p) {
+  const uint32_t r = (p >> 11) & 0x1fU, g = (p >> 5) & 0x3fU, b = p & 0x1fU;
+  return (((r << 3) | (r >> 2)) << 16) | (((g << 2) | (g >> 4)) << 8) | ((b << 3) | (b >> 2));
+}
+
+//256 ARGB entries, a 3-3-2 color cube until entries are set
+class Palette {
+public:
+  Palette();
+
+  void setEntry(int index, uint32_t argb);
+  uint32_t getEntry(int index) const {
+    assert(index >= 0 && index < 256);
+    return entries_[index];
+  }
+
+  //the entry closest to argb (alpha ignored), looked up at 5 bits per channel.
+  //the first call after a setEntry rebuilds the 32K entry lookup
+  uint8_t findNearest(uint32_t argb) const {
+    if (lookup_.empty())
+      buildLookup();
+    return lookup_[((argb >> 9) & 0x7c00U) | ((argb >> 6) & 0x03e0U) | ((argb >> 3) & 0x001fU)];
+  }
+
+  //builds the lookup now, before several threads call findNearest
+  void prepareLookup() const {
+    if (lookup_.empty())
+      buildLookup();
+  }
+
+private:
+  void buildLookup() const;
+
+  uint32_t entries_[256];
+  mutable std::vector<uint8_t> lookup_;
+};
+
+//an owned surface in any PixelFormat. a Renderer with it as pixel target draws
+//its flat fills straight into it (see Renderer::setPixelTarget), the shaded
+//draws stay 32-bit and present() converts them. flat fills and clears here
+//write the native format directly. rows are kSurfaceAlignment aligned, pitch
+//is in bytes
+class PixelBuffer : private boost::noncopyable {
+public:
+  PixelBuffer(int w, int h, PixelFormat format);
+  ~PixelBuffer();
+
+  PixelFormat getFormat() const {
+    return format_;
+  }
+
+  int getWidth() const {
+    return width_;
+  }
+  int getHeight() const {
+    return height_;
+  }
+  int getPitch() const {
+    return pitch_;
+  }
+
+  uint8_t* getRow(int y) const {
+    assert(y >= 0 && y < height_);
+    return pixels_ + y * pitch_;
+  }
+
+  //only used by kPixelFormatIndexed8
+  Palette& getPalette() {
+    return palette_;
+  }
+  const Palette& getPalette() const {
+    return palette_;
+  }
+
+  //argb as this format stores it, in the low bits
+  uint32_t encode(uint32_t argb) const {
+    switch (format_) {
+    case kPixelFormatRGB565:
+      return packRGB565(argb);
+    case kPixelFormatIndexed8:
+      return palette_.findNearest(argb);
+    default:
+      return argb;
+    }
+  }
+
+  //argb in and out, converted to and from the format
+  void setPixel(int x, int y, uint32_t argb);
+  uint32_t getPixel(int x, int y) const;
+
+  //[x0, x1] inclusive, clipped to the buffer. argb is converted once per call
+  void fillSpan(int x0, int x1, int y, uint32_t argb);
+
+  //right/bottom inclusive, clipped to the buffer
+  void fillRect(const RectI& rect, uint32_t argb);
+
+  void clear(uint32_t argb);
+
+  //converts src, the same size, into this buffer
+  void present(const RendererBuffer& src);
+
+  //converts only rect (right/bottom inclusive, e.g. from FrameTiles::endFrame)
+  void present(const RendererBuffer& src, const RectI& rect);
+
+  //binary PPM (P6) of the converted pixels, throws ImageWriteException
+  void saveToPPM(const std::string& filename) const;
+
+private:
+  PixelFormat format_;
+  int width_;
+  int height_;
+  int pitch_;
+  uint8_t* pixels_;
+  Palette palette_;
+};
+
+typedef void (*ConvertRowFunc)(uint16_t* dst, const uint32_t* src, int count);
+
+//the ARGB8888 -> RGB565 row converter picked for this cpu at startup
+extern ConvertRowFunc g_convertRowRGB565;
+
+//forces a code path as selectSpanFill does, returns the level in use
+SimdLevel selectPixelConvert(SimdLevel level);
+
+}// namespace s3d
@@ -16,15 +16,20 @@ enum PolygonState {
   kPolygonStateBackface
 };
 
+//bit flags, combined by setAttr
 enum PolygonAttr {
   kPolygonAttr2Start = 0,
-  kPolygonAttr2Side,
-  kPolygonAttrShadeModePureFlag,
-  kPolygonAttrShadeModeFlatFlag,
-  kPolygonAttrShadeModeGOURAUDFlag,
-  kPolygonAttrShadeModePHONGFlag
+  kPolygonAttr2Side = 0x1,
+  kPolygonAttrShadeModePureFlag = 0x2,
+  kPolygonAttrShadeModeFlatFlag = 0x4,
+  kPolygonAttrShadeModeGOURAUDFlag = 0x8,
+  kPolygonAttrShadeModePHONGFlag = 0x10
 };
 
+//the most vertices an Object polygon can have
+const size_t kMaxPolygonVertices = 8;
+
+//a convex polygon of 3 up to VertexNum vertices, size() is the actual count
 template<size_t VertexNum>
 class Polygon {
 public:
@@ -32,12 +37,13 @@ public:
   typedef uint32_t* iterator;
   typedef const uint32_t* const_iterator;
 
-  Polygon() : state_(kPolygonStateInVisible) {
+  Polygon() : state_(kPolygonStateInVisible), attr_(kPolygonAttr2Start), count_(VertexNum) {
   }
 
   Polygon(const std::initializer_list<value_type>& ilist) : state_(kPolygonStateInVisible), attr_(kPolygonAttr2Start){
-    assert(ilist.size() == VertexNum);
+    assert(ilist.size() >= 3 && ilist.size() <= VertexNum);
 
+    count_ = ilist.size();
     std::copy(ilist.begin(), ilist.end(), vertices);
   }
 
@@ -46,7 +52,20 @@ public:
     state_ = p.state_;
     attr_ = p.attr_;
     normal_ = p.normal_;
-    std::copy(p.vertices, p.vertices + VertexNum, vertices);
+    count_ = p.count_;
+    std::copy(p.vertices, p.vertices + count_, vertices);
+  }
+
+  //a smaller polygon widened, e.g. a Polygon<3> into an Object
+  template<size_t OtherNum>
+  Polygon(const Polygon<OtherNum>& p) {
+    static_assert(OtherNum <= VertexNum, "the polygon does not fit");
+    color_ = p.getColor();
+    state_ = p.getState();
+    attr_ = p.getAttr();
+    normal_ = p.normal_;
+    count_ = p.size();
+    std::copy(p.begin(), p.end(), vertices);
   }
 
   Polygon& operator= (const Polygon& p) {
@@ -54,7 +73,19 @@ public:
     state_ = p.state_;
     attr_ = p.attr_;
     normal_ = p.normal_;
-    std::copy(p.vertices, p.vertices + VertexNum, vertices);
+    count_ = p.count_;
+    std::copy(p.vertices, p.vertices + count_, vertices);
+    return *this;
+  }
+
+  //appends a vertex, at most VertexNum
+  void push_back(value_type v) {
+    assert(count_ < VertexNum);
+    vertices[count_++] = v;
+  }
+
+  void clear() {
+    count_ = 0;
   }
 
   Color getColor() const {
@@ -70,7 +101,7 @@ public:
   }
 
   iterator end() {
-    return vertices + VertexNum;
+    return vertices + count_;
   }
 
   const_iterator begin() const {
@@ -78,20 +109,20 @@ public:
   }
 
   const_iterator end() const {
-    return vertices + VertexNum;
+    return vertices + count_;
   }
 
   size_t size() const {
-    return VertexNum;
+    return count_;
   }
 
   value_type operator[] (size_t index) const {
-    assert (index < VertexNum);
+    assert (index < count_);
     return vertices[index];
   }
 
   value_type at(size_t index) const  {
-    if (index >= VertexNum) {
+    if (index >= count_) {
       throw std::out_of_range("Polygon at out of range");
     }
 
@@ -114,6 +145,10 @@ public:
     attr_ = PolygonAttr((unsigned)attr_ | s);
   }
 
+  bool hasAttr(PolygonAttr s) const {
+    return ((unsigned)attr_ & s) != 0;
+  }
+
   Vector4FD normal_;
   
 private:
@@ -121,6 +156,7 @@ private:
   PolygonAttr attr_;
 
   value_type vertices[VertexNum];
+  size_t count_;
   Color color_;
 
   int id;
@@ -0,0 +1,365 @@
+#include "Rasterizer.h"
+#include "Simd.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+using namespace std;
+
+namespace s3d
+{
+
+namespace
+{
+
+//edge v0 -> v1 of a counter clockwise (y down) triangle, positive inside.
+//the 28.4 setup is scaled to whole pixel steps and the top-left rule is
+//folded into c_: only top and left edges own the pixels exactly on them.
+EdgeFunction makeEdge(const Point2<int>& v0, const Point2<int>& v1) {
+  const int dy = v0.y_ - v1.y_;
+  const int dx = v1.x_ - v0.x_;
+
+  EdgeFunction e;
+  e.a_ = dy * kSubPixelScale;
+  e.b_ = dx * kSubPixelScale;
+  e.c_ = int64_t(v0.x_) * v1.y_ - int64_t(v0.y_) * v1.x_;
+
+  const bool topLeft = dy > 0 || (dy == 0 && dx > 0);
+  if (!topLeft)
+    e.c_ -= 1;
+
+  return e;
+}
+
+inline int64_t doubleArea(const Point2<int>& p0, const Point2<int>& p1, const Point2<int>& p2) {
+  return int64_t(p1.x_ - p0.x_) * (p2.y_ - p0.y_) - int64_t(p1.y_ - p0.y_) * (p2.x_ - p0.x_);
+}
+
+//first pixel at or after a 28.4 coordinate, and last pixel at or before it
+inline int ceilPixel(int v) {
+  return (v + kSubPixelScale - 1) >> kSubPixelBits;
+}
+
+inline int floorPixel(int v) {
+  return v >> kSubPixelBits;
+}
+
+//reach widens the bounding box for samples off the pixel position, in 1/16 pixels
+bool setupEdges(const Point2<int>* points, int count, const RectI& clipRect, int reach, TriangleEdges& tri) {
+  assert(count >= 3 && count <= kMaxConvexEdges);
+  const int maxFixed = kRasterMaxCoord * kSubPixelScale;
+  int minX = points[0].x_, maxX = points[0].x_, minY = points[0].y_, maxY = points[0].y_;
+  for (int i = 0; i < count; ++i) {
+    assert(abs(points[i].x_) <= maxFixed && abs(points[i].y_) <= maxFixed);
+    minX = min(minX, points[i].x_);
+    maxX = max(maxX, points[i].x_);
+    minY = min(minY, points[i].y_);
+    maxY = max(maxY, points[i].y_);
+  }
+
+  tri.minX_ = max(clipRect.getLeft(), ceilPixel(minX - reach));
+  tri.maxX_ = min(clipRect.getRight(), floorPixel(maxX + reach));
+  tri.minY_ = max(clipRect.getTop(), ceilPixel(minY - reach));
+  tri.maxY_ = min(clipRect.getBottom(), floorPixel(maxY + reach));
+  if (tri.minX_ > tri.maxX_ || tri.minY_ > tri.maxY_)
+    return false;
+
+  int64_t area = 0;
+  for (int i = 1; i + 1 < count; ++i) {
+    area += doubleArea(points[0], points[i], points[i + 1]);
+  }
+  if (area == 0)
+    return false;
+
+  //counter clockwise edges, the other winding is walked backwards
+  tri.edgeCount_ = 0;
+  for (int i = 0; i < count; ++i) {
+    const Point2<int>& v0 = area > 0 ? points[i] : points[(count - i) % count];
+    const Point2<int>& v1 = area > 0 ? points[(i + 1) % count] : points[count - 1 - i];
+    if (v0.x_ != v1.x_ || v0.y_ != v1.y_)
+      tri.edges_[tri.edgeCount_++] = makeEdge(v0, v1);
+  }
+
+  return true;
+}
+
+//rowMasks of the block with bias[i] added to edge i
+void blockCoverage(const TriangleEdges& tri, unsigned edgeMask, const int64_t bias[kMaxConvexEdges],
+                   int x0, int y0, int x1, int y1, uint8_t rowMasks[kRasterBlockSize]) {
+  assert(x1 - x0 < kRasterBlockSize && y1 - y0 < kRasterBlockSize);
+  const int width = x1 - x0 + 1;
+  const int height = y1 - y0 + 1;
+  const unsigned widthMask = (1U << width) - 1;
+
+#ifdef S3D_SSE2
+  __m128i rowValue[kMaxConvexEdges], colStep0[kMaxConvexEdges], colStep1[kMaxConvexEdges], rowStep[kMaxConvexEdges];
+  int edgeCount = 0;
+  for (int i = 0; i < tri.edgeCount_; ++i) {
+    if (!(edgeMask & (1U << i)))
+      continue;
+
+    //the edge crosses the block, so its values in the block fit in 32 bits
+    const EdgeFunction& e = tri.edges_[i];
+    rowValue[edgeCount] = _mm_set1_epi32(static_cast<int>(e.evaluate(x0, y0) + bias[i]));
+    colStep0[edgeCount] = _mm_setr_epi32(0, e.a_, 2 * e.a_, 3 * e.a_);
+    colStep1[edgeCount] = _mm_add_epi32(colStep0[edgeCount], _mm_set1_epi32(4 * e.a_));
+    rowStep[edgeCount] = _mm_set1_epi32(e.b_);
+    ++edgeCount;
+  }
+
+  const __m128i minusOne = _mm_set1_epi32(-1);
+  for (int j = 0; j < height; ++j) {
+    __m128i inside0 = minusOne;
+    __m128i inside1 = minusOne;
+    for (int i = 0; i < edgeCount; ++i) {
+      inside0 = _mm_and_si128(inside0, _mm_cmpgt_epi32(_mm_add_epi32(rowValue[i], colStep0[i]), minusOne));
+      inside1 = _mm_and_si128(inside1, _mm_cmpgt_epi32(_mm_add_epi32(rowValue[i], colStep1[i]), minusOne));
+      rowValue[i] = _mm_add_epi32(rowValue[i], rowStep[i]);
+    }
+
+    const unsigned mask = _mm_movemask_ps(_mm_castsi128_ps(inside0)) |
+                          (_mm_movemask_ps(_mm_castsi128_ps(inside1)) << 4);
+    rowMasks[j] = static_cast<uint8_t>(mask & widthMask);
+  }
+#else
+  for (int j = 0; j < height; ++j) {
+    unsigned mask = widthMask;
+    for (int i = 0; i < tri.edgeCount_; ++i) {
+      if (!(edgeMask & (1U << i)))
+        continue;
+
+      const EdgeFunction& e = tri.edges_[i];
+      int64_t value = e.evaluate(x0, y0 + j) + bias[i];
+      for (int x = 0; x < width; ++x, value += e.a_) {
+        if (value < 0)
+          mask &= ~(1U << x);
+      }
+    }
+    rowMasks[j] = static_cast<uint8_t>(mask);
+  }
+#endif
+
+  for (int j = height; j < kRasterBlockSize; ++j) {
+    rowMasks[j] = 0;
+  }
+}
+
+}
+
+bool setupTriangleEdges(const Point2<int>& p0, const Point2<int>& p1, const Point2<int>& p2,
+                        const RectI& clipRect, TriangleEdges& tri) {
+  const Point2<int> points[3] = {p0, p1, p2};
+  return setupEdges(points, 3, clipRect, 0, tri);
+}
+
+bool setupTriangleEdgesMultisample(const Point2<int>& p0, const Point2<int>& p1, const Point2<int>& p2,
+                                   const RectI& clipRect, TriangleEdges& tri) {
+  const Point2<int> points[3] = {p0, p1, p2};
+  return setupEdges(points, 3, clipRect, kSampleReach, tri);
+}
+
+bool setupConvexEdges(const Point2<int>* points, int count, const RectI& clipRect, TriangleEdges& tri) {
+  return setupEdges(points, count, clipRect, 0, tri);
+}
+
+bool setupConvexEdgesMultisample(const Point2<int>* points, int count, const RectI& clipRect, TriangleEdges& tri) {
+  return setupEdges(points, count, clipRect, kSampleReach, tri);
+}
+
+AttributePlane setupAttributePlane(const Point2<int>& p0, const Point2<int>& p1, const Point2<int>& p2,
+                                   double v0, double v1, double v2) {
+  const double scale = 1. / kSubPixelScale;
+  const double x0 = p0.x_ * scale, y0 = p0.y_ * scale;
+  const double dx1 = (p1.x_ - p0.x_) * scale, dy1 = (p1.y_ - p0.y_) * scale;
+  const double dx2 = (p2.x_ - p0.x_) * scale, dy2 = (p2.y_ - p0.y_) * scale;
+  const double dv1 = v1 - v0, dv2 = v2 - v0;
+
+  const double det = dx1 * dy2 - dx2 * dy1;
+  assert(det != 0.);
+
+  AttributePlane plane;
+  plane.a_ = (dv1 * dy2 - dv2 * dy1) / det;
+  plane.b_ = (dx1 * dv2 - dx2 * dv1) / det;
+  plane.c_ = v0 - plane.a_ * x0 - plane.b_ * y0;
+  return plane;
+}
+
+void computeBlockCoverage(const TriangleEdges& tri, unsigned edgeMask,
+                          int x0, int y0, int x1, int y1, uint8_t rowMasks[kRasterBlockSize]) {
+  const int64_t noBias[kMaxConvexEdges] = {};
+  blockCoverage(tri, edgeMask, noBias, x0, y0, x1, y1, rowMasks);
+}
+
+void computeBlockSampleCoverage(const TriangleEdges& tri, unsigned edgeMask,
+                                int x0, int y0, int x1, int y1, uint32_t rowCoverage[kRasterBlockSize]) {
+  for (int j = 0; j < kRasterBlockSize; ++j) {
+    rowCoverage[j] = 0;
+  }
+
+  uint8_t rowMasks[kRasterBlockSize];
+  for (int s = 0; s < kMultisampleCount; ++s) {
+    int64_t bias[kMaxConvexEdges];
+    for (int i = 0; i < tri.edgeCount_; ++i) {
+      bias[i] = sampleDelta(tri.edges_[i], s);
+    }
+    blockCoverage(tri, edgeMask, bias, x0, y0, x1, y1, rowMasks);
+    for (int j = 0; j < kRasterBlockSize; ++j) {
+      rowCoverage[j] |= spreadRowMask(rowMasks[j]) << s;
+    }
+  }
+}
+
+void fillMaskedRow(uint32_t* row, int count, unsigned mask, uint32_t p) {
+  assert(count <= kRasterBlockSize);
+  int x = 0;
+#ifdef S3D_SSE2
+  const __m128i color = _mm_set1_epi32(static_cast<int>(p));
+  for (; x + 4 <= count; x += 4) {
+    const unsigned nibble = (mask >> x) & 0xF;
+    if (nibble == 0)
+      continue;
+
+    __m128i* dst = reinterpret_cast<__m128i*>(row + x);
+    if (nibble == 0xF) {
+      _mm_storeu_si128(dst, color);
+    } else {
+      const __m128i select = _mm_setr_epi32(-int(nibble & 1), -int((nibble >> 1) & 1),
+                                            -int((nibble >> 2) & 1), -int((nibble >> 3) & 1));
+      const __m128i old = _mm_loadu_si128(dst);
+      _mm_storeu_si128(dst, _mm_or_si128(_mm_and_si128(select, color), _mm_andnot_si128(select, old)));
+    }
+  }
+#endif
+  for (; x < count; ++x) {
+    if (mask & (1U << x))
+      row[x] = p;
+  }
+}
+
+void fillMaskedRow(uint16_t* row, int count, unsigned mask, uint16_t p) {
+  assert(count <= kRasterBlockSize);
+#ifdef S3D_SSE2
+  //a full block row is one 16 byte store
+  if (count == 8) {
+    const __m128i color = _mm_set1_epi16(static_cast<short>(p));
+    __m128i* dst = reinterpret_cast<__m128i*>(row);
+    if ((mask & 0xFF) == 0xFF) {
+      _mm_storeu_si128(dst, color);
+    } else {
+      const __m128i bits = _mm_setr_epi16(1, 2, 4, 8, 16, 32, 64, 128);
+      const __m128i select = _mm_cmpeq_epi16(_mm_and_si128(_mm_set1_epi16(static_cast<short>(mask)), bits), bits);
+      const __m128i old = _mm_loadu_si128(dst);
+      _mm_storeu_si128(dst, _mm_or_si128(_mm_and_si128(select, color), _mm_andnot_si128(select, old)));
+    }
+    return;
+  }
+#endif
+  for (int x = 0; x < count; ++x) {
+    if (mask & (1U << x))
+      row[x] = p;
+  }
+}
+
+void fillMaskedRow(uint8_t* row, int count, unsigned mask, uint8_t p) {
+  assert(count <= kRasterBlockSize);
+#ifdef S3D_SSE2
+  //a full block row is one 8 byte store
+  if (count == 8) {
+    const __m128i color = _mm_set1_epi8(static_cast<char>(p));
+    __m128i* dst = reinterpret_cast<__m128i*>(row);
+    if ((mask & 0xFF) == 0xFF) {
+      _mm_storel_epi64(dst, color);
+    } else {
+      const __m128i bits = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0, 0);
+      const __m128i select = _mm_cmpeq_epi8(_mm_and_si128(_mm_set1_epi8(static_cast<char>(mask)), bits), bits);
+      const __m128i old = _mm_loadl_epi64(dst);
+      _mm_storel_epi64(dst, _mm_or_si128(_mm_and_si128(select, color), _mm_andnot_si128(select, old)));
+    }
+    return;
+  }
+#endif
+  for (int x = 0; x < count; ++x) {
+    if (mask & (1U << x))
+      row[x] = p;
+  }
+}
+
+void shadeMaskedRow(uint32_t* row, int count, unsigned mask, const int32_t start[4], const int32_t step[4]) {
+  assert(count <= kRasterBlockSize);
+  int x = 0;
+#ifdef S3D_SSE2
+  __m128i value[4], step4[4];
+  for (int c = 0; c < 4; ++c) {
+    const uint32_t s = start[c], d = step[c];
+    value[c] = _mm_setr_epi32(int(s), int(s + d), int(s + 2 * d), int(s + 3 * d));
+    step4[c] = _mm_set1_epi32(int(4 * d));
+  }
+
+  for (; x + 4 <= count; x += 4) {
+    const unsigned nibble = (mask >> x) & 0xF;
+    if (nibble) {
+      //b0..b3 g0..g3 r0..r3 a0..a3, saturated to bytes, then interleaved per pixel
+      const __m128i bg = _mm_packs_epi32(_mm_srai_epi32(value[0], 16), _mm_srai_epi32(value[1], 16));
+      const __m128i ra = _mm_packs_epi32(_mm_srai_epi32(value[2], 16), _mm_srai_epi32(value[3], 16));
+      const __m128i planar = _mm_packus_epi16(bg, ra);
+      const __m128i bgPairs = _mm_unpacklo_epi8(planar, _mm_srli_si128(planar, 4));
+      const __m128i raPairs = _mm_unpacklo_epi8(_mm_srli_si128(planar, 8), _mm_srli_si128(planar, 12));
+      const __m128i pixels = _mm_unpacklo_epi16(bgPairs, raPairs);
+
+      __m128i* dst = reinterpret_cast<__m128i*>(row + x);
+      if (nibble == 0xF) {
+        _mm_storeu_si128(dst, pixels);
+      } else {
+        const __m128i select = _mm_setr_epi32(-int(nibble & 1), -int((nibble >> 1) & 1),
+                                              -int((nibble >> 2) & 1), -int((nibble >> 3) & 1));
+        const __m128i old = _mm_loadu_si128(dst);
+        _mm_storeu_si128(dst, _mm_or_si128(_mm_and_si128(select, pixels), _mm_andnot_si128(select, old)));
+      }
+    }
+
+    for (int c = 0; c < 4; ++c) {
+      value[c] = _mm_add_epi32(value[c], step4[c]);
+    }
+  }
+#endif
+  for (; x < count; ++x) {
+    if (!(mask & (1U << x)))
+      continue;
+
+    uint32_t p = 0;
+    for (int c = 0; c < 4; ++c) {
+      const int32_t v = static_cast<int32_t>(uint32_t(start[c]) + uint32_t(x) * uint32_t(step[c])) >> 16;
+      p |= uint32_t(v < 0 ? 0 : (v > 255 ? 255 : v)) << (c * 8);
+    }
+    row[x] = p;
+  }
+}
+
+void computeOutcodes(const int* xs, const int* ys, int count, const RectI& clipRect, uint8_t* codes) {
+  int i = 0;
+#ifdef S3D_SSE2
+  const __m128i left = _mm_set1_epi32(clipRect.getLeft());
+  const __m128i right = _mm_set1_epi32(clipRect.getRight());
+  const __m128i top = _mm_set1_epi32(clipRect.getTop());
+  const __m128i bottom = _mm_set1_epi32(clipRect.getBottom());
+  for (; i + 4 <= count; i += 4) {
+    const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(xs + i));
+    const __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ys + i));
+    const __m128i w = _mm_and_si128(_mm_cmplt_epi32(x, left), _mm_set1_epi32(0x1));
+    const __m128i e = _mm_and_si128(_mm_cmpgt_epi32(x, right), _mm_set1_epi32(0x2));
+    const __m128i s = _mm_and_si128(_mm_cmpgt_epi32(y, bottom), _mm_set1_epi32(0x4));
+    const __m128i n = _mm_and_si128(_mm_cmplt_epi32(y, top), _mm_set1_epi32(0x8));
+    const __m128i code = _mm_or_si128(_mm_or_si128(w, e), _mm_or_si128(s, n));
+    const __m128i bytes = _mm_packus_epi16(_mm_packs_epi32(code, code), _mm_setzero_si128());
+    const int packed = _mm_cvtsi128_si32(bytes);
+    memcpy(codes + i, &packed, 4);
+  }
+#endif
+  for (; i < count; ++i) {
+    codes[i] = static_cast<uint8_t>((xs[i] < clipRect.getLeft() ? 0x1 : 0) | (xs[i] > clipRect.getRight() ? 0x2 : 0) |
+                                    (ys[i] > clipRect.getBottom() ? 0x4 : 0) | (ys[i] < clipRect.getTop() ? 0x8 : 0));
+  }
+}
+
+}// namespace s3d
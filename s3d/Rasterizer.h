@@ -0,0 +1,263 @@
+#pragma once
+#include <cstdint>
+#include <cmath>
+#include "math/Point.h"
+#include "Rect.h"
+
+namespace s3d
+{
+
+//half-space (edge function) triangle rasterization over kRasterBlockSize^2 blocks.
+//vertices are 28.4 fixed point, pixel (x, y) is sampled at the vertex
+//coordinate (x, y), the same convention the screen transform uses.
+//a pixel is covered when every edge function is >= 0 at it, edges that are
+//not top or left are biased by one so shared edges are drawn exactly once.
+const int kRasterBlockSize = 8;
+
+const int kSubPixelBits = 4;
+const int kSubPixelScale = 1 << kSubPixelBits;
+
+//the guard band: vertices beyond this range (in pixels) are clipped to it first,
+//it keeps the per block edge values of partially covered blocks inside 32 bits
+const int kRasterMaxCoord = 1 << 17;
+
+inline int toFixed28_4(double v) {
+  return static_cast<int>(::floor(v * kSubPixelScale + 0.5));
+}
+
+//16.16 fixed point for the shader steps, saturated to the int32 range: a far
+//extrapolated plane or texel coordinate would otherwise overflow the cast
+inline int32_t toFixed16_16(double v) {
+  const double f = ::floor(v * 65536. + 0.5);
+  if (f >= 2147483647.)
+    return INT32_MAX;
+  if (!(f > -2147483648.))
+    return INT32_MIN;
+  return static_cast<int32_t>(f);
+}
+
+inline Point2<int> toFixed28_4(const Point2<int>& p) {
+  return Point2<int>(p.x_ * kSubPixelScale, p.y_ * kSubPixelScale);
+}
+
+inline Point2<int> toFixed28_4(const Point2<double>& p) {
+  return Point2<int>(toFixed28_4(p.x_), toFixed28_4(p.y_));
+}
+
+//E(x, y) = a_ * x + b_ * y + c_ over integer pixel coordinates
+struct EdgeFunction {
+  int a_;
+  int b_;
+  int64_t c_;
+
+  int64_t evaluate(int x, int y) const {
+    return int64_t(a_) * x + int64_t(b_) * y + c_;
+  }
+};
+
+//4x multisampling: sample s of pixel (x, y) sits at
+//(x + kSampleOffsetX[s] / 16, y + kSampleOffsetY[s] / 16), a rotated grid.
+//coverage masks hold 4 bits per pixel, bit s is sample s
+const int kMultisampleCount = 4;
+const int kSampleOffsetX[kMultisampleCount] = {-2, 6, -6, 2};
+const int kSampleOffsetY[kMultisampleCount] = {-6, -2, 2, 6};
+const int kSampleReach = 6;
+
+//bit i of an 8 pixel row mask to bit 4 * i, and back for one sample
+inline uint32_t spreadRowMask(unsigned mask) {
+  uint32_t x = mask & 0xFF;
+  x = (x | (x << 12)) & 0x000F000F;
+  x = (x | (x << 6)) & 0x03030303;
+  return (x | (x << 3)) & 0x11111111;
+}
+
+inline unsigned sampleRowMask(uint32_t coverage, int sample) {
+  uint32_t x = (coverage >> sample) & 0x11111111;
+  x = (x | (x >> 3)) & 0x03030303;
+  x = (x | (x >> 6)) & 0x000F000F;
+  return (x | (x >> 12)) & 0xFF;
+}
+
+//a triangle has 3 edges, a convex polygon up to this many
+const int kMaxConvexEdges = 8;
+
+struct TriangleEdges {
+  EdgeFunction edges_[kMaxConvexEdges];
+  int edgeCount_;
+
+  //clipped bounding box, inclusive
+  int minX_;
+  int minY_;
+  int maxX_;
+  int maxY_;
+};
+
+//p0..p2 in 28.4 fixed point, |coordinate| <= kRasterMaxCoord pixels.
+//returns false when the triangle is degenerate or misses clipRect (inclusive right/bottom)
+bool setupTriangleEdges(const Point2<int>& p0, const Point2<int>& p1, const Point2<int>& p2,
+                        const RectI& clipRect, TriangleEdges& tri);
+
+//same edges, the bounding box takes every pixel that may have a covered sample
+bool setupTriangleEdgesMultisample(const Point2<int>& p0, const Point2<int>& p1, const Point2<int>& p2,
+                                   const RectI& clipRect, TriangleEdges& tri);
+
+//a convex polygon of count (3..kMaxConvexEdges) vertices in either winding, one edge
+//per side and no diagonals, so shared polygon edges keep the top-left rule.
+//repeated vertices are skipped. otherwise as setupTriangleEdges
+bool setupConvexEdges(const Point2<int>* points, int count, const RectI& clipRect, TriangleEdges& tri);
+bool setupConvexEdgesMultisample(const Point2<int>* points, int count, const RectI& clipRect, TriangleEdges& tri);
+
+//change of edge e from a pixel to its sample s
+inline int64_t sampleDelta(const EdgeFunction& e, int s) {
+  return (int64_t(e.a_) * kSampleOffsetX[s] + int64_t(e.b_) * kSampleOffsetY[s]) / kSubPixelScale;
+}
+
+//a vertex attribute interpolated linearly in screen space,
+//value(x, y) = a_ * x + b_ * y + c_ at integer pixel coordinates
+struct AttributePlane {
+  double a_;
+  double b_;
+  double c_;
+
+  double evaluate(int x, int y) const {
+    return a_ * x + b_ * y + c_;
+  }
+};
+
+//plane through (p0, v0), (p1, v1), (p2, v2), p0..p2 in 28.4 fixed point.
+//the triangle must not be degenerate (setupTriangleEdges returned true)
+AttributePlane setupAttributePlane(const Point2<int>& p0, const Point2<int>& p1, const Point2<int>& p2,
+                                   double v0, double v1, double v2);
+
+//coverage of the block [x0,x1]x[y0,y1] (at most kRasterBlockSize square),
+//bit i of rowMasks[j] is pixel (x0 + i, y0 + j). only edges whose bit is set in
+//edgeMask are tested, the others are known to cover the whole block.
+void computeBlockCoverage(const TriangleEdges& tri, unsigned edgeMask,
+                          int x0, int y0, int x1, int y1, uint8_t rowMasks[kRasterBlockSize]);
+
+//computeBlockCoverage per sample, (rowCoverage[j] >> 4 * i) & 0xF are the samples of pixel (x0 + i, y0 + j)
+void computeBlockSampleCoverage(const TriangleEdges& tri, unsigned edgeMask,
+                                int x0, int y0, int x1, int y1, uint32_t rowCoverage[kRasterBlockSize]);
+
+//writes p to the pixels of row selected by mask (bit i is row[i]), count <= kRasterBlockSize
+void fillMaskedRow(uint32_t* row, int count, unsigned mask, uint32_t p);
+//the same for the rows of a 16-bit and an 8-bit PixelBuffer
+void fillMaskedRow(uint16_t* row, int count, unsigned mask, uint16_t p);
+void fillMaskedRow(uint8_t* row, int count, unsigned mask, uint8_t p);
+
+//Gouraud row: channel c (b, g, r, a) of pixel i is (start[c] + i * step[c]) >> 16
+//clamped to [0, 255], 16.16 fixed point, the sum wrapping in 32 bits. writes the pixels selected by mask
+void shadeMaskedRow(uint32_t* row, int count, unsigned mask, const int32_t start[4], const int32_t step[4]);
+
+//Cohen-Sutherland outcodes of count points against clipRect (inclusive right/bottom),
+//the bits of Renderer::clipLine: 1 west, 2 east, 4 south, 8 north
+void computeOutcodes(const int* xs, const int* ys, int count, const RectI& clipRect, uint8_t* codes);
+
+//walks the blocks touched by tri, a triangle or convex polygon. visitor gets
+//  fullBlock(x0, y0, x1, y1) for blocks entirely inside, and
+//  partialBlock(x0, y0, x1, y1, rowMasks) for blocks crossed by an edge.
+template<typename BlockVisitor>
+void traverseTriangleBlocks(const TriangleEdges& tri, BlockVisitor& visitor) {
+  const int startX = tri.minX_ & ~(kRasterBlockSize - 1);
+  const int startY = tri.minY_ & ~(kRasterBlockSize - 1);
+
+  uint8_t rowMasks[kRasterBlockSize];
+  for (int by = startY; by <= tri.maxY_; by += kRasterBlockSize) {
+    const int y0 = by < tri.minY_ ? tri.minY_ : by;
+    const int y1 = by + kRasterBlockSize - 1 > tri.maxY_ ? tri.maxY_ : by + kRasterBlockSize - 1;
+
+    for (int bx = startX; bx <= tri.maxX_; bx += kRasterBlockSize) {
+      const int x0 = bx < tri.minX_ ? tri.minX_ : bx;
+      const int x1 = bx + kRasterBlockSize - 1 > tri.maxX_ ? tri.maxX_ : bx + kRasterBlockSize - 1;
+
+      //edge functions are linear so the corners bound the whole block
+      unsigned partialEdges = 0;
+      bool outside = false;
+      for (int i = 0; i < tri.edgeCount_ && !outside; ++i) {
+        const EdgeFunction& e = tri.edges_[i];
+        const int64_t e00 = e.evaluate(x0, y0);
+        const int64_t e10 = e.evaluate(x1, y0);
+        const int64_t e01 = e.evaluate(x0, y1);
+        const int64_t e11 = e.evaluate(x1, y1);
+
+        const int insideCorners = (e00 >= 0) + (e10 >= 0) + (e01 >= 0) + (e11 >= 0);
+        if (insideCorners == 0)
+          outside = true;
+        else if (insideCorners < 4)
+          partialEdges |= 1U << i;
+      }
+
+      if (outside)
+        continue;
+
+      if (partialEdges == 0) {
+        visitor.fullBlock(x0, y0, x1, y1);
+      } else {
+        computeBlockCoverage(tri, partialEdges, x0, y0, x1, y1, rowMasks);
+        visitor.partialBlock(x0, y0, x1, y1, rowMasks);
+      }
+    }
+  }
+}
+
+//traverseTriangleBlocks over samples, tri from setupTriangleEdgesMultisample.
+//visitor gets fullBlock(x0, y0, x1, y1) when every sample is inside and
+//partialBlock(x0, y0, x1, y1, rowCoverage) with coverage as computeBlockSampleCoverage
+template<typename BlockVisitor>
+void traverseTriangleBlocksMultisample(const TriangleEdges& tri, BlockVisitor& visitor) {
+  //the samples furthest in and out of each edge
+  int64_t nearest[kMaxConvexEdges], furthest[kMaxConvexEdges];
+  for (int i = 0; i < tri.edgeCount_; ++i) {
+    nearest[i] = furthest[i] = sampleDelta(tri.edges_[i], 0);
+    for (int s = 1; s < kMultisampleCount; ++s) {
+      const int64_t d = sampleDelta(tri.edges_[i], s);
+      nearest[i] = d < nearest[i] ? d : nearest[i];
+      furthest[i] = d > furthest[i] ? d : furthest[i];
+    }
+  }
+
+  const int startX = tri.minX_ & ~(kRasterBlockSize - 1);
+  const int startY = tri.minY_ & ~(kRasterBlockSize - 1);
+
+  uint32_t rowCoverage[kRasterBlockSize];
+  for (int by = startY; by <= tri.maxY_; by += kRasterBlockSize) {
+    const int y0 = by < tri.minY_ ? tri.minY_ : by;
+    const int y1 = by + kRasterBlockSize - 1 > tri.maxY_ ? tri.maxY_ : by + kRasterBlockSize - 1;
+
+    for (int bx = startX; bx <= tri.maxX_; bx += kRasterBlockSize) {
+      const int x0 = bx < tri.minX_ ? tri.minX_ : bx;
+      const int x1 = bx + kRasterBlockSize - 1 > tri.maxX_ ? tri.maxX_ : bx + kRasterBlockSize - 1;
+
+      unsigned partialEdges = 0;
+      bool outside = false;
+      for (int i = 0; i < tri.edgeCount_ && !outside; ++i) {
+        const EdgeFunction& e = tri.edges_[i];
+        const int64_t e00 = e.evaluate(x0, y0);
+        const int64_t e10 = e.evaluate(x1, y0);
+        const int64_t e01 = e.evaluate(x0, y1);
+        const int64_t e11 = e.evaluate(x1, y1);
+
+        const int64_t lo = e00 < e10 ? (e00 < e01 ? (e00 < e11 ? e00 : e11) : (e01 < e11 ? e01 : e11))
+                                     : (e10 < e01 ? (e10 < e11 ? e10 : e11) : (e01 < e11 ? e01 : e11));
+        const int64_t hi = e00 > e10 ? (e00 > e01 ? (e00 > e11 ? e00 : e11) : (e01 > e11 ? e01 : e11))
+                                     : (e10 > e01 ? (e10 > e11 ? e10 : e11) : (e01 > e11 ? e01 : e11));
+        if (hi + furthest[i] < 0)
+          outside = true;
+        else if (lo + nearest[i] < 0)
+          partialEdges |= 1U << i;
+      }
+
+      if (outside)
+        continue;
+
+      if (partialEdges == 0) {
+        visitor.fullBlock(x0, y0, x1, y1);
+      } else {
+        computeBlockSampleCoverage(tri, partialEdges, x0, y0, x1, y1, rowCoverage);
+        visitor.partialBlock(x0, y0, x1, y1, rowCoverage);
+      }
+    }
+  }
+}
+
+}// namespace s3d
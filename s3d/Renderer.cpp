@@ -1,5 +1,11 @@
 #include "stdafx.h"
 #include "Renderer.h"
+#include "Rasterizer.h"
+#include "DepthBuffer.h"
+#include "Texture.h"
+#include "FrameTiles.h"
+#include "Multisample.h"
+#include "PixelFormat.h"
 
 using namespace std;
 
@@ -9,9 +15,528 @@ namespace s3d
 namespace impl
 {
 
+//shaders write the pixels of one block row, dst is pixel (x, y) and
+//bit i of mask selects dst[i]
+class FlatShader {
+public:
+  explicit FlatShader(uint32_t p) : p_(p) {
+  }
+
+  void shadeRow(uint32_t* dst, int /*x*/, int /*y*/, int count, unsigned mask) const {
+    fillMaskedRow(dst, count, mask, p_);
+  }
+
+  void shadeSpan(uint32_t* dst, int /*x*/, int /*y*/, int count) const {
+    fillSpan32(dst, count, p_);
+  }
+
+private:
+  uint32_t p_;
+};
+
+//FlatShader for the rows of a narrower PixelBuffer, p is already in its
+//format (PixelBuffer::encode)
+template<typename Pixel>
+class NativeFlatShader {
+public:
+  explicit NativeFlatShader(Pixel p) : p_(p) {
+  }
+
+  void shadeRow(Pixel* dst, int /*x*/, int /*y*/, int count, unsigned mask) const {
+    fillMaskedRow(dst, count, mask, p_);
+  }
+
+  void shadeSpan(Pixel* dst, int /*x*/, int /*y*/, int count) const {
+    fillMaskedRow(dst, count, (1U << count) - 1, p_);
+  }
+
+private:
+  Pixel p_;
+};
+
+//the rows of a PixelBuffer as Pixel, what the block fillers write through
+template<typename Pixel>
+class PixelRows {
+public:
+  explicit PixelRows(const PixelBuffer& buffer) : buffer_(buffer) {
+  }
+
+  Pixel* getRow(int y) const {
+    return reinterpret_cast<Pixel*>(buffer_.getRow(y));
+  }
+
+private:
+  const PixelBuffer& buffer_;
+};
+
+//colors stepped in 16.16 fixed point along the row, the row start comes from the planes
+class GouraudShader {
+public:
+  explicit GouraudShader(const AttributePlane planes[4]) {
+    for (int c = 0; c < 4; ++c) {
+      planes_[c] = planes[c];
+      step_[c] = toFixed16_16(planes[c].a_);
+    }
+  }
+
+  void shadeRow(uint32_t* dst, int x, int y, int count, unsigned mask) const {
+    int32_t start[4];
+    for (int c = 0; c < 4; ++c) {
+      //+ 0.5 so the >> 16 in shadeMaskedRow rounds
+      start[c] = toFixed16_16(planes_[c].evaluate(x, y) + 0.5);
+    }
+    shadeMaskedRow(dst, count, mask, start, step_);
+  }
+
+  void shadeSpan(uint32_t* dst, int x, int y, int count) const {
+    shadeRow(dst, x, y, count, (1U << count) - 1);
+  }
+
+private:
+  AttributePlane planes_[4];
+  int32_t step_[4];
+};
+
+//u * q, v * q and q = near / z are linear in screen space. u and v are divided
+//out exactly at both ends of the row (one reciprocal each) and stepped in 16.16
+//fixed point in between, so a full block row costs two divides for 8 pixels
+class TextureShader {
+public:
+  TextureShader(const Texture& texture, const AttributePlane& q, const AttributePlane& uq, const AttributePlane& vq)
+    : texture_(texture), q_(q), uq_(uq), vq_(vq) {
+  }
+
+  void shadeRow(uint32_t* dst, int x, int y, int count, unsigned mask) const {
+    double u0, v0, u1, v1;
+    texelAt(x, y, u0, v0);
+    texelAt(x + count, y, u1, v1);
+
+    //keep 16.16 in range for wrapping coordinates, the texture repeats anyway
+    const double baseU = ::floor(u0 / texture_.getWidth()) * texture_.getWidth();
+    const double baseV = ::floor(v0 / texture_.getHeight()) * texture_.getHeight();
+    //stepped unsigned, a saturated step wraps like the texture does
+    uint32_t u = toFixed16_16(u0 - baseU);
+    uint32_t v = toFixed16_16(v0 - baseV);
+    const uint32_t du = toFixed16_16((u1 - u0) / count);
+    const uint32_t dv = toFixed16_16((v1 - v0) / count);
+
+    for (int i = 0; i < count; ++i, u += du, v += dv) {
+      if (mask & (1U << i))
+        dst[i] = texture_.getTexel(static_cast<int>(u >> 16), static_cast<int>(v >> 16));
+    }
+  }
+
+  void shadeSpan(uint32_t* dst, int x, int y, int count) const {
+    shadeRow(dst, x, y, count, (1U << count) - 1);
+  }
+
+private:
+  void texelAt(int x, int y, double& u, double& v) const {
+    double q = q_.evaluate(x, y);
+    //past the triangle edge q can extrapolate to 0, the texels there are never written
+    if (q < 1e-9)
+      q = 1e-9;
+    const double w = 1. / q;
+    u = uq_.evaluate(x, y) * w;
+    v = vq_.evaluate(x, y) * w;
+  }
+
+  const Texture& texture_;
+  AttributePlane q_;
+  AttributePlane uq_;
+  AttributePlane vq_;
+};
+
+//any shader's colors blended into the pixels instead of replacing them
+template<typename Shader>
+class BlendShader {
+public:
+  BlendShader(const Shader& shader, BlendMode mode) : shader_(shader), mode_(mode) {
+  }
+
+  void shadeRow(uint32_t* dst, int x, int y, int count, unsigned mask) const {
+    uint32_t src[kRasterBlockSize];
+    shader_.shadeSpan(src, x, y, count);
+    blendMaskedRow(dst, src, count, mask, mode_);
+  }
+
+  void shadeSpan(uint32_t* dst, int x, int y, int count) const {
+    shadeRow(dst, x, y, count, (1U << count) - 1);
+  }
+
+private:
+  const Shader& shader_;
+  BlendMode mode_;
+};
+
+//Rows is a RendererBuffer, or PixelRows for a pixel target
+template<typename Shader, typename Rows = RendererBuffer>
+class BlockFiller {
+public:
+  BlockFiller(Rows& buffer, FrameTiles* tiles, const Shader& shader) : buffer_(buffer), tiles_(tiles), shader_(shader) {
+  }
+
+  void fullBlock(int x0, int y0, int x1, int y1) {
+    if (tiles_)
+      tiles_->touch(x0, y0, x1, y1);
+    for (int y = y0; y <= y1; ++y) {
+      shader_.shadeSpan(buffer_.getRow(y) + x0, x0, y, x1 - x0 + 1);
+    }
+  }
+
+  void partialBlock(int x0, int y0, int x1, int y1, const uint8_t* rowMasks) {
+    if (tiles_)
+      tiles_->touch(x0, y0, x1, y1);
+    for (int y = y0; y <= y1; ++y) {
+      const unsigned mask = rowMasks[y - y0];
+      if (mask)
+        shader_.shadeRow(buffer_.getRow(y) + x0, x0, y, x1 - x0 + 1, mask);
+    }
+  }
+
+private:
+  Rows& buffer_;
+  FrameTiles* tiles_;
+  const Shader& shader_;
+};
+
+//fill with a depth test, blocks whose nearest depth is behind everything
+//already in their tile are dropped before any pixel is touched
+template<typename Shader, typename Rows = RendererBuffer>
+class DepthBlockFiller {
+public:
+  DepthBlockFiller(Rows& buffer, FrameTiles* tiles, DepthBuffer& depth, const AttributePlane& plane, const Shader& shader)
+    : buffer_(buffer), tiles_(tiles), depth_(depth), plane_(plane), shader_(shader) {
+  }
+
+  void fullBlock(int x0, int y0, int x1, int y1) {
+    uint8_t rowMasks[kRasterBlockSize];
+    for (int j = 0; j < kRasterBlockSize; ++j) {
+      rowMasks[j] = static_cast<uint8_t>((1U << (x1 - x0 + 1)) - 1);
+    }
+    block(x0, y0, x1, y1, rowMasks, true);
+  }
+
+  void partialBlock(int x0, int y0, int x1, int y1, const uint8_t* rowMasks) {
+    block(x0, y0, x1, y1, rowMasks, false);
+  }
+
+private:
+  static float clampDepth(double q) {
+    return static_cast<float>(q < 0. ? 0. : (q > 1. ? 1. : q));
+  }
+
+  void block(int x0, int y0, int x1, int y1, const uint8_t* rowMasks, bool full) {
+    const int tx = x0 / kDepthTileSize;
+    const int ty = y0 / kDepthTileSize;
+
+    //the plane is linear so the corners bound the block
+    const float q00 = clampDepth(plane_.evaluate(x0, y0));
+    const float q10 = clampDepth(plane_.evaluate(x1, y0));
+    const float q01 = clampDepth(plane_.evaluate(x0, y1));
+    const float q11 = clampDepth(plane_.evaluate(x1, y1));
+    const float qMin = min(min(q00, q10), min(q01, q11));
+    const float qMax = max(max(q00, q10), max(q01, q11));
+    const uint32_t dMin = depth_.encode(qMin);
+    const uint32_t dMax = depth_.encode(qMax);
+
+    uint32_t tileMin = depth_.getTileMin(tx, ty);
+    uint32_t tileMax = depth_.getTileMax(tx, ty);
+    if (dMax <= tileMin)
+      return;
+
+    //nearer than everything in the tile, no need to read the stored values
+    const bool test = dMin <= tileMax;
+    if (tiles_)
+      tiles_->touch(x0, y0, x1, y1);
+
+    const int bx = tx * kDepthTileSize;
+    const int by = ty * kDepthTileSize;
+    const int shift = x0 - bx;
+    const float dqdx = static_cast<float>(plane_.a_);
+    bool written = false;
+    for (int y = y0; y <= y1; ++y) {
+      const unsigned mask = rowMasks[y - y0];
+      if (!mask)
+        continue;
+
+      const float q0 = static_cast<float>(plane_.evaluate(bx, y));
+      const unsigned pass = depth_.testAndWriteRow(bx, y, mask << shift, q0, dqdx, qMin, qMax, test);
+      if (pass) {
+        shader_.shadeRow(buffer_.getRow(y) + x0, x0, y, x1 - x0 + 1, pass >> shift);
+        written = true;
+      }
+    }
+
+    if (written)
+      tileMax = max(tileMax, dMax);
+
+    //every pixel of the tile now holds at least dMin
+    const bool wholeTile = x0 == bx && y0 == by &&
+                           x1 == min(bx + kDepthTileSize, depth_.getWidth()) - 1 &&
+                           y1 == min(by + kDepthTileSize, depth_.getHeight()) - 1;
+    if (full && wholeTile)
+      tileMin = max(tileMin, dMin);
+
+    depth_.setTileRange(tx, ty, tileMin, tileMax);
+  }
+
+  Rows& buffer_;
+  FrameTiles* tiles_;
+  DepthBuffer& depth_;
+  const AttributePlane& plane_;
+  const Shader& shader_;
+};
+
+//the shader runs once per pixel with any sample covered, its color
+//is then blended into each covered sample
+template<typename Shader>
+class MultisampleBlockFiller {
+public:
+  MultisampleBlockFiller(MultisampleBuffer& samples, BlendMode mode, const Shader& shader)
+    : samples_(samples), mode_(mode), shader_(shader) {
+  }
+
+  void fullBlock(int x0, int y0, int x1, int y1) {
+    const int count = x1 - x0 + 1;
+    const unsigned mask = (1U << count) - 1;
+    uint32_t src[kRasterBlockSize];
+    for (int y = y0; y <= y1; ++y) {
+      shader_.shadeSpan(src, x0, y, count);
+      for (int s = 0; s < kMultisampleCount; ++s) {
+        blendMaskedRow(samples_.getSampleBuffer(s).getRow(y) + x0, src, count, mask, mode_);
+      }
+    }
+  }
+
+  void partialBlock(int x0, int y0, int x1, int y1, const uint32_t* rowCoverage) {
+    const int count = x1 - x0 + 1;
+    uint32_t src[kRasterBlockSize];
+    for (int y = y0; y <= y1; ++y) {
+      const uint32_t coverage = rowCoverage[y - y0];
+      if (!coverage)
+        continue;
+
+      shader_.shadeRow(src, x0, y, count, sampleRowMask(coverage | (coverage >> 1) | (coverage >> 2) | (coverage >> 3), 0));
+      for (int s = 0; s < kMultisampleCount; ++s) {
+        const unsigned mask = sampleRowMask(coverage, s);
+        if (mask)
+          blendMaskedRow(samples_.getSampleBuffer(s).getRow(y) + x0, src, count, mask, mode_);
+      }
+    }
+  }
+
+private:
+  MultisampleBuffer& samples_;
+  BlendMode mode_;
+  const Shader& shader_;
+};
+
+template<typename Shader, typename Rows>
+void fillTriangleBlocks(Rows& buffer, FrameTiles* tiles, DepthBuffer* depth, const AttributePlane& depthPlane,
+                        const TriangleEdges& tri, const Shader& shader) {
+  if (depth) {
+    DepthBlockFiller<Shader, Rows> filler(buffer, tiles, *depth, depthPlane, shader);
+    traverseTriangleBlocks(tri, filler);
+  } else {
+    BlockFiller<Shader, Rows> filler(buffer, tiles, shader);
+    traverseTriangleBlocks(tri, filler);
+  }
 }
 
-Renderer::Renderer(uint32_t* buffer, int w, int h) : buffer_(buffer, w, h) {
+//a flat fill into target in its own format, no frame tiles there
+template<typename Pixel>
+void fillTriangleBlocksNative(PixelBuffer& target, DepthBuffer* depth, const AttributePlane& depthPlane,
+                              const TriangleEdges& tri, uint32_t p) {
+  PixelRows<Pixel> rows(target);
+  const NativeFlatShader<Pixel> shader(static_cast<Pixel>(target.encode(p)));
+  fillTriangleBlocks(rows, NULL, depth, depthPlane, tri, shader);
+}
+
+//depthPlane is only read with a depth buffer. with samples, tri comes from
+//setupTriangleEdgesMultisample and buffer, tiles and depth are not used
+template<typename Shader>
+void fillTriangleBlocks(RendererBuffer& buffer, MultisampleBuffer* samples, FrameTiles* tiles, DepthBuffer* depth,
+                        const AttributePlane& depthPlane, BlendMode mode, const TriangleEdges& tri, const Shader& shader) {
+  if (samples) {
+    MultisampleBlockFiller<Shader> filler(*samples, mode, shader);
+    traverseTriangleBlocksMultisample(tri, filler);
+  } else if (mode == kBlendReplace) {
+    fillTriangleBlocks(buffer, tiles, depth, depthPlane, tri, shader);
+  } else {
+    const BlendShader<Shader> blended(shader, mode);
+    fillTriangleBlocks(buffer, tiles, depth, depthPlane, tri, blended);
+  }
+}
+
+//marks a vertex of drawIndexedTriangles that has to take the unsnapped path,
+//and a vertex drawIndexedLines cannot draw
+const int kOutOfRasterRange = INT32_MIN;
+
+//drawIndexedLines rounds vertices up to this many pixels out, the clipper works
+//in int and has to take the difference of two coordinates. lines with a vertex
+//past it go through clipLineParametric first
+const int kLineMaxCoord = 1 << 24;
+
+//Liang-Barsky against the scissor in double. false when no part of the line is
+//inside, otherwise the ends are moved onto the scissor. the ends are measured
+//from the endpoint nearer the origin, start + t * d from a far start keeps none
+//of the fraction. with both endpoints far the result can still be off, the
+//caller clamps the rounded ends
+inline bool clipLineParametric(double& x0, double& y0, double& x1, double& y1, const RectI& scissor) {
+  if (!std::isfinite(x0) || !std::isfinite(y0) || !std::isfinite(x1) || !std::isfinite(y1))
+    return false;
+
+  if (fabs(x1) + fabs(y1) < fabs(x0) + fabs(y0))
+    return clipLineParametric(x1, y1, x0, y0, scissor);
+
+  const double dx = x1 - x0, dy = y1 - y0;
+  const double p[4] = {-dx, dx, -dy, dy};
+  const double q[4] = {x0 - scissor.getLeft(), scissor.getRight() - x0, y0 - scissor.getTop(), scissor.getBottom() - y0};
+  double t0 = 0., t1 = 1.;
+  for (int i = 0; i < 4; ++i) {
+    if (p[i] == 0.) {
+      if (q[i] < 0.)
+        return false;
+      continue;
+    }
+
+    const double t = q[i] / p[i];
+    if (p[i] < 0.)
+      t0 = max(t0, t);
+    else
+      t1 = min(t1, t);
+    if (t0 > t1)
+      return false;
+  }
+
+  const double startX = x0, startY = y0;
+  x0 = startX + t0 * dx;
+  y0 = startY + t0 * dy;
+  x1 = startX + t1 * dx;
+  y1 = startY + t1 * dy;
+  return true;
+}
+
+template<typename T>
+inline bool isInRasterRange(const Point2<T>& p) {
+  return p.x_ >= -kRasterMaxCoord && p.x_ <= kRasterMaxCoord &&
+         p.y_ >= -kRasterMaxCoord && p.y_ <= kRasterMaxCoord;
+}
+
+//where a polygon is against the scissor and the guard band, see fillTriangle2D_HalfSpace
+enum ClipClass {
+  kClipRejected,     //off one side of the scissor
+  kClipGuardBand,    //rasterized as it is, the scissor only bounds the block walk
+  kClipNeeded        //reaches past the guard band
+};
+
+template<typename Point>
+ClipClass classifyPolygon(const Point* points, int count, const RectI& scissor) {
+  //a pixel of margin, multisampling covers samples off the pixel position
+  const double left = scissor.getLeft() - 1., right = scissor.getRight() + 1.;
+  const double top = scissor.getTop() - 1., bottom = scissor.getBottom() + 1.;
+  unsigned allOutside = 0xF;
+  bool inBand = true;
+  for (int i = 0; i < count; ++i) {
+    const double x = points[i].x_, y = points[i].y_;
+    const unsigned code = (x < left ? 1U : 0U) | (x > right ? 2U : 0U) | (y > bottom ? 4U : 0U) | (y < top ? 8U : 0U);
+    allOutside &= code;
+    inBand = inBand && x >= -kRasterMaxCoord && x <= kRasterMaxCoord && y >= -kRasterMaxCoord && y <= kRasterMaxCoord;
+  }
+
+  if (allOutside)
+    return kClipRejected;
+  return inBand ? kClipGuardBand : kClipNeeded;
+}
+
+//a vertex for the guard band clipper, attributes have to be linear in screen space
+struct ClipVertex {
+  double x_;
+  double y_;
+  double z_;
+  double attr_[4];
+};
+
+//each band edge adds at most one vertex
+const int kMaxClipVertices = kMaxConvexEdges + 4;
+
+//Sutherland-Hodgman against the guard band, |x| and |y| <= kRasterMaxCoord.
+//returns the vertex count in out, less than 3 when nothing is left
+int clipToGuardBand(const ClipVertex* in, int count, ClipVertex out[kMaxClipVertices]) {
+  assert(count <= kMaxConvexEdges);
+  //four planes ping-ponging between scratch and out, so the last one writes out
+  ClipVertex scratch[kMaxClipVertices];
+  const ClipVertex* src = in;
+  ClipVertex* dst = scratch;
+  for (int plane = 0; plane < 4; ++plane) {
+    //planes x >= -band, x <= band, y >= -band, y <= band
+    const bool vertical = plane < 2;
+    const double side = (plane & 1) ? -1. : 1.;
+    const double bound = -side * kRasterMaxCoord;
+
+    int n = 0;
+    for (int i = 0; i < count; ++i) {
+      const ClipVertex& a = src[i];
+      const ClipVertex& b = src[(i + 1) % count];
+      const double da = side * ((vertical ? a.x_ : a.y_) - bound);
+      const double db = side * ((vertical ? b.x_ : b.y_) - bound);
+      if (da >= 0.)
+        dst[n++] = a;
+      if ((da >= 0.) != (db >= 0.)) {
+        const double t = da / (da - db);
+        ClipVertex& v = dst[n++];
+        v.x_ = vertical ? bound : a.x_ + (b.x_ - a.x_) * t;
+        v.y_ = vertical ? a.y_ + (b.y_ - a.y_) * t : bound;
+        v.z_ = a.z_ + (b.z_ - a.z_) * t;
+        for (int k = 0; k < 4; ++k) {
+          v.attr_[k] = a.attr_[k] + (b.attr_[k] - a.attr_[k]) * t;
+        }
+      }
+    }
+
+    count = n;
+    src = dst;
+    dst = dst == out ? scratch : out;
+    if (count < 3)
+      return 0;
+  }
+
+  //rounding can leave a coordinate a hair past the band
+  for (int i = 0; i < count; ++i) {
+    out[i].x_ = out[i].x_ < -kRasterMaxCoord ? -kRasterMaxCoord : (out[i].x_ > kRasterMaxCoord ? kRasterMaxCoord : out[i].x_);
+    out[i].y_ = out[i].y_ < -kRasterMaxCoord ? -kRasterMaxCoord : (out[i].y_ > kRasterMaxCoord ? kRasterMaxCoord : out[i].y_);
+  }
+  return count;
+}
+
+//the fan triangle (0, i, i + 1) of largest area, its plane is the steadiest
+int widestFanTriangle(const Point2<int>* points, int count) {
+  int widest = 1;
+  int64_t widestArea = 0;
+  for (int i = 1; i + 1 < count; ++i) {
+    int64_t area = int64_t(points[i].x_ - points[0].x_) * (points[i + 1].y_ - points[0].y_) -
+                   int64_t(points[i].y_ - points[0].y_) * (points[i + 1].x_ - points[0].x_);
+    area = area < 0 ? -area : area;
+    if (area > widestArea) {
+      widest = i;
+      widestArea = area;
+    }
+  }
+  return widest;
+}
+
+}
+
+Renderer::Renderer(uint32_t* buffer, int w, int h)
+  : buffer_(buffer, w, h), depth_(NULL), frameTiles_(NULL), samples_(NULL), pixelTarget_(NULL), blendMode_(kBlendReplace), scissor_(0, 0, w - 1, h - 1) {
+#ifdef WIN32_GDI_RENDERDER
+  hdc_ = NULL;
+#endif
+}
+
+Renderer::Renderer(const RendererBuffer& buffer)
+  : buffer_(buffer), depth_(NULL), frameTiles_(NULL), samples_(NULL), pixelTarget_(NULL), blendMode_(kBlendReplace), scissor_(0, 0, buffer.getWidth() - 1, buffer.getHeight() - 1) {
 #ifdef WIN32_GDI_RENDERDER
   hdc_ = NULL;
 #endif
@@ -21,16 +546,50 @@ Renderer::Renderer(uint32_t* buffer, int w, int h) : buffer_(buffer, w, h) {
 Renderer::~Renderer() {
 }
 
+void Renderer::setDepthBuffer(DepthBuffer* depth) {
+  assert(!depth || (depth->getWidth() == buffer_.getWidth() && depth->getHeight() == buffer_.getHeight()));
+  assert(!depth || !samples_);
+  depth_ = depth;
+}
+
+void Renderer::setFrameTiles(FrameTiles* tiles) {
+  frameTiles_ = tiles;
+}
+
+void Renderer::setMultisampleBuffer(MultisampleBuffer* samples) {
+  assert(!samples || (samples->getWidth() == buffer_.getWidth() && samples->getHeight() == buffer_.getHeight()));
+  assert(!samples || !depth_);
+  assert(!samples || !pixelTarget_);
+  samples_ = samples;
+}
+
+void Renderer::setPixelTarget(PixelBuffer* target) {
+  assert(!target || (target->getWidth() == buffer_.getWidth() && target->getHeight() == buffer_.getHeight()));
+  assert(!target || !samples_);
+  if (target && target->getFormat() == kPixelFormatIndexed8)
+    target->getPalette().prepareLookup();
+  pixelTarget_ = target;
+}
+
+void Renderer::setBlendMode(BlendMode mode) {
+  blendMode_ = mode;
+}
+
+void Renderer::setScissor(const RectI& rect) {
+  const int left = max(rect.getLeft(), 0);
+  const int top = max(rect.getTop(), 0);
+  const int right = min(rect.getRight(), buffer_.getWidth() - 1);
+  const int bottom = min(rect.getBottom(), buffer_.getHeight() - 1);
+  scissor_ = RectI(left, top, right - left, bottom - top);
+}
+
 void Renderer::drawLine2D_Horizontal(const Point2<int>& p0, const Point2<int>& p1, const Color& c) {
   assert(p0.y_ == p1.y_);
-  const int steps = abs(p1.x_ - p0.x_);
-  int startX = p1.x_ < p0.x_ ? p1.x_ : p0.x_;
+  const int startX = p1.x_ < p0.x_ ? p1.x_ : p0.x_;
+  const int endX = p1.x_ < p0.x_ ? p0.x_ : p1.x_;
+  assert(startX >= 0 && endX < buffer_.getWidth());
 
-  buffer_.setPixel(p0.x_, p0.y_, c.getABGRValue());
-  for (int i = 0; i < steps; ++i) {
-    startX++;
-    buffer_.setPixel(startX, p0.y_, c.getABGRValue());
-  }
+  buffer_.fillSpan(startX, endX, p0.y_, c.getABGRValue());
 }
 
 void Renderer::drawLine2D_Vertical(const Point2<int>& p0, const Point2<int>& p1, const Color& c) {
@@ -127,26 +686,138 @@ void Renderer::drawLine2D_Bresenham(const Point2<int>& p0, const Point2<int>& p1
 }
 
 void Renderer::drawPixel2D(const Point2<int>& p0, const Color& c) {
+  if (samples_) {
+    for (int s = 0; s < kMultisampleCount; ++s) {
+      samples_->getSampleBuffer(s).setPixel(p0.x_, p0.y_, c.getABGRValue());
+    }
+    return;
+  }
+
+  if (frameTiles_)
+    frameTiles_->touch(p0.x_, p0.y_, p0.x_, p0.y_);
   buffer_.setPixel(p0.x_, p0.y_, c.getABGRValue());
 }
 
 void Renderer::drawLine2D(const Point2<int>& p0, const Point2<int>& p1, const Color& c) {
   Point2<int> cp0 = p0;
   Point2<int> cp1 = p1;
-  if (!clipLine(cp0, cp1, RectI(0, 0, buffer_.getWidth() -1, buffer_.getHeight() -1)))
+  if (!clipLine(cp0, cp1, scissor_))
     return;
   
-  if (cp1.x_ == cp0.x_) {
-    drawLine2D_Vertical(cp0, cp1, c);
+  drawClippedLine2D(cp0, cp1, c);
+}
+
+void Renderer::drawClippedLine2D(const Point2<int>& p0, const Point2<int>& p1, const Color& c) {
+  if (samples_) {
+    //the line drawers write buffer_, so point it at each sample plane in turn
+    MultisampleBuffer* samples = samples_;
+    const RendererBuffer target = buffer_;
+    samples_ = NULL;
+    for (int s = 0; s < kMultisampleCount; ++s) {
+      buffer_ = samples->getSampleBuffer(s);
+      drawClippedLine2D(p0, p1, c);
+    }
+    buffer_ = target;
+    samples_ = samples;
+    return;
+  }
+
+  if (frameTiles_)
+    frameTiles_->touch(min(p0.x_, p1.x_), min(p0.y_, p1.y_), max(p0.x_, p1.x_), max(p0.y_, p1.y_));
+
+  if (p1.x_ == p0.x_) {
+    drawLine2D_Vertical(p0, p1, c);
     return;
   }
 
-  if (cp1.y_ == cp0.y_) {
-    drawLine2D_Horizontal(cp0, cp1, c);
+  if (p1.y_ == p0.y_) {
+    drawLine2D_Horizontal(p0, p1, c);
     return;
   }
 
-  drawLine2D_Bresenham(cp0, cp1, c);
+  drawLine2D_Bresenham(p0, p1, c);
+}
+
+void Renderer::drawIndexedLines(const Point4<double>* vertices, int vertexCount,
+                                const uint32_t* indices, int lineCount, const Color& c) {
+  lineXs_.resize(vertexCount);
+  lineYs_.resize(vertexCount);
+  outcodes_.resize(vertexCount);
+  for (int i = 0; i < vertexCount; ++i) {
+    const double x = vertices[i].x_, y = vertices[i].y_;
+    if (x >= -impl::kLineMaxCoord && x <= impl::kLineMaxCoord && y >= -impl::kLineMaxCoord && y <= impl::kLineMaxCoord) {
+      lineXs_[i] = static_cast<int>(::floor(x + 0.5));
+      lineYs_[i] = static_cast<int>(::floor(y + 0.5));
+    } else {
+      lineXs_[i] = lineYs_[i] = impl::kOutOfRasterRange;
+    }
+  }
+  computeOutcodes(lineXs_.data(), lineYs_.data(), vertexCount, scissor_, outcodes_.data());
+
+  for (int l = 0; l < lineCount; ++l, indices += 2) {
+    const uint32_t i0 = indices[0], i1 = indices[1];
+    assert(i0 < uint32_t(vertexCount) && i1 < uint32_t(vertexCount));
+
+    //a vertex too far out to round, clipped in double and rounded after
+    if (lineXs_[i0] == impl::kOutOfRasterRange || lineXs_[i1] == impl::kOutOfRasterRange) {
+      double x0 = vertices[i0].x_, y0 = vertices[i0].y_, x1 = vertices[i1].x_, y1 = vertices[i1].y_;
+      if (impl::clipLineParametric(x0, y0, x1, y1, scissor_)) {
+        //the drawing below does not check bounds again
+        const RectI& sc = scissor_;
+        auto roundX = [&sc](double x) { return static_cast<int>(::floor(min(max(x, double(sc.getLeft())), double(sc.getRight())) + 0.5)); };
+        auto roundY = [&sc](double y) { return static_cast<int>(::floor(min(max(y, double(sc.getTop())), double(sc.getBottom())) + 0.5)); };
+        drawClippedLine2D(Point2<int>(roundX(x0), roundY(y0)), Point2<int>(roundX(x1), roundY(y1)), c);
+      }
+      continue;
+    }
+
+    //both beyond the same edge
+    if (outcodes_[i0] & outcodes_[i1])
+      continue;
+
+    Point2<int> p0(lineXs_[i0], lineYs_[i0]);
+    Point2<int> p1(lineXs_[i1], lineYs_[i1]);
+    if ((outcodes_[i0] | outcodes_[i1]) && !clipLine(p0, p1, scissor_))
+      continue;
+
+    drawClippedLine2D(p0, p1, c);
+  }
+}
+
+void Renderer::fillSpan2D(int x0, int x1, int y, uint32_t p) {
+  if (x0 > x1)
+    swap(x0, x1);
+
+  if (y < scissor_.getTop() || y > scissor_.getBottom())
+    return;
+
+  x0 = max(x0, scissor_.getLeft());
+  x1 = min(x1, scissor_.getRight());
+  if (x0 > x1)
+    return;
+
+  if (samples_) {
+    for (int s = 0; s < kMultisampleCount; ++s) {
+      uint32_t* row = samples_->getSampleBuffer(s).getRow(y) + x0;
+      if (blendMode_ == kBlendReplace)
+        fillSpan32(row, x1 - x0 + 1, p);
+      else
+        blendSpan32(row, x1 - x0 + 1, p, blendMode_);
+    }
+    return;
+  }
+
+  if (pixelTarget_ && blendMode_ == kBlendReplace) {
+    pixelTarget_->fillSpan(x0, x1, y, p);
+    return;
+  }
+
+  if (frameTiles_)
+    frameTiles_->touch(x0, y, x1, y);
+  if (blendMode_ == kBlendReplace)
+    buffer_.fillSpan(x0, x1, y, p);
+  else
+    blendSpan32(buffer_.getRow(y) + x0, x1 - x0 + 1, p, blendMode_);
 }
 
 void Renderer::drawTriangle2D(const Point2<int>& p0, const Point2<int>& p1, const Point2<int>& p2, const Color& c) {
@@ -179,9 +850,10 @@ void Renderer::fillFlatTopTriangle2D(const Point2<int>& p0, const Point2<int>& p
   double x0 = dp0.x_ + m0;
   double x1 = dp1.x_ + m1;
 
-  drawLine2D(p0, p1, c);
+  const uint32_t pixel = c.getABGRValue();
+  fillSpan2D(dp0.x_, dp1.x_, dp0.y_, pixel);
   for (int i = 0; i < steps; ++i) {
-    drawLine2D({static_cast<int>(x0 + 0.5), y}, {static_cast<int>(x1 + 0.5), y}, c);
+    fillSpan2D(static_cast<int>(x0 + 0.5), static_cast<int>(x1 + 0.5), y, pixel);
     ++y;
     x0 += m0;
     x1 += m1;
@@ -213,9 +885,10 @@ void Renderer::fillFlatBottomTriangle2D(const Point2<int>& p0, const Point2<int>
   double x0 = dp0.x_ + m0;
   double x1 = dp1.x_ + m1;
 
-  drawLine2D(p0, p1, c);
+  const uint32_t pixel = c.getABGRValue();
+  fillSpan2D(dp0.x_, dp1.x_, dp0.y_, pixel);
   for (int i = 0; i < steps; ++i) {
-    drawLine2D({static_cast<int>(x0 + 0.5), y}, {static_cast<int>(x1 + 0.5), y}, c);
+    fillSpan2D(static_cast<int>(x0 + 0.5), static_cast<int>(x1 + 0.5), y, pixel);
     --y;
     x0 += m0;
     x1 += m1;
@@ -249,6 +922,349 @@ void Renderer::fillTriangle2D(const Point2<int>& p0, const Point2<int>& p1, cons
   }
 }
 
+void Renderer::fillTriangle2D_HalfSpace(const Point2<int>& p0, const Point2<int>& p1, const Point2<int>& p2, const Color& c) {
+  const Point2<double> points[3] = {Point2<double>(p0.x_, p0.y_), Point2<double>(p1.x_, p1.y_), Point2<double>(p2.x_, p2.y_)};
+  fillTriangle2D_SubPixel(points[0], points[1], points[2], c);
+}
+
+void Renderer::fillTriangle2D_SubPixel(const Point2<double>& p0, const Point2<double>& p1, const Point2<double>& p2, const Color& c) {
+  const Point2<double> points[3] = {p0, p1, p2};
+  switch (impl::classifyPolygon(points, 3, scissor_)) {
+  case impl::kClipRejected:
+    return;
+  case impl::kClipNeeded: {
+    const Point3<double> clipped[3] = {Point3<double>(p0.x_, p0.y_, 0.), Point3<double>(p1.x_, p1.y_, 0.), Point3<double>(p2.x_, p2.y_, 0.)};
+    return fillClippedPolygon(clipped, 3, c.getABGRValue(), false);
+  }
+  default:
+    return fillTriangleFixed(toFixed28_4(p0), toFixed28_4(p1), toFixed28_4(p2), c.getABGRValue());
+  }
+}
+
+void Renderer::fillTriangle3D_Depth(const Point3<double>& p0, const Point3<double>& p1, const Point3<double>& p2, const Color& c) {
+  const Point3<double> points[3] = {p0, p1, p2};
+  switch (impl::classifyPolygon(points, 3, scissor_)) {
+  case impl::kClipRejected:
+    return;
+  case impl::kClipNeeded:
+    return fillClippedPolygon(points, 3, c.getABGRValue(), true);
+  default:
+    return fillTriangleFixed(toFixed28_4(Point2<double>(p0.x_, p0.y_)), toFixed28_4(Point2<double>(p1.x_, p1.y_)),
+                             toFixed28_4(Point2<double>(p2.x_, p2.y_)), p0.z_, p1.z_, p2.z_, c.getABGRValue());
+  }
+}
+
+void Renderer::drawIndexedTriangles(const Point4<double>* vertices, int vertexCount,
+                                    const uint32_t* indices, int triangleCount, const Color* colors) {
+  snapVertices(vertices, vertexCount);
+  for (int t = 0; t < triangleCount; ++t, indices += 3) {
+    const uint32_t i0 = indices[0], i1 = indices[1], i2 = indices[2];
+    assert(i0 < uint32_t(vertexCount) && i1 < uint32_t(vertexCount) && i2 < uint32_t(vertexCount));
+
+    const Point2<int>& f0 = fixedVertices_[i0];
+    const Point2<int>& f1 = fixedVertices_[i1];
+    const Point2<int>& f2 = fixedVertices_[i2];
+    if (f0.x_ == impl::kOutOfRasterRange || f1.x_ == impl::kOutOfRasterRange || f2.x_ == impl::kOutOfRasterRange) {
+      fillTriangle3D_Depth(Point3<double>(vertices[i0].x_, vertices[i0].y_, vertices[i0].z_),
+                           Point3<double>(vertices[i1].x_, vertices[i1].y_, vertices[i1].z_),
+                           Point3<double>(vertices[i2].x_, vertices[i2].y_, vertices[i2].z_), colors[t]);
+      continue;
+    }
+
+    fillTriangleFixed(f0, f1, f2, vertices[i0].z_, vertices[i1].z_, vertices[i2].z_, colors[t].getABGRValue());
+  }
+}
+
+void Renderer::fillConvexPolygon3D_Depth(const Point3<double>* points, int count, const Color& c) {
+  assert(count >= 3 && count <= kMaxConvexEdges);
+  switch (impl::classifyPolygon(points, count, scissor_)) {
+  case impl::kClipRejected:
+    return;
+  case impl::kClipNeeded:
+    return fillClippedPolygon(points, count, c.getABGRValue(), true);
+  default:
+    break;
+  }
+
+  Point2<int> fixed[kMaxConvexEdges];
+  double zs[kMaxConvexEdges];
+  for (int i = 0; i < count; ++i) {
+    fixed[i] = toFixed28_4(Point2<double>(points[i].x_, points[i].y_));
+    zs[i] = points[i].z_;
+  }
+  fillPolygonFixed(fixed, zs, count, c.getABGRValue());
+}
+
+void Renderer::drawIndexedPolygons(const Point4<double>* vertices, int vertexCount, const uint32_t* indices,
+                                   const uint8_t* vertexCounts, int polygonCount, const Color* colors) {
+  snapVertices(vertices, vertexCount);
+  Point2<int> fixed[kMaxConvexEdges];
+  Point3<double> points[kMaxConvexEdges];
+  double zs[kMaxConvexEdges];
+  for (int k = 0; k < polygonCount; indices += vertexCounts[k], ++k) {
+    const int count = vertexCounts[k];
+    assert(count >= 3 && count <= kMaxConvexEdges);
+
+    bool snapped = true;
+    for (int i = 0; i < count; ++i) {
+      assert(indices[i] < uint32_t(vertexCount));
+      fixed[i] = fixedVertices_[indices[i]];
+      zs[i] = vertices[indices[i]].z_;
+      snapped = snapped && fixed[i].x_ != impl::kOutOfRasterRange;
+    }
+
+    if (!snapped) {
+      for (int i = 0; i < count; ++i) {
+        points[i] = Point3<double>(vertices[indices[i]].x_, vertices[indices[i]].y_, zs[i]);
+      }
+      fillConvexPolygon3D_Depth(points, count, colors[k]);
+      continue;
+    }
+
+    fillPolygonFixed(fixed, zs, count, colors[k].getABGRValue());
+  }
+}
+
+void Renderer::fillTriangle3D_Gouraud(const Point3<double>& p0, const Point3<double>& p1, const Point3<double>& p2,
+                                      const Color& c0, const Color& c1, const Color& c2) {
+  const Point3<double> points[3] = {p0, p1, p2};
+  const Color colors[3] = {c0, c1, c2};
+  const impl::ClipClass clip = impl::classifyPolygon(points, 3, scissor_);
+  if (clip == impl::kClipRejected)
+    return;
+  if (clip == impl::kClipNeeded)
+    return fillClippedTriangleGouraud(points, colors);
+
+  const Point2<double> s0(p0.x_, p0.y_), s1(p1.x_, p1.y_), s2(p2.x_, p2.y_);
+  fillTriangleGouraudFixed(toFixed28_4(s0), toFixed28_4(s1), toFixed28_4(s2), p0.z_, p1.z_, p2.z_, colors);
+}
+
+void Renderer::drawIndexedTrianglesGouraud(const Point4<double>* vertices, const Color* vertexColors, int vertexCount,
+                                           const uint32_t* indices, int triangleCount) {
+  snapVertices(vertices, vertexCount);
+  for (int t = 0; t < triangleCount; ++t, indices += 3) {
+    const uint32_t i0 = indices[0], i1 = indices[1], i2 = indices[2];
+    assert(i0 < uint32_t(vertexCount) && i1 < uint32_t(vertexCount) && i2 < uint32_t(vertexCount));
+
+    const Point2<int>& f0 = fixedVertices_[i0];
+    const Point2<int>& f1 = fixedVertices_[i1];
+    const Point2<int>& f2 = fixedVertices_[i2];
+    if (f0.x_ == impl::kOutOfRasterRange || f1.x_ == impl::kOutOfRasterRange || f2.x_ == impl::kOutOfRasterRange) {
+      fillTriangle3D_Gouraud(Point3<double>(vertices[i0].x_, vertices[i0].y_, vertices[i0].z_),
+                             Point3<double>(vertices[i1].x_, vertices[i1].y_, vertices[i1].z_),
+                             Point3<double>(vertices[i2].x_, vertices[i2].y_, vertices[i2].z_),
+                             vertexColors[i0], vertexColors[i1], vertexColors[i2]);
+      continue;
+    }
+
+    const Color colors[3] = {vertexColors[i0], vertexColors[i1], vertexColors[i2]};
+    fillTriangleGouraudFixed(f0, f1, f2, vertices[i0].z_, vertices[i1].z_, vertices[i2].z_, colors);
+  }
+}
+
+void Renderer::fillTriangle3D_Textured(const Point3<double>& p0, const Point3<double>& p1, const Point3<double>& p2,
+                                       const Point2<double>& uv0, const Point2<double>& uv1, const Point2<double>& uv2,
+                                       const Texture& texture) {
+  const Point3<double> points[3] = {p0, p1, p2};
+  const Point2<double> uvs[3] = {uv0, uv1, uv2};
+  const impl::ClipClass clip = impl::classifyPolygon(points, 3, scissor_);
+  if (clip == impl::kClipRejected)
+    return;
+  if (clip == impl::kClipNeeded)
+    return fillClippedTriangleTextured(points, uvs, texture);
+
+  const Point2<double> s0(p0.x_, p0.y_), s1(p1.x_, p1.y_), s2(p2.x_, p2.y_);
+  fillTriangleTexturedFixed(toFixed28_4(s0), toFixed28_4(s1), toFixed28_4(s2), p0.z_, p1.z_, p2.z_, uvs, texture);
+}
+
+void Renderer::snapVertices(const Point4<double>* vertices, int vertexCount) {
+  //snap every vertex once, shared vertices are not set up again per triangle
+  fixedVertices_.resize(vertexCount);
+  for (int i = 0; i < vertexCount; ++i) {
+    const Point2<double> s(vertices[i].x_, vertices[i].y_);
+    fixedVertices_[i] = impl::isInRasterRange(s) ? toFixed28_4(s) : Point2<int>(impl::kOutOfRasterRange, impl::kOutOfRasterRange);
+  }
+}
+
+bool Renderer::setupTriangle(const Point2<int>& p0, const Point2<int>& p1, const Point2<int>& p2, TriangleEdges& tri) const {
+  if (samples_)
+    return setupTriangleEdgesMultisample(p0, p1, p2, scissor_, tri);
+  return setupTriangleEdges(p0, p1, p2, scissor_, tri);
+}
+
+bool Renderer::setupPolygon(const Point2<int>* points, int count, TriangleEdges& tri) const {
+  if (samples_)
+    return setupConvexEdgesMultisample(points, count, scissor_, tri);
+  return setupConvexEdges(points, count, scissor_, tri);
+}
+
+void Renderer::fillTriangleGouraudFixed(const Point2<int>& p0, const Point2<int>& p1, const Point2<int>& p2,
+                                        double z0, double z1, double z2, const Color colors[3]) {
+  TriangleEdges tri;
+  if (!setupTriangle(p0, p1, p2, tri))
+    return;
+
+  AttributePlane planes[4];
+  for (int c = 0; c < 4; ++c) {
+    planes[c] = setupAttributePlane(p0, p1, p2, colors[0].getValue(c), colors[1].getValue(c), colors[2].getValue(c));
+  }
+  const impl::GouraudShader shader(planes);
+  const AttributePlane plane = setupAttributePlane(p0, p1, p2, z0, z1, z2);
+  impl::fillTriangleBlocks(buffer_, samples_, frameTiles_, depth_, plane, blendMode_, tri, shader);
+}
+
+void Renderer::fillTriangleTexturedFixed(const Point2<int>& p0, const Point2<int>& p1, const Point2<int>& p2,
+                                         double z0, double z1, double z2, const Point2<double> uvs[3], const Texture& texture) {
+  TriangleEdges tri;
+  if (!setupTriangle(p0, p1, p2, tri))
+    return;
+
+  //texel units, so the shader only has to divide by q
+  const double w = texture.getWidth(), h = texture.getHeight();
+  const AttributePlane plane = setupAttributePlane(p0, p1, p2, z0, z1, z2);
+  const AttributePlane uq = setupAttributePlane(p0, p1, p2, uvs[0].x_ * w * z0, uvs[1].x_ * w * z1, uvs[2].x_ * w * z2);
+  const AttributePlane vq = setupAttributePlane(p0, p1, p2, uvs[0].y_ * h * z0, uvs[1].y_ * h * z1, uvs[2].y_ * h * z2);
+  const impl::TextureShader shader(texture, plane, uq, vq);
+  impl::fillTriangleBlocks(buffer_, samples_, frameTiles_, depth_, plane, blendMode_, tri, shader);
+}
+
+void Renderer::fillTriangleFixed(const Point2<int>& p0, const Point2<int>& p1, const Point2<int>& p2,
+                                 double z0, double z1, double z2, uint32_t p) {
+  if (!depth_)
+    return fillTriangleFixed(p0, p1, p2, p);
+
+  TriangleEdges tri;
+  if (!setupTriangle(p0, p1, p2, tri))
+    return;
+
+  const AttributePlane plane = setupAttributePlane(p0, p1, p2, z0, z1, z2);
+  fillFlatBlocks(tri, depth_, plane, p);
+}
+
+void Renderer::fillTriangleFixed(const Point2<int>& p0, const Point2<int>& p1, const Point2<int>& p2, uint32_t p) {
+  TriangleEdges tri;
+  if (!setupTriangle(p0, p1, p2, tri))
+    return;
+
+  const AttributePlane noDepth = {0., 0., 0.};
+  fillFlatBlocks(tri, NULL, noDepth, p);
+}
+
+void Renderer::fillPolygonFixed(const Point2<int>* points, const double* zs, int count, uint32_t p) {
+  TriangleEdges tri;
+  if (!setupPolygon(points, count, tri))
+    return;
+
+  if (!zs || !depth_) {
+    const AttributePlane noDepth = {0., 0., 0.};
+    return fillFlatBlocks(tri, NULL, noDepth, p);
+  }
+
+  const int i = impl::widestFanTriangle(points, count);
+  const AttributePlane plane = setupAttributePlane(points[0], points[i], points[i + 1], zs[0], zs[i], zs[i + 1]);
+  fillFlatBlocks(tri, depth_, plane, p);
+}
+
+void Renderer::fillFlatBlocks(const TriangleEdges& tri, DepthBuffer* depth, const AttributePlane& depthPlane, uint32_t p) {
+  if (!pixelTarget_ || blendMode_ != kBlendReplace) {
+    const impl::FlatShader shader(p);
+    return impl::fillTriangleBlocks(buffer_, samples_, frameTiles_, depth, depthPlane, blendMode_, tri, shader);
+  }
+
+  switch (pixelTarget_->getFormat()) {
+  case kPixelFormatRGB565:
+    impl::fillTriangleBlocksNative<uint16_t>(*pixelTarget_, depth, depthPlane, tri, p);
+    break;
+  case kPixelFormatIndexed8:
+    impl::fillTriangleBlocksNative<uint8_t>(*pixelTarget_, depth, depthPlane, tri, p);
+    break;
+  default: {
+    impl::PixelRows<uint32_t> rows(*pixelTarget_);
+    const impl::FlatShader shader(p);
+    impl::fillTriangleBlocks(rows, NULL, depth, depthPlane, tri, shader);
+  } break;
+  }
+}
+
+void Renderer::fillClippedPolygon(const Point3<double>* points, int count, uint32_t p, bool depthTested) {
+  impl::ClipVertex in[kMaxConvexEdges], out[impl::kMaxClipVertices];
+  for (int i = 0; i < count; ++i) {
+    in[i].x_ = points[i].x_;
+    in[i].y_ = points[i].y_;
+    in[i].z_ = points[i].z_;
+    in[i].attr_[0] = in[i].attr_[1] = in[i].attr_[2] = in[i].attr_[3] = 0.;
+  }
+  const int n = impl::clipToGuardBand(in, count, out);
+
+  //the clipped polygon can outgrow the convex filler, the pieces share vertex 0
+  Point2<int> fixed[kMaxConvexEdges];
+  double zs[kMaxConvexEdges];
+  for (int first = 1; first + 1 < n; first += kMaxConvexEdges - 2) {
+    const int last = min(first + kMaxConvexEdges - 2, n - 1);
+    fixed[0] = toFixed28_4(Point2<double>(out[0].x_, out[0].y_));
+    zs[0] = out[0].z_;
+    int k = 1;
+    for (int i = first; i <= last; ++i, ++k) {
+      fixed[k] = toFixed28_4(Point2<double>(out[i].x_, out[i].y_));
+      zs[k] = out[i].z_;
+    }
+    fillPolygonFixed(fixed, depthTested ? zs : NULL, k, p);
+  }
+}
+
+void Renderer::fillClippedTriangleGouraud(const Point3<double> points[3], const Color colors[3]) {
+  impl::ClipVertex in[3], out[impl::kMaxClipVertices];
+  for (int i = 0; i < 3; ++i) {
+    in[i].x_ = points[i].x_;
+    in[i].y_ = points[i].y_;
+    in[i].z_ = points[i].z_;
+    for (int c = 0; c < 4; ++c) {
+      in[i].attr_[c] = colors[i].getValue(c);
+    }
+  }
+  const int n = impl::clipToGuardBand(in, 3, out);
+
+  Point2<int> fixed[impl::kMaxClipVertices];
+  Color clippedColors[impl::kMaxClipVertices];
+  for (int i = 0; i < n; ++i) {
+    fixed[i] = toFixed28_4(Point2<double>(out[i].x_, out[i].y_));
+    for (int c = 0; c < 4; ++c) {
+      clippedColors[i].setValue(c, static_cast<uint8_t>(::floor(out[i].attr_[c] + 0.5)));
+    }
+  }
+
+  for (int i = 1; i + 1 < n; ++i) {
+    const Color fan[3] = {clippedColors[0], clippedColors[i], clippedColors[i + 1]};
+    fillTriangleGouraudFixed(fixed[0], fixed[i], fixed[i + 1], out[0].z_, out[i].z_, out[i + 1].z_, fan);
+  }
+}
+
+void Renderer::fillClippedTriangleTextured(const Point3<double> points[3], const Point2<double> uvs[3], const Texture& texture) {
+  //u * q and v * q are the screen linear ones
+  impl::ClipVertex in[3], out[impl::kMaxClipVertices];
+  for (int i = 0; i < 3; ++i) {
+    in[i].x_ = points[i].x_;
+    in[i].y_ = points[i].y_;
+    in[i].z_ = points[i].z_;
+    in[i].attr_[0] = uvs[i].x_ * points[i].z_;
+    in[i].attr_[1] = uvs[i].y_ * points[i].z_;
+    in[i].attr_[2] = in[i].attr_[3] = 0.;
+  }
+  const int n = impl::clipToGuardBand(in, 3, out);
+
+  Point2<int> fixed[impl::kMaxClipVertices];
+  Point2<double> clippedUvs[impl::kMaxClipVertices];
+  for (int i = 0; i < n; ++i) {
+    fixed[i] = toFixed28_4(Point2<double>(out[i].x_, out[i].y_));
+    clippedUvs[i] = Point2<double>(out[i].attr_[0] / out[i].z_, out[i].attr_[1] / out[i].z_);
+  }
+
+  for (int i = 1; i + 1 < n; ++i) {
+    const Point2<double> fan[3] = {clippedUvs[0], clippedUvs[i], clippedUvs[i + 1]};
+    fillTriangleTexturedFixed(fixed[0], fixed[i], fixed[i + 1], out[0].z_, out[i].z_, out[i + 1].z_, fan, texture);
+  }
+}
+
 namespace
 {
 Point2<int> intersectPoint(const unsigned pCode, const Point2<int>& p, const double dx, const double dy, int clipMinX, int clipMinY, int clipMaxX, int clipMaxY) {
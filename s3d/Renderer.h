@@ -1,21 +1,73 @@
 #pragma once
 #include <cstdint>
+#include <algorithm>
+#include <vector>
 #include "math/Point.h"
 #include "Color.h"
 #include "Rect.h"
+#include "SpanFill.h"
+#include "Blend.h"
 
 namespace s3d
 {
 
+//a non-owning view of a 32-bit pixel surface, pitch is in pixels
 class RendererBuffer {
 public:
-  RendererBuffer(uint32_t* buffer, int w, int h) : buffer_(buffer), width_(w), height_(h){
+  RendererBuffer(uint32_t* buffer, int w, int h) : buffer_(buffer), width_(w), height_(h), pitch_(w) {
     assert(buffer_);
   }
 
+  RendererBuffer(uint32_t* buffer, int w, int h, int pitch) : buffer_(buffer), width_(w), height_(h), pitch_(pitch) {
+    assert(buffer_);
+    assert(pitch_ >= width_);
+  }
+
   inline void setPixel(int x, int y, uint32_t p) {
-    assert(y * width_ + x < width_ * height_);
-    buffer_[y * width_ + x] = p;
+    assert(x >= 0 && x < width_ && y >= 0 && y < height_);
+    buffer_[y * pitch_ + x] = p;
+  }
+
+  inline uint32_t getPixel(int x, int y) const {
+    assert(x >= 0 && x < width_ && y >= 0 && y < height_);
+    return buffer_[y * pitch_ + x];
+  }
+
+  //[x0, x1] inclusive, clipped to the buffer
+  inline void fillSpan(int x0, int x1, int y, uint32_t p) {
+    if (y < 0 || y >= height_)
+      return;
+
+    if (x0 < 0)
+      x0 = 0;
+    if (x1 >= width_)
+      x1 = width_ - 1;
+    if (x0 <= x1)
+      fillSpan32(buffer_ + y * pitch_ + x0, x1 - x0 + 1, p);
+  }
+
+  //rect right/bottom are inclusive, clipped to the buffer
+  void fillRect(const RectI& rect, uint32_t p) {
+    const int top = rect.getTop() < 0 ? 0 : rect.getTop();
+    const int bottom = rect.getBottom() >= height_ ? height_ - 1 : rect.getBottom();
+    for (int y = top; y <= bottom; ++y) {
+      fillSpan(rect.getLeft(), rect.getRight(), y, p);
+    }
+  }
+
+  void clear(uint32_t p) {
+    for (int y = 0; y < height_; ++y) {
+      fillSpan32(buffer_ + y * pitch_, width_, p);
+    }
+  }
+
+  uint32_t* getBuffer() const {
+    return buffer_;
+  }
+
+  uint32_t* getRow(int y) const {
+    assert(y >= 0 && y < height_);
+    return buffer_ + y * pitch_;
   }
 
   int getWidth() const {
@@ -24,18 +76,84 @@ public:
   int getHeight() const {
     return height_;
   }
+  int getPitch() const {
+    return pitch_;
+  }
 
 private:
+  uint32_t* buffer_;
   int width_;
   int height_;
-  uint32_t* buffer_;
+  int pitch_;
 };
 
+class DepthBuffer;
+class Texture;
+class FrameTiles;
+class MultisampleBuffer;
+class PixelBuffer;
+struct TriangleEdges;
+struct AttributePlane;
+
 class Renderer {
 public:
   Renderer(uint32_t* buffer, int w, int h);
+  explicit Renderer(const RendererBuffer& buffer);
   ~Renderer();
 
+  RendererBuffer& getBuffer() {
+    return buffer_;
+  }
+
+  //optional, not owned. must match the color buffer size, NULL turns depth testing off.
+  //not together with a multisample buffer
+  void setDepthBuffer(DepthBuffer* depth);
+  DepthBuffer* getDepthBuffer() const {
+    return depth_;
+  }
+
+  //optional, not owned, over the same buffer. draws clear its tiles lazily and mark them written
+  void setFrameTiles(FrameTiles* tiles);
+  FrameTiles* getFrameTiles() const {
+    return frameTiles_;
+  }
+
+  //optional, not owned, the size of the color buffer. while set every draw goes to the
+  //samples instead: triangle edges are 4x anti-aliased, spans, lines and pixels cover
+  //every sample of their pixels. multisampled fills skip the depth test and frame
+  //tiles, draw back to front and MultisampleBuffer::resolve() into the color buffer.
+  //there is no per sample depth, so no depth buffer may be set at the same time
+  void setMultisampleBuffer(MultisampleBuffer* samples);
+  MultisampleBuffer* getMultisampleBuffer() const {
+    return samples_;
+  }
+
+  //optional, not owned, the size of the color buffer. while set the flat kBlendReplace
+  //fills (spans, flat triangles and polygons, depth tested or not) write target in its
+  //own format instead of the color buffer, and do not touch the frame tiles. Gouraud,
+  //textured and blended fills, lines and pixels still draw 32-bit into the color buffer
+  //and reach target through PixelBuffer::present, so present them before the flat
+  //fills that go over them. not together with a multisample buffer
+  void setPixelTarget(PixelBuffer* target);
+  PixelBuffer* getPixelTarget() const {
+    return pixelTarget_;
+  }
+
+  //how triangle and span fills combine with the buffer, kBlendReplace by default.
+  //lines and pixels always replace. blended fills are still depth tested and
+  //write depth, so draw them after the opaque geometry
+  void setBlendMode(BlendMode mode);
+  BlendMode getBlendMode() const {
+    return blendMode_;
+  }
+
+  //fills and lines stay inside rect (right/bottom inclusive), clipped to the buffer.
+  //defaults to the whole buffer
+  void setScissor(const RectI& rect);
+  const RectI& getScissor() const {
+    return scissor_;
+  }
+
   void drawPixel2D(const Point2<int>& p0, const Color& c);
   void drawLine2D(const Point2<int>& p0, const Point2<int>& p1, const Color& c);
 
@@ -45,6 +163,16 @@ public:
   void drawLine2D_DDA(const Point2<int>& p0, const Point2<int>& p1, const Color& c);
   void drawLine2D_Bresenham(const Point2<int>& p0, const Point2<int>& p1, const Color& c);
 
+  //line l joins vertices[indices[2l]] and [2l + 1], x_ and y_ rounded to pixels. the
+  //outcodes of the whole batch are computed up front, once per vertex, so lines
+  //inside the scissor skip the clipper and lines beyond one edge are dropped early.
+  //a line with a vertex too far out to round is clipped in double first
+  void drawIndexedLines(const Point4<double>* vertices, int vertexCount,
+                        const uint32_t* indices, int lineCount, const Color& c);
+
+  //horizontal span in either x order, clipped to the scissor without the line clipper
+  void fillSpan2D(int x0, int x1, int y, uint32_t p);
+
   void drawTriangle2D(const Point2<int>& p0, const Point2<int>& p1, const Point2<int>& p2, const Color& c);
 
   void fillFlatTopTriangle2D(const Point2<int>& p0, const Point2<int>& p1, const Point2<int>& p2, const Color& c);
@@ -52,6 +180,50 @@ public:
 
   void fillTriangle2D(const Point2<int>& p0, const Point2<int>& p1, const Point2<int>& p2, const Color& c);
 
+  //edge function rasterizer walking 8x8 blocks, see Rasterizer.h. this and the fills
+  //below drop triangles off one side of the scissor, rasterize the ones inside the
+  //guard band (kRasterMaxCoord) directly, the scissor only bounds the block walk,
+  //and clip only the triangles reaching past the band to it
+  void fillTriangle2D_HalfSpace(const Point2<int>& p0, const Point2<int>& p1, const Point2<int>& p2, const Color& c);
+
+  //same rasterizer fed with sub-pixel vertices, snapped to 28.4 fixed point
+  void fillTriangle2D_SubPixel(const Point2<double>& p0, const Point2<double>& p1, const Point2<double>& p2, const Color& c);
+
+  //z_ is the normalized reciprocal depth (near / z, see DepthBuffer.h).
+  //tested against and written to the depth buffer, a plain sub-pixel fill without one
+  void fillTriangle3D_Depth(const Point3<double>& p0, const Point3<double>& p1, const Point3<double>& p2, const Color& c);
+
+  //triangle t is vertices[indices[3t]], [3t + 1], [3t + 2] filled with colors[t].
+  //x_, y_ and z_ as in fillTriangle3D_Depth, every vertex is snapped once no matter
+  //how many triangles share it
+  void drawIndexedTriangles(const Point4<double>* vertices, int vertexCount,
+                            const uint32_t* indices, int triangleCount, const Color* colors);
+
+  //a convex polygon of count (3..kMaxConvexEdges) vertices in one pass, each side set up
+  //once and no diagonals, otherwise as fillTriangle3D_Depth. depth comes from the plane
+  //of three of the vertices
+  void fillConvexPolygon3D_Depth(const Point3<double>* points, int count, const Color& c);
+
+  //polygon k has vertexCounts[k] vertices, taken in order from indices, filled with colors[k].
+  //otherwise as drawIndexedTriangles
+  void drawIndexedPolygons(const Point4<double>* vertices, int vertexCount, const uint32_t* indices,
+                           const uint8_t* vertexCounts, int polygonCount, const Color* colors);
+
+  //colors interpolated from the vertices in 16.16 fixed point, otherwise as fillTriangle3D_Depth
+  void fillTriangle3D_Gouraud(const Point3<double>& p0, const Point3<double>& p1, const Point3<double>& p2,
+                              const Color& c0, const Color& c1, const Color& c2);
+
+  //drawIndexedTriangles with a color per vertex instead of per triangle
+  void drawIndexedTrianglesGouraud(const Point4<double>* vertices, const Color* vertexColors, int vertexCount,
+                                   const uint32_t* indices, int triangleCount);
+
+  //uv is in texture sizes (1 spans the texture once, it wraps past that), interpolated
+  //perspective correct with nearest sampling. z_ must be positive, otherwise as
+  //fillTriangle3D_Depth
+  void fillTriangle3D_Textured(const Point3<double>& p0, const Point3<double>& p1, const Point3<double>& p2,
+                               const Point2<double>& uv0, const Point2<double>& uv1, const Point2<double>& uv2,
+                               const Texture& texture);
+
   bool clipLine(Point2<int>& p0, Point2<int>& p1, const RectI& clipRect);
 
 #ifdef WIN32_GDI_RENDERDER
@@ -59,7 +231,46 @@ public:
 #endif
 
 private:
+  //p0..p2 in 28.4 fixed point
+  void fillTriangleFixed(const Point2<int>& p0, const Point2<int>& p1, const Point2<int>& p2, uint32_t p);
+  //depth tested when there is a depth buffer
+  void fillTriangleFixed(const Point2<int>& p0, const Point2<int>& p1, const Point2<int>& p2,
+                         double z0, double z1, double z2, uint32_t p);
+  void fillTriangleGouraudFixed(const Point2<int>& p0, const Point2<int>& p1, const Point2<int>& p2,
+                                double z0, double z1, double z2, const Color colors[3]);
+  void fillTriangleTexturedFixed(const Point2<int>& p0, const Point2<int>& p1, const Point2<int>& p2,
+                                 double z0, double z1, double z2, const Point2<double> uvs[3], const Texture& texture);
+  //zs NULL for no depth test
+  void fillPolygonFixed(const Point2<int>* points, const double* zs, int count, uint32_t p);
+  //the flat fills' block walk, into the pixel target when there is one
+  void fillFlatBlocks(const TriangleEdges& tri, DepthBuffer* depth, const AttributePlane& depthPlane, uint32_t p);
+
+  //the guard band clipper's side of the fills, for polygons reaching past kRasterMaxCoord
+  void fillClippedPolygon(const Point3<double>* points, int count, uint32_t p, bool depthTested);
+  void fillClippedTriangleGouraud(const Point3<double> points[3], const Color colors[3]);
+  void fillClippedTriangleTextured(const Point3<double> points[3], const Point2<double> uvs[3], const Texture& texture);
+
+  //setupTriangleEdges, or the multisample setup with a multisample buffer
+  bool setupTriangle(const Point2<int>& p0, const Point2<int>& p1, const Point2<int>& p2, TriangleEdges& tri) const;
+  bool setupPolygon(const Point2<int>* points, int count, TriangleEdges& tri) const;
+
+  //p0, p1 inside the scissor
+  void drawClippedLine2D(const Point2<int>& p0, const Point2<int>& p1, const Color& c);
+
+  //fills fixedVertices_, out of range vertices are marked for the unsnapped path
+  void snapVertices(const Point4<double>* vertices, int vertexCount);
+
   RendererBuffer buffer_;
+  DepthBuffer* depth_;
+  FrameTiles* frameTiles_;
+  MultisampleBuffer* samples_;
+  PixelBuffer* pixelTarget_;
+  BlendMode blendMode_;
+  RectI scissor_;
+  std::vector<Point2<int>> fixedVertices_;
+  std::vector<int> lineXs_;
+  std::vector<int> lineYs_;
+  std::vector<uint8_t> outcodes_;
 };
 
 }// namespace s3d
\ No newline at end of file
@@ -0,0 +1,27 @@
+#pragma once
+
+//SSE2 is the baseline on every x86 target we build for (x64, and the msvc
+//Win32 default /arch:SSE2). everything else takes the scalar paths.
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define S3D_SSE2 1
+#include <emmintrin.h>
+#endif
+
+//AVX2 code is compiled into the same translation units and only entered after
+//a runtime cpu check (see CpuFeatures.h). gcc/clang need a per function target
+//for that, msvc accepts the intrinsics as is.
+#ifdef S3D_SSE2
+#define S3D_AVX2 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#define S3D_TARGET_AVX2
+#else
+#define S3D_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+#ifdef _MSC_VER
+#define S3D_FORCEINLINE __forceinline
+#else
+#define S3D_FORCEINLINE inline __attribute__((always_inline))
+#endif
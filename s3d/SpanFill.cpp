@@ -0,0 +1,100 @@
+#include "SpanFill.h"
+#include "Simd.h"
+
+namespace s3d
+{
+
+namespace
+{
+
+void fillSpanScalar(uint32_t* dst, int count, uint32_t p) {
+  for (int i = 0; i < count; ++i) {
+    dst[i] = p;
+  }
+}
+
+#ifdef S3D_SSE2
+void fillSpanSSE2(uint32_t* dst, int count, uint32_t p) {
+  while (count > 0 && (reinterpret_cast<uintptr_t>(dst) & 15)) {
+    *dst++ = p;
+    --count;
+  }
+
+  const __m128i v = _mm_set1_epi32(static_cast<int>(p));
+  for (; count >= 8; count -= 8, dst += 8) {
+    _mm_store_si128(reinterpret_cast<__m128i*>(dst), v);
+    _mm_store_si128(reinterpret_cast<__m128i*>(dst + 4), v);
+  }
+
+  if (count >= 4) {
+    _mm_store_si128(reinterpret_cast<__m128i*>(dst), v);
+    dst += 4;
+    count -= 4;
+  }
+
+  while (count-- > 0) {
+    *dst++ = p;
+  }
+}
+#endif
+
+#ifdef S3D_AVX2
+S3D_TARGET_AVX2 void fillSpanAVX2(uint32_t* dst, int count, uint32_t p) {
+  if (count < 8) {
+    fillSpanScalar(dst, count, p);
+    return;
+  }
+
+  //one unaligned store covers the head, then continue from the next 32 byte boundary
+  const __m256i v = _mm256_set1_epi32(static_cast<int>(p));
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), v);
+  const int head = static_cast<int>((32 - (reinterpret_cast<uintptr_t>(dst) & 31)) & 31) / 4;
+  dst += head;
+  count -= head;
+
+  for (; count >= 16; count -= 16, dst += 16) {
+    _mm256_store_si256(reinterpret_cast<__m256i*>(dst), v);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(dst + 8), v);
+  }
+
+  if (count >= 8) {
+    _mm256_store_si256(reinterpret_cast<__m256i*>(dst), v);
+    dst += 8;
+    count -= 8;
+  }
+
+  //the tail overlaps pixels already written
+  if (count > 0)
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + count - 8), v);
+}
+#endif
+
+FillSpanFunc spanFillFor(SimdLevel level) {
+  switch (level) {
+#ifdef S3D_AVX2
+  case kSimdAVX2:
+    return fillSpanAVX2;
+#endif
+#ifdef S3D_SSE2
+  case kSimdSSE2:
+    return fillSpanSSE2;
+#endif
+  default:
+    return fillSpanScalar;
+  }
+}
+
+}
+
+FillSpanFunc g_fillSpan32 = spanFillFor(detectSimdLevel());
+
+SimdLevel selectSpanFill(SimdLevel level) {
+  const SimdLevel supported = detectSimdLevel();
+  if (level > supported)
+    level = supported;
+
+  g_fillSpan32 = spanFillFor(level);
+  return level;
+}
+
+}// namespace s3d
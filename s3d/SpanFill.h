@@ -0,0 +1,34 @@
+#pragma once
+#include <cstdint>
+#include "CpuFeatures.h"
+
+namespace s3d
+{
+
+typedef void (*FillSpanFunc)(uint32_t* dst, int count, uint32_t p);
+
+//the span writer picked for this cpu at startup
+extern FillSpanFunc g_fillSpan32;
+
+//writes count copies of p starting at dst
+inline void fillSpan32(uint32_t* dst, int count, uint32_t p) {
+  g_fillSpan32(dst, count, p);
+}
+
+//16-bit pixels two at a time through fillSpan32, dst is 2 byte aligned
+inline void fillSpan16(uint16_t* dst, int count, uint16_t p) {
+  if (count > 0 && (reinterpret_cast<uintptr_t>(dst) & 2)) {
+    *dst++ = p;
+    --count;
+  }
+  if (count > 1)
+    fillSpan32(reinterpret_cast<uint32_t*>(dst), count >> 1, p * 0x10001U);
+  if (count & 1)
+    dst[count - 1] = p;
+}
+
+//forces a code path, level is clamped to what the cpu supports.
+//returns the level in use. meant for tests and benchmarks.
+SimdLevel selectSpanFill(SimdLevel level);
+
+}// namespace s3d
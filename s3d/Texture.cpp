@@ -0,0 +1,40 @@
+#include "Texture.h"
+#include "AlignedMemory.h"
+
+namespace s3d
+{
+
+namespace
+{
+
+inline bool isPowerOfTwo(int v) {
+  return v > 0 && (v & (v - 1)) == 0;
+}
+
+}
+
+Texture::Texture(int w, int h) : texels_(NULL), width_(w), height_(h), tilesPerRow_(w >> kTextureTileBits) {
+  if (!isPowerOfTwo(w) || !isPowerOfTwo(h) || w < kTextureTileSize || h < kTextureTileSize)
+    throw TextureException("texture size must be a power of two");
+
+  texels_ = static_cast<uint32_t*>(alignedAlloc(size_t(w) * h * sizeof(uint32_t)));
+  for (int i = 0; i < w * h; ++i) {
+    texels_[i] = 0;
+  }
+}
+
+Texture::~Texture() {
+  alignedFree(texels_);
+}
+
+void Texture::upload(const uint32_t* pixels, int pitch) {
+  assert(pixels && pitch >= width_);
+  for (int v = 0; v < height_; ++v) {
+    const uint32_t* row = pixels + v * pitch;
+    for (int u = 0; u < width_; ++u) {
+      texels_[offset(u, v)] = row[u];
+    }
+  }
+}
+
+}// namespace s3d
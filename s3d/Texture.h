@@ -0,0 +1,59 @@
+#pragma once
+#include <cstdint>
+#include <cassert>
+#include <stdexcept>
+#include <boost/noncopyable.hpp>
+
+namespace s3d
+{
+
+class TextureException : public std::runtime_error {
+public:
+  TextureException(const char * const & msg) : std::runtime_error(msg) {
+  }
+};
+
+//texels are stored in kTextureTileSize^2 tiles, one 64 byte cache line each,
+//so walking a texture vertically or diagonally touches as few lines as a
+//horizontal walk. width and height are powers of two, coordinates wrap.
+const int kTextureTileBits = 2;
+const int kTextureTileSize = 1 << kTextureTileBits;
+
+class Texture : private boost::noncopyable {
+public:
+  //throws TextureException unless w and h are powers of two (and at least one tile)
+  Texture(int w, int h);
+  ~Texture();
+
+  //copies a linear image of getWidth() x getHeight() pixels, pitch in pixels
+  void upload(const uint32_t* pixels, int pitch);
+
+  uint32_t getTexel(int u, int v) const {
+    return texels_[offset(u & (width_ - 1), v & (height_ - 1))];
+  }
+
+  void setTexel(int u, int v, uint32_t p) {
+    texels_[offset(u & (width_ - 1), v & (height_ - 1))] = p;
+  }
+
+  int getWidth() const {
+    return width_;
+  }
+  int getHeight() const {
+    return height_;
+  }
+
+private:
+  uint32_t offset(int u, int v) const {
+    const uint32_t tile = uint32_t(v >> kTextureTileBits) * tilesPerRow_ + uint32_t(u >> kTextureTileBits);
+    const uint32_t texel = ((v & (kTextureTileSize - 1)) << kTextureTileBits) | (u & (kTextureTileSize - 1));
+    return (tile << (2 * kTextureTileBits)) | texel;
+  }
+
+  uint32_t* texels_;
+  int width_;
+  int height_;
+  int tilesPerRow_;
+};
+
+}// namespace s3d
@@ -4,6 +4,7 @@
 #include "math/Matrix.h"
 
 #include <vector>
+#include <iterator>
 
 namespace s3d
 {
@@ -20,7 +21,7 @@ public:
   }
 
   VertexList(const std::initializer_list<value_type>& ilist) {
-    std::copy(ilist.begin(), ilist.end(), std::back_insert(vertices));
+    std::copy(ilist.begin(), ilist.end(), std::back_inserter(vertices));
   }
 
   void push_back(const T& pt) {
@@ -61,6 +62,19 @@ public:
     return vertices.size();
   }
 
+  void resize(size_type count) {
+    vertices.resize(count);
+  }
+
+  //contiguous storage, for the batched draw calls and transforms
+  T* data() {
+    return vertices.data();
+  }
+
+  const T* data() const {
+    return vertices.data();
+  }
+
 private:
   std::vector<T> vertices;
 };
@@ -1,12 +1,14 @@
 #include "stdafx.h"
 #include "Window.h"
 #include "Renderer.h"
+#include "FrameTiles.h"
 
 #include <unordered_map>
 
 #include "Object.h"
 #include "Camera.h"
 #include "PLGLoader.h"
+#include "Pipeline.h"
 
 using namespace std;
 
@@ -49,11 +51,13 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
 
 }
 
-Window::Window() : hWnd_(NULL){
+Window::Window() : hWnd_(NULL), dib_(NULL), dibPixels_(NULL), dibWidth_(0), dibHeight_(0), redrawRequested_(false) {
 }
 
 Window::~Window() {
   assert(hWnd_ == NULL);
+  if (dib_)
+    DeleteObject(dib_);
 }
 
 static double anglex = 0 * 3.1415927 / 180;
@@ -160,22 +164,48 @@ LRESULT Window::wndProc(UINT message, WPARAM wParam, LPARAM lParam) {
       bmi.bmiHeader.biBitCount = 32;
       bmi.bmiHeader.biCompression = BI_RGB;
 
-      uint32_t* buffer = NULL;
-      HBITMAP hBmp = CreateDIBSection(hMemDC, &bmi, DIB_RGB_COLORS, (void**)&buffer, NULL, NULL);
-      std::fill(buffer, buffer + winWidth * winHeight, RGB(0, 0, 0));
+      //the DIB section lives across paints so its frame tiles remember what is still clear
+      bool fullBlit = false;
+      if (!dib_ || dibWidth_ != winWidth || dibHeight_ != winHeight) {
+        fullBlit = true;
+        if (dib_)
+          DeleteObject(dib_);
+        dib_ = CreateDIBSection(hMemDC, &bmi, DIB_RGB_COLORS, (void**)&dibPixels_, NULL, NULL);
+        dibWidth_ = winWidth;
+        dibHeight_ = winHeight;
+        frameTiles_.reset(new FrameTiles(RendererBuffer(dibPixels_, winWidth, winHeight)));
+      }
 
-      s3d::Renderer renderer(buffer, winWidth, winHeight);
+      //no full clear, tiles are cleared when first drawn into or when they
+      //still hold the last paint at the end
+      frameTiles_->beginFrame(RGB(0, 0, 0));
+      s3d::Renderer renderer(dibPixels_, winWidth, winHeight);
+      renderer.setFrameTiles(frameTiles_.get());
       try {
         this->onDraw(renderer);
       } catch (...) {
       }
-      
-      HGDIOBJ oldObj = SelectObject(hMemDC, hBmp);
-      BitBlt(hdc, 0, 0, winWidth, winHeight, hMemDC, 0, 0, SRCCOPY);
+      RectI changed;
+      const bool anyChanged = frameTiles_->endFrame(changed);
+
+      HGDIOBJ oldObj = SelectObject(hMemDC, dib_);
+      if (fullBlit) {
+        BitBlt(hdc, 0, 0, winWidth, winHeight, hMemDC, 0, 0, SRCCOPY);
+      } else {
+        //the part the system invalidated (uncovered, not from needRedraw) is
+        //stale on screen even when the frame did not change there
+        if (!redrawRequested_ && !IsRectEmpty(&ps.rcPaint))
+          BitBlt(hdc, ps.rcPaint.left, ps.rcPaint.top, ps.rcPaint.right - ps.rcPaint.left,
+            ps.rcPaint.bottom - ps.rcPaint.top, hMemDC, ps.rcPaint.left, ps.rcPaint.top, SRCCOPY);
+        //changed is right/bottom inclusive
+        if (anyChanged)
+          BitBlt(hdc, changed.getLeft(), changed.getTop(), changed.getWidth() + 1, changed.getHeight() + 1,
+            hMemDC, changed.getLeft(), changed.getTop(), SRCCOPY);
+      }
+      redrawRequested_ = false;
 
       SelectObject(hMemDC, oldObj);
       DeleteObject(hMemDC);
-      DeleteObject(hBmp);
 
       SelectObject(hMemDC, GetStockObject(DC_PEN));
       SetDCPenColor(hMemDC, RGB(0, 0, 255));
@@ -220,6 +250,7 @@ bool Window::onCreate() {
 void Window::needRedraw() {
   RECT rect;
   ::GetWindowRect(hWnd_, &rect);
+  redrawRequested_ = true;
   ::InvalidateRect(NULL, NULL, FALSE);
 }
 
@@ -234,7 +265,7 @@ void Window::onDraw(Renderer& renderer) {
   try {
     std::string name; 
     VertexList<Point4<double>> vlist;
-    std::vector<Polygon<3>> polys;
+    std::vector<Polygon<kMaxPolygonVertices>> polys;
     plgloader.parse("D:\\work\\t3dlib\\T3DIICHAP07\\cube2.plg", name, vlist, polys, 4);
 
     for (auto pt : vlist) {
@@ -258,86 +289,17 @@ void Window::onDraw(Renderer& renderer) {
   obj.addVertex({0, 0, 10});
   obj.addVertex({0, 0, -10});
 
-  auto rotateMat = buildRotateMatrix4x4(-anglex, -angley, -anglez);
-  for (auto& v : obj.localVertexList_) {
-    v = (v * rotateMat);
-  }
-
-  addToWorld(obj, wx, wy, wz);
+  addToWorld(obj, buildRotateMatrix4x4(-anglex, -angley, -anglez), wx, wy, wz);
 
   int viewWidth = winWidth;
   int viewHeight = winHeight;
 
   CameraUVN camera({cx, cy, cz - 100}, {cx, cy, 1}, 90, 10, 1000, viewWidth, winHeight);
-  auto matWorldToCameraMatrix4x4FD = camera.getWorldToCameraMatrix4x4FD();
 
-  Point4FD sphererPt = {wx, wy, wz};
-  sphererPt = sphererPt * matWorldToCameraMatrix4x4FD;
-  if (camera.isSphereOutOfView(sphererPt, 1))
+  if (!objectToScreen(obj, camera, 1))
     return;
 
-  auto transVerit = obj.transVertexList_.begin();
-  while (transVerit != obj.transVertexList_.end()) {
-    const auto pt = *transVerit;
-    *transVerit = pt * matWorldToCameraMatrix4x4FD;
-    ++transVerit;
-  }
-
-  for (auto& itp : obj.polygons_) {
-    const auto u = obj.transVertexList_[itp.at(1)] - obj.transVertexList_[itp.at(0)];
-    const auto v = obj.transVertexList_[itp.at(2)] - obj.transVertexList_[itp.at(0)];
-
-    itp.normal_ = u.crossProduct(v);
-    Vector4FD vp(obj.transVertexList_[itp.at(0)], camera.getPosition());
-    if (vp.dotProduct(itp.normal_) > 0.) {
-      itp.setState(kPolygonStateVisible);
-    }
-  }
-
-  auto matCameraToScreen = camera.getCameraToScreenMatrix4x4FD();
-  transVerit = obj.transVertexList_.begin();
-  while (transVerit != obj.transVertexList_.end()) {
-    const auto pt = *transVerit;
-    *transVerit = pt * matCameraToScreen;
-    ++transVerit;
-  }
-
-
-  //setCamera(obj, {cx, cy, cz}, -0, -0, -0);
-
-  //mat = camera.getCameraToProjectMatrix4x4FD();
-
-  //transVerit = obj.transVertexList_.begin();
-  //while (transVerit != obj.transVertexList_.end()) {
-  //  const auto pt = *transVerit;
-  //  *transVerit = pt * mat;
-  //  ++transVerit;
-  //}
-
-  for (auto& itp : obj.polygons_) {
-    if (itp.getState() & kPolygonStateVisible) {
-        obj.transPolygons_.push_back(itp);
-    }
-  }
-  //perspectiveProject(obj, viewWidth, viewHeight);
-  //perspectiveProject(obj, 90, viewWidth, viewHeight);
-  //const int xx = 100;
-  //int bb[xx] = {0};
-  //int *p = (int*)&xx;
-  //*p = 1111;
-
-  //const int &i = 3.14;
-  for (auto itp : obj.transPolygons_) {
-    int id = itp[0];
-    Point2<int> p0 = {(int)obj.transVertexList_[id].x_, (int)obj.transVertexList_[id].y_};
-
-    id = itp[1];
-    Point2<int> p1 = {(int)obj.transVertexList_[id].x_, (int)obj.transVertexList_[id].y_};
-
-    id = itp[2];
-    Point2<int> p2 = {(int)obj.transVertexList_[id].x_, (int)obj.transVertexList_[id].y_};
-    renderer.fillTriangle2D(p0, p1, p2, itp.getColor());
-  }
+  drawObject(renderer, obj);
 
   const int icd = 0, & const r = 0;
   const int *ppp;
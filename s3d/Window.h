@@ -4,11 +4,13 @@
 #include <boost\noncopyable.hpp>
 #include <windows.h>
 #include <memory>
+#include <cstdint>
 
 namespace s3d
 {
 
 class Renderer;
+class FrameTiles;
 
 class WindowCreateFailedException : public std::exception {
 public:
@@ -55,6 +57,15 @@ private:
 private:
   Renderer* renderer_;
   HWND hWnd_;
+
+  //paint target kept between paints, see FrameTiles
+  HBITMAP dib_;
+  uint32_t* dibPixels_;
+  int dibWidth_;
+  int dibHeight_;
+  std::unique_ptr<FrameTiles> frameTiles_;
+  //the next WM_PAINT is ours, only the changed tiles need blitting
+  bool redrawRequested_;
 };
 
 }// namespace s3d
\ No newline at end of file
@@ -16,9 +16,10 @@ void World::addToWorld(ObjectPtr obj, const Point3FD& pos) {
                                 0, 0, 1, 0,
                                 pos.x_, pos.y_, pos.z_, 1};
 
-    obj->setWorldPosition({pos.x_, pos.y_, pos.z_});\
+    obj->setWorldPosition(Object::PointType(GeometryScalar(pos.x_), GeometryScalar(pos.y_), GeometryScalar(pos.z_)));\
+    const Matrix<GeometryScalar, 4U, 4U> mat(translateMat);
     for (auto v : obj->localVertexList_) {
-      worldVertices.push_back(v * translateMat);
+      worldVertices.push_back(v * mat);
     }
 }
 
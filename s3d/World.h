@@ -12,8 +12,8 @@ namespace s3d
 
 class World {
 public:
-  typedef Point4<double> PointType;
-  typedef Point4<double> VectorType;
+  typedef Object::PointType PointType;
+  typedef Object::VectorType VectorType;
 
   World();
   ~World();
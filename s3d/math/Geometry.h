@@ -66,19 +66,18 @@ public:
   T anglexy_;  //the angle in radian
   T anglez_;
 
-  SphericalPoint(T radius, T angle, T z) : radius_(radius), angle_(angle), z_(z) {
+  SphericalPoint(T radius, T anglexy, T anglez) : radius_(radius), anglexy_(anglexy), anglez_(anglez) {
   }
 
   explicit SphericalPoint(const Point3<T>& pt) {
     radius_ = ::sqrt(pt.x_*pt.x_ + pt.y_*pt.y_ + pt.z_*pt.z_);
-    if (impl::equalZero(radius_)) {
+    if (vector_impl::equalZero(radius_)) {
       radius_ = anglexy_ = anglez_ = T(0);
       return;
     }
 
     anglexy_ = ::atan2(pt.y_, pt.x_);
-    anglez_ = ::acos(pt.z / radius_);
-    z_ = pt.z_;
+    anglez_ = ::acos(pt.z_ / radius_);
   }
 
   Point3<T> toPoint() const {
@@ -113,14 +112,14 @@ struct LineGeneral2D {
   c_ = Mx0 - y0
   */
   LineGeneral2D(const Point2<T>& p0, const Point2<T>& p1) {
-    const auto M = (p1.y - p0.y) / (p1.x - p0.x)
+    const auto M = (p1.y - p0.y) / (p1.x - p0.x);
     a_ = -M;
     b_ = T(1);
     c_ = M * p0.x - p0.y;
   }
 
   T solveY(T x) const {
-    return -(a_ * x + c_)
+    return -(a_ * x + c_);
   }
 };
 
@@ -139,11 +138,11 @@ struct LinePointSlope2D {
   }
 
   LineGeneral2D<T> toLineGeneral2D() const {
-    return LineGeneral2D<T>(m, T(-1), b);
+    return LineGeneral2D<T>(m_, T(-1), b_);
   }
 
   T solveY(T x) const {
-    return (m_ * x + b_)
+    return (m_ * x + b_);
   }
 };
 
@@ -152,13 +151,13 @@ template<typename T>
 struct LineParametric2D {
   Point2<T> point_;
   Point2<T> point1_;
-  Vector2 vector_;
+  Vector2<T> vector_;
 
-  LineParametric2D(const Point2<T>& p0, const Point2<T>& p1) : point_(p0), point1_(p1), vector(point1_ - point_) {
+  LineParametric2D(const Point2<T>& p0, const Point2<T>& p1) : point_(p0), point1_(p1), vector_(point1_ - point_) {
   }
 
-  Vector2 compute(const T t) {
-    return Vector2(point_.x_ + vector_.x_*t, point_.y_ + vector_.y_*t);
+  Vector2<T> compute(const T t) {
+    return Vector2<T>(point_.x_ + vector_.x_*t, point_.y_ + vector_.y_*t);
   }
 
   LineGeneral2D<T> toLineGeneral2D() const {
@@ -176,13 +175,13 @@ template<typename T>
 struct LineParametric3D {
   Point3<T> point_;
   Point3<T> point1_;
-  Vector3 vector_;
+  Vector3<T> vector_;
 
-  LineParametric3D(const Point3<T>& p0, const Point3<T>& p1) : point_(p0), point1_(p1), vector(point1_ - point_) {
+  LineParametric3D(const Point3<T>& p0, const Point3<T>& p1) : point_(p0), point1_(p1), vector_(point1_ - point_) {
   }
 
-  Vector3 compute(const T t) {
-    return Vector2(point_.x_ + vector_.x_*t, point_.y_ + vector_.y_*t, point_.z_ + vector_.z_*t);
+  Vector3<T> compute(const T t) {
+    return Vector3<T>(point_.x_ + vector_.x_*t, point_.y_ + vector_.y_*t, point_.z_ + vector_.z_*t);
   }
 };
 
@@ -249,12 +248,12 @@ bool isIntersect(const LineParametric2D<T>& la, const LineParametric2D<T>& lb) {
     //Intersect whith a or more points
     if (vector_impl::equalZero(la.toLinePointSlope2D().b_ - lb.toLinePointSlope2D().b_)) {
       if (vector_impl::equalZero(la.point_.x_ - lb.point_.x_)) {
-        return ::fabs();
+        return true;
       }
       else if (isSignInvese(la.point_.x_ - lb.point_.x_, la.point_.x_ - lb.point1_.x_))
         return true;
       else if (isSignInvese(lb.point_.x_ - la.point_.x_, lb.point_.x_ - la.point1_.x_))
-        return true
+        return true;
       else 
         return false;
     }
@@ -395,10 +394,10 @@ public:
 };
 
 //la.point_.z + la.vector_.z * t1 = 0
-//t = -la.point_.z / la.vector_.z
+//t = -la.point_.z / line.vector_.z
 template <typename T>
 bool isIntersectXY(const LineParametric3D<T>& line) {
-  const auto t = -la.point_.z / la.vector_.z;
+  const auto t = -line.point_.z / line.vector_.z;
   if (t > T(0) && t < T(1)) {
     return true;
   } else {
@@ -407,10 +406,10 @@ bool isIntersectXY(const LineParametric3D<T>& line) {
 }
 
 //la.point_.y + la.vector_.y * t1 = 0
-//t = -la.point_.y / la.vector_.y
+//t = -la.point_.y / line.vector_.y
 template <typename T>
 bool isIntersectXZ(const LineParametric3D<T>& line) {
-  const auto t = -la.point_.y / la.vector_.y;
+  const auto t = -line.point_.y / line.vector_.y;
   if (t > T(0) && t < T(1)) {
     return true;
   } else {
@@ -419,10 +418,10 @@ bool isIntersectXZ(const LineParametric3D<T>& line) {
 }
 
 //la.point_.x + la.vector_.x * t1 = 0
-//t = -la.point_.x / la.vector_.x
+//t = -la.point_.x / line.vector_.x
 template <typename T>
 bool isIntersectYZ(const LineParametric3D<T>& line) {
-  const auto t = -la.point_.x / la.vector_.x;
+  const auto t = -line.point_.x / line.vector_.x;
   if (t > T(0) && t < T(1)) {
     return true;
   } else {
@@ -432,19 +431,19 @@ bool isIntersectYZ(const LineParametric3D<T>& line) {
 
 template <typename T>
 inline bool isPointInPlane(const Plane3D<T>& plane, const Vector3<T>& X) {
-  const auto s = plane.n_.x * (X.x - plane.point_.x) + n_.y * (X.y - plane.point_.y) + n_.z * (X.z - plane.point_.z);
+  const auto s = plane.n_.x * (X.x - plane.point_.x) + plane.n_.y * (X.y - plane.point_.y) + plane.n_.z * (X.z - plane.point_.z);
   return vector_impl::equalZero(s);
 }
 
 template <typename T>
 inline bool isPointOnPlanePositiveSide(const Plane3D<T>& plane, const Vector3<T>& X) {
-  const auto s = plane.n_.x * (X.x - plane.point_.x) + n_.y * (X.y - plane.point_.y) + n_.z * (X.z - plane.point_.z);
+  const auto s = plane.n_.x * (X.x - plane.point_.x) + plane.n_.y * (X.y - plane.point_.y) + plane.n_.z * (X.z - plane.point_.z);
   return s > T(0);
 }
 
 template <typename T>
 inline bool isPointOnPlaneNegativeSide(const Plane3D<T>& plane, const Vector3<T>& X) {
-  const auto s = plane.n_.x * (X.x - plane.point_.x) + n_.y * (X.y - plane.point_.y) + n_.z * (X.z - plane.point_.z);
+  const auto s = plane.n_.x * (X.x - plane.point_.x) + plane.n_.y * (X.y - plane.point_.y) + plane.n_.z * (X.z - plane.point_.z);
   return s < T(0);
 }
 
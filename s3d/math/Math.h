@@ -14,22 +14,43 @@
 namespace s3d
 {
 
+//the product without the perspective divide, w is left as it comes out
 template<typename T>
-Point4<T> operator * (const Point4<T>& pt4, const Matrix<T, 4U, 4U>& m1) {
+Point4<T> transformHomogeneous(const Point4<T>& pt4, const Matrix<T, 4U, 4U>& m1) {
   Point4<T> ptRes;
   ptRes.x_ = m1[0][0] * pt4.x_ + m1[1][0] * pt4.y_ + m1[2][0] * pt4.z_ + m1[3][0] * pt4.w_;
   ptRes.y_ = m1[0][1] * pt4.x_ + m1[1][1] * pt4.y_ + m1[2][1] * pt4.z_ + m1[3][1] * pt4.w_;
   ptRes.z_ = m1[0][2] * pt4.x_ + m1[1][2] * pt4.y_ + m1[2][2] * pt4.z_ + m1[3][2] * pt4.w_;
   ptRes.w_ = m1[0][3] * pt4.x_ + m1[1][3] * pt4.y_ + m1[2][3] * pt4.z_ + m1[3][3] * pt4.w_;
-  assert(ptRes.w_ != 0.f);
+  return ptRes;
+}
+
+//float and double run the inline row kernel of the 4x4 matrix product
+template<>
+inline Point4<float> transformHomogeneous<float>(const Point4<float>& pt4, const Matrix<float, 4U, 4U>& m1) {
+  Point4<float> ptRes;
+  matrix_impl::transformRows4(&ptRes.x_, &pt4.x_, 1, m1[0]);
+  return ptRes;
+}
 
-  if (ptRes.w_ != 1.f) {
-    ptRes.x_ /= ptRes.w_;
-    ptRes.y_ /= ptRes.w_;
-    ptRes.z_ /= ptRes.w_;
-    ptRes.w_ = 1.f;
-  }
+template<>
+inline Point4<double> transformHomogeneous<double>(const Point4<double>& pt4, const Matrix<double, 4U, 4U>& m1) {
+  Point4<double> ptRes;
+  matrix_impl::transformRows4(&ptRes.x_, &pt4.x_, 1, m1[0]);
+  return ptRes;
+}
+
+//the product with the perspective divide. dividing by a w of 1 changes nothing,
+//so it is done every time instead of branching on w
+template<typename T>
+Point4<T> operator * (const Point4<T>& pt4, const Matrix<T, 4U, 4U>& m1) {
+  Point4<T> ptRes = transformHomogeneous(pt4, m1);
+  assert(ptRes.w_ != 0.f);
 
+  ptRes.x_ /= ptRes.w_;
+  ptRes.y_ /= ptRes.w_;
+  ptRes.z_ /= ptRes.w_;
+  ptRes.w_ = 1.f;
   return ptRes;
 }
 
@@ -3,30 +3,82 @@
 
 #include <initializer_list>
 #include <cassert>
+#include <cmath>
 #include <algorithm>
 #include <stdexcept>
+#include <type_traits>
+
+//SSE2 only where the compiler may always use it, the inline 4x4 products below
+//need no cpu check. the runtime picked batch kernels are in MatrixSimd.cpp
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define S3D_MATH_SSE2 1
+#include <emmintrin.h>
+#endif
 
 namespace s3d
 {
 
 #define CHECK_THROW(con,except)  {assert(con); if (!(con)) throw (except);}
 
-class MatrixInverseException : public std::exception {
+//constexpr for bodies with loops, which c++11 does not allow
+#ifndef S3D_CONSTEXPR14
+#if __cplusplus >= 201402L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201402L)
+#define S3D_CONSTEXPR14 constexpr
+#else
+#define S3D_CONSTEXPR14 inline
+#endif
+#endif
+
+class MatrixInverseException : public std::runtime_error {
+public:
+  MatrixInverseException(const char * const & msg) : std::runtime_error(msg) {
+  }
+};
+
+//leaves the elements unset, for results that write every one of them
+enum MatrixUninitialized { kMatrixUninitialized };
+
+//anything that can be evaluated element by element, E gives value_type,
+//kRows, kCols and operator() (row, col). a + b - c * 2 builds a tree of these
+//which the Matrix it is assigned to evaluates in one pass
+template<typename E>
+class MatrixExpr {
 public:
-  MatrixInverseException(const char * const & msg) : exception(msg) {
+  const E& self() const {
+    return static_cast<const E&>(*this);
   }
 };
 
+namespace matrix_impl
+{
+
+  template<unsigned int... I>
+  struct Indices {
+  };
+
+  template<unsigned int N, unsigned int... I>
+  struct MakeIndices : MakeIndices<N - 1, N - 1, I...> {
+  };
+
+  template<unsigned int... I>
+  struct MakeIndices<0, I...> {
+    typedef Indices<I...> type;
+  };
+
+}// matrix_impl
+
 template<typename T, unsigned int Rows, unsigned int Cols>
-class Matrix {
+class Matrix : public MatrixExpr<Matrix<T, Rows, Cols>> {
 public:
   typedef T value_type;
+  static const unsigned int kRows = Rows;
+  static const unsigned int kCols = Cols;
 
 public:
-  Matrix() {
-    for (unsigned int i = 0; i < Rows; ++i) {
-      std::fill_n(m_[i], Cols, T(0));
-    }
+  constexpr Matrix() : m_() {
+  }
+
+  explicit Matrix(MatrixUninitialized) {
   }
 
   explicit Matrix(const T m[Rows][Cols]) {
@@ -37,26 +89,32 @@ public:
     }
   }
 
-  Matrix(const std::initializer_list<T>& ilist) {
-    assert(ilist.size() == (sizeof m_) / sizeof (T));
-
-    auto bit = ilist.begin();
-    for (unsigned int i = 0; i < Rows; ++i) {
-      std::copy(bit, bit + Cols, m_[i]);
-      bit += Cols;
-    }
+  S3D_CONSTEXPR14 Matrix(const std::initializer_list<T>& ilist)
+    : Matrix((assert(ilist.size() == Rows * Cols), ilist.begin()), typename matrix_impl::MakeIndices<Rows * Cols>::type()) {
   }
 
-  Matrix(const Matrix& m) : Matrix(m.m_) {
-  }
+  Matrix(const Matrix& m) = default;
 
-  Matrix& operator= (const Matrix& m) {
+  //between float and double
+  template<typename U>
+  explicit Matrix(const Matrix<U, Rows, Cols>& m) {
     for (unsigned int r = 0; r < Rows; ++r) {
       for (unsigned int c = 0; c < Cols; ++c) {
-        m_[r][c] = m[r][c];
+        m_[r][c] = T(m[r][c]);
       }
     }
+  }
+
+  template<typename E, typename = typename std::enable_if<std::is_same<typename E::value_type, T>::value>::type>
+  Matrix(const MatrixExpr<E>& e) {
+    evaluate(e.self());
+  }
+
+  Matrix& operator= (const Matrix& m) = default;
 
+  template<typename E>
+  Matrix& operator= (const MatrixExpr<E>& e) {
+    evaluate(e.self());
     return *this;
   }
 
@@ -66,14 +124,18 @@ public:
   Matrix transpose() const;
   Matrix adjoint() const;
 
-  inline T* operator[] (unsigned int row) {
+  S3D_CONSTEXPR14 T* operator[] (unsigned int row) {
     return m_[row];
   }
 
-  inline const T* operator[] (unsigned int row) const {
+  constexpr const T* operator[] (unsigned int row) const {
     return m_[row];
   }
 
+  constexpr T operator() (unsigned int row, unsigned int col) const {
+    return m_[row][col];
+  }
+
   T& at(unsigned int row, unsigned int col) {
     CHECK_THROW(row <= Rows && col <= Cols, std::out_of_range("Matrix at out_of_range"));
     return m_[row][col];
@@ -85,6 +147,22 @@ public:
   }
 
 private:
+  //every element initialized straight from values, nothing zeroed first
+  template<unsigned int... I>
+  constexpr Matrix(const T* values, matrix_impl::Indices<I...>) : m_{values[I]...} {
+  }
+
+  //element by element, so m = m2 - m reads every element before it is written
+  template<typename E>
+  void evaluate(const E& e) {
+    static_assert(E::kRows == Rows && E::kCols == Cols, "Matrix expression size mismatch");
+    for (unsigned int r = 0; r < Rows; ++r) {
+      for (unsigned int c = 0; c < Cols; ++c) {
+        m_[r][c] = e(r, c);
+      }
+    }
+  }
+
   T m_[Rows][Cols];
 };
 
@@ -105,11 +183,105 @@ namespace matrix_impl
 
 }// matrix_impl
 
-template<typename T, unsigned int Rows, unsigned int Cols>
-bool operator == (const Matrix<T, Rows, Cols>& m1, const Matrix<T, Rows, Cols>& m2) {
-  for (unsigned int r = 0; r < Rows; ++r) {
-    for (unsigned int c = 0; c < Cols; ++c) {
-      if (!matrix_impl::equalZero(m1[r][c] - m2[r][c])) {
+namespace matrix_impl
+{
+
+  template<typename M>
+  struct IsMatrix : std::false_type {
+  };
+
+  template<typename T, unsigned int Rows, unsigned int Cols>
+  struct IsMatrix<Matrix<T, Rows, Cols>> : std::true_type {
+  };
+
+  template<typename A>
+  struct IsMatrixExpr : std::is_base_of<MatrixExpr<typename std::decay<A>::type>, typename std::decay<A>::type> {
+  };
+
+  //named matrices are held by reference, temporaries and nested expressions by
+  //value, so an expression kept in an auto variable does not dangle
+  template<typename A>
+  struct ExprOperand {
+    typedef typename std::decay<A>::type Type;
+    typedef typename std::conditional<std::is_lvalue_reference<A>::value && IsMatrix<Type>::value,
+                                      const Type&, Type>::type type;
+  };
+
+  template<typename E>
+  struct Evaluated {
+    typedef Matrix<typename E::value_type, E::kRows, E::kCols> type;
+  };
+
+  struct Plus {
+    template<typename T>
+    static T apply(T a, T b) {
+      return a + b;
+    }
+  };
+
+  struct Minus {
+    template<typename T>
+    static T apply(T a, T b) {
+      return a - b;
+    }
+  };
+
+}// matrix_impl
+
+template<typename L, typename R, typename Op>
+class MatrixBinaryExpr : public MatrixExpr<MatrixBinaryExpr<L, R, Op>> {
+  typedef typename std::decay<L>::type LType;
+  typedef typename std::decay<R>::type RType;
+  static_assert(std::is_same<typename LType::value_type, typename RType::value_type>::value,
+                "Matrix expression value_type mismatch");
+  static_assert(LType::kRows == RType::kRows && LType::kCols == RType::kCols, "Matrix expression size mismatch");
+
+public:
+  typedef typename LType::value_type value_type;
+  static const unsigned int kRows = LType::kRows;
+  static const unsigned int kCols = LType::kCols;
+
+  MatrixBinaryExpr(L&& m1, R&& m2) : m1_(std::forward<L>(m1)), m2_(std::forward<R>(m2)) {
+  }
+
+  value_type operator() (unsigned int row, unsigned int col) const {
+    return Op::apply(m1_(row, col), m2_(row, col));
+  }
+
+private:
+  typename matrix_impl::ExprOperand<L>::type m1_;
+  typename matrix_impl::ExprOperand<R>::type m2_;
+};
+
+template<typename E, typename ValueT>
+class MatrixScaleExpr : public MatrixExpr<MatrixScaleExpr<E, ValueT>> {
+  typedef typename std::decay<E>::type EType;
+
+public:
+  typedef typename EType::value_type value_type;
+  static const unsigned int kRows = EType::kRows;
+  static const unsigned int kCols = EType::kCols;
+
+  MatrixScaleExpr(E&& m1, ValueT value) : m1_(std::forward<E>(m1)), value_(value) {
+  }
+
+  value_type operator() (unsigned int row, unsigned int col) const {
+    return value_type(m1_(row, col) * value_);
+  }
+
+private:
+  typename matrix_impl::ExprOperand<E>::type m1_;
+  ValueT value_;
+};
+
+template<typename L, typename R>
+bool operator == (const MatrixExpr<L>& m1, const MatrixExpr<R>& m2) {
+  static_assert(L::kRows == R::kRows && L::kCols == R::kCols, "Matrix expression size mismatch");
+  const L& e1 = m1.self();
+  const R& e2 = m2.self();
+  for (unsigned int r = 0; r < L::kRows; ++r) {
+    for (unsigned int c = 0; c < L::kCols; ++c) {
+      if (!matrix_impl::equalZero(e1(r, c) - e2(r, c))) {
         return false;
       }
     }
@@ -118,75 +290,65 @@ bool operator == (const Matrix<T, Rows, Cols>& m1, const Matrix<T, Rows, Cols>&
   return true;
 }
 
-template<typename T, unsigned int Rows, unsigned int Cols>
-inline bool operator != (const Matrix<T, Rows, Cols>& m1, const Matrix<T, Rows, Cols>& m2) {
+template<typename L, typename R>
+inline bool operator != (const MatrixExpr<L>& m1, const MatrixExpr<R>& m2) {
   return !(m1 == m2);
 }
 
-template<typename T, unsigned int Rows, unsigned int Cols>
-Matrix<T, Rows, Cols> operator + (const Matrix<T, Rows, Cols>& m1, const Matrix<T, Rows, Cols>& m2) {
-  Matrix<T, Rows, Cols> rm;
-  for (unsigned int r = 0; r < Rows; ++r) {
-    for (unsigned int c = 0; c < Cols; ++c) {
-      rm[r][c] = m1[r][c] + m2[r][c];
-    }
-  }
-
-  return rm;
+template<typename L, typename R>
+inline typename std::enable_if<matrix_impl::IsMatrixExpr<L>::value && matrix_impl::IsMatrixExpr<R>::value,
+                               MatrixBinaryExpr<L, R, matrix_impl::Plus>>::type
+operator + (L&& m1, R&& m2) {
+  return MatrixBinaryExpr<L, R, matrix_impl::Plus>(std::forward<L>(m1), std::forward<R>(m2));
 }
 
-template<typename T, unsigned int Rows, unsigned int Cols>
-Matrix<T, Rows, Cols>& operator += (Matrix<T, Rows, Cols>& m1, const Matrix<T, Rows, Cols>& m2) {
-  for (unsigned int r = 0; r < Rows; ++r) {
-    for (unsigned int c = 0; c < Cols; ++c) {
-      m1[r][c] = m1[r][c] + m2[r][c];
-    }
-  }
-
-  return m1;
+template<typename L, typename R>
+inline typename std::enable_if<matrix_impl::IsMatrixExpr<L>::value && matrix_impl::IsMatrixExpr<R>::value,
+                               MatrixBinaryExpr<L, R, matrix_impl::Minus>>::type
+operator - (L&& m1, R&& m2) {
+  return MatrixBinaryExpr<L, R, matrix_impl::Minus>(std::forward<L>(m1), std::forward<R>(m2));
 }
 
-template<typename T, unsigned int Rows, unsigned int Cols>
-Matrix<T, Rows, Cols> operator - (const Matrix<T, Rows, Cols>& m1, const Matrix<T, Rows, Cols>& m2) {
-  Matrix<T, Rows, Cols> rm;
-  for (unsigned int r = 0; r < Rows; ++r) {
-    for (unsigned int c = 0; c < Cols; ++c) {
-      rm[r][c] = m1[r][c] - m2[r][c];
-    }
-  }
+template<typename E, typename ValueT>
+inline typename std::enable_if<matrix_impl::IsMatrixExpr<E>::value && std::is_arithmetic<ValueT>::value,
+                               MatrixScaleExpr<E, ValueT>>::type
+operator * (E&& m1, ValueT value) {
+  return MatrixScaleExpr<E, ValueT>(std::forward<E>(m1), value);
+}
 
-  return rm;
+template<typename E, typename ValueT>
+inline typename std::enable_if<matrix_impl::IsMatrixExpr<E>::value && std::is_arithmetic<ValueT>::value,
+                               MatrixScaleExpr<E, ValueT>>::type
+operator * (ValueT value, E&& m1) {
+  return MatrixScaleExpr<E, ValueT>(std::forward<E>(m1), value);
 }
 
-template<typename T, unsigned int Rows, unsigned int Cols>
-Matrix<T, Rows, Cols>& operator -= (Matrix<T, Rows, Cols>& m1, const Matrix<T, Rows, Cols>& m2) {
+template<typename T, unsigned int Rows, unsigned int Cols, typename E>
+Matrix<T, Rows, Cols>& operator += (Matrix<T, Rows, Cols>& m1, const MatrixExpr<E>& m2) {
+  static_assert(E::kRows == Rows && E::kCols == Cols, "Matrix expression size mismatch");
+  const E& e = m2.self();
   for (unsigned int r = 0; r < Rows; ++r) {
     for (unsigned int c = 0; c < Cols; ++c) {
-      m1[r][c] = m1[r][c] - m2[r][c];
+      m1[r][c] = m1[r][c] + e(r, c);
     }
   }
 
   return m1;
 }
 
-template<typename T, unsigned int Rows, unsigned int Cols, typename ValueT>
-Matrix<T, Rows, Cols> operator * (const Matrix<T, Rows, Cols>& m1, ValueT value) {
-  Matrix<T, Rows, Cols> rm;
+template<typename T, unsigned int Rows, unsigned int Cols, typename E>
+Matrix<T, Rows, Cols>& operator -= (Matrix<T, Rows, Cols>& m1, const MatrixExpr<E>& m2) {
+  static_assert(E::kRows == Rows && E::kCols == Cols, "Matrix expression size mismatch");
+  const E& e = m2.self();
   for (unsigned int r = 0; r < Rows; ++r) {
     for (unsigned int c = 0; c < Cols; ++c) {
-      rm[r][c] = m1[r][c] * value;
+      m1[r][c] = m1[r][c] - e(r, c);
     }
   }
 
-  return rm;
-}
-
-template<typename T, unsigned int Rows, unsigned int Cols, typename ValueT>
-inline Matrix<T, Rows, Cols> operator * (ValueT value, const Matrix<T, Rows, Cols>& m1) {
-  return operator *(m1, value);
+  return m1;
 }
 
-
 template<typename T, unsigned int Rows, unsigned int Cols, typename ValueT>
 Matrix<T, Rows, Cols>& operator *= (Matrix<T, Rows, Cols>& m1, ValueT value) {
   for (unsigned int r = 0; r < Rows; ++r) {
@@ -200,7 +362,7 @@ Matrix<T, Rows, Cols>& operator *= (Matrix<T, Rows, Cols>& m1, ValueT value) {
 
 template<typename T, unsigned int Rows, unsigned int M, unsigned int Cols>
 Matrix<T, Rows, Cols> operator * (const Matrix<T, Rows, M>& m1, const Matrix<T, M, Cols>& m2) {
-  Matrix<T, Rows, Cols> rm;
+  Matrix<T, Rows, Cols> rm(kMatrixUninitialized);
   for (unsigned int r = 0; r < Rows; ++r) {
     for (unsigned int c = 0; c < Cols; ++c) {
       T sum = 0;
@@ -215,9 +377,88 @@ Matrix<T, Rows, Cols> operator * (const Matrix<T, Rows, M>& m1, const Matrix<T,
   return rm;
 }
 
+namespace matrix_impl {
+
+  //dst = v * m for rows row vectors of 4 held one after another, m 16 values row
+  //after row. the sums run in the order of the generic product, so the SSE2
+  //versions give the same bits. a row of dst may be its own row of v
+  template<typename T>
+  inline void transformRows4(T* dst, const T* v, unsigned int rows, const T* m) {
+    for (unsigned int r = 0; r < rows * 4; r += 4) {
+      const T x = v[r], y = v[r + 1], z = v[r + 2], w = v[r + 3];
+      for (unsigned int c = 0; c < 4; ++c) {
+        dst[r + c] = x * m[c] + y * m[4 + c] + z * m[8 + c] + w * m[12 + c];
+      }
+    }
+  }
+
+#ifdef S3D_MATH_SSE2
+  inline void transformRows4(float* dst, const float* v, unsigned int rows, const float* m) {
+    const __m128 m0 = _mm_loadu_ps(m), m1 = _mm_loadu_ps(m + 4);
+    const __m128 m2 = _mm_loadu_ps(m + 8), m3 = _mm_loadu_ps(m + 12);
+    for (unsigned int r = 0; r < rows * 4; r += 4) {
+      const __m128 row = _mm_loadu_ps(v + r);
+      __m128 acc = _mm_mul_ps(_mm_shuffle_ps(row, row, 0x00), m0);
+      acc = _mm_add_ps(acc, _mm_mul_ps(_mm_shuffle_ps(row, row, 0x55), m1));
+      acc = _mm_add_ps(acc, _mm_mul_ps(_mm_shuffle_ps(row, row, 0xaa), m2));
+      acc = _mm_add_ps(acc, _mm_mul_ps(_mm_shuffle_ps(row, row, 0xff), m3));
+      _mm_storeu_ps(dst + r, acc);
+    }
+  }
+
+  //a double row is two registers, x y and z w
+  inline void transformRows4(double* dst, const double* v, unsigned int rows, const double* m) {
+    __m128d lo[4], hi[4];
+    for (int i = 0; i < 4; ++i) {
+      lo[i] = _mm_loadu_pd(m + i * 4);
+      hi[i] = _mm_loadu_pd(m + i * 4 + 2);
+    }
+
+    for (unsigned int r = 0; r < rows * 4; r += 4) {
+      __m128d s = _mm_set1_pd(v[r]);
+      __m128d accLo = _mm_mul_pd(s, lo[0]), accHi = _mm_mul_pd(s, hi[0]);
+      for (int i = 1; i < 4; ++i) {
+        s = _mm_set1_pd(v[r + i]);
+        accLo = _mm_add_pd(accLo, _mm_mul_pd(s, lo[i]));
+        accHi = _mm_add_pd(accHi, _mm_mul_pd(s, hi[i]));
+      }
+
+      _mm_storeu_pd(dst + r, accLo);
+      _mm_storeu_pd(dst + r + 2, accHi);
+    }
+  }
+#endif
+
+}// matrix_impl
+
+//the 4x4 float and double products are inline, a single product costs no call
+template<>
+inline Matrix<float, 4U, 4U> operator * <float, 4U, 4U, 4U>(const Matrix<float, 4U, 4U>& m1, const Matrix<float, 4U, 4U>& m2) {
+  Matrix<float, 4U, 4U> rm(kMatrixUninitialized);
+  matrix_impl::transformRows4(rm[0], m1[0], 4, m2[0]);
+  return rm;
+}
+
+template<>
+inline Matrix<double, 4U, 4U> operator * <double, 4U, 4U, 4U>(const Matrix<double, 4U, 4U>& m1, const Matrix<double, 4U, 4U>& m2) {
+  Matrix<double, 4U, 4U> rm(kMatrixUninitialized);
+  matrix_impl::transformRows4(rm[0], m1[0], 4, m2[0]);
+  return rm;
+}
+
+//products stay eager: every 4x4 one is a single inline kernel and the next product
+//in a chain needs all of it. element wise operands are evaluated first
+template<typename L, typename R>
+inline typename std::enable_if<matrix_impl::IsMatrixExpr<L>::value && matrix_impl::IsMatrixExpr<R>::value &&
+                               !(matrix_impl::IsMatrix<L>::value && matrix_impl::IsMatrix<R>::value),
+                               Matrix<typename L::value_type, L::kRows, R::kCols>>::type
+operator * (const L& m1, const R& m2) {
+  return typename matrix_impl::Evaluated<L>::type(m1) * typename matrix_impl::Evaluated<R>::type(m2);
+}
+
 template<typename T, unsigned int Rows, unsigned int Cols>
 inline Matrix<T, Rows, Cols>& operator *= (Matrix<T, Rows, Cols>& m1, const Matrix<T, Rows, Cols>& m2) {
-  m1 = m1 * M2;
+  m1 = m1 * m2;
   return m1;
 }
 
@@ -234,116 +475,137 @@ T matrixDet(const Matrix<T, 3, 3>& m1) {
 
 namespace matrix_impl
 {
+  //integer matrices are factored in double
   template<typename T>
-  int computeInverseNumbers(T* array, unsigned size) {
-    int sum = 0;
-    for (unsigned i = 1; i < size; ++i) {
-      if (array[i] < 0) {
-        continue;
-      }
+  struct FactorType {
+    typedef typename std::conditional<std::is_integral<T>::value, double, T>::type type;
+  };
 
-      for (unsigned j = 0; j < i; ++j) {
-        if (array[j] < 0) {
-          continue;
-        }
-        if (array[i] < array[j]) {
-          sum++;
-        }
-      }
-    }
-    return sum;
+  template<typename T, typename F>
+  inline T fromFactor(F value) {
+    return std::is_integral<T>::value ? T(std::lround(value)) : T(value);
   }
 
-  template<typename T, unsigned int M>
-  T computeDet(const Matrix<T, M, M>& m1) {
-    bool flags[M] = {0};
-    int inverseNumbers[M] = {0};
-    T sum = T(0);
-    T colsum = T(1);
-    computeDet<T, M>(m1, sum, colsum, 0, flags, inverseNumbers);
-    return sum;
-  }
+  //partial pivot LU in place, P * A = L * U with the unit lower L under the
+  //diagonal and U on and above it. perm[r] is the source row of row r.
+  //returns the sign of P, 0 when a whole pivot column is zero
+  template<typename F, unsigned int M>
+  int luDecompose(F lu[M][M], unsigned int perm[M]) {
+    int sign = 1;
+    for (unsigned int r = 0; r < M; ++r) {
+      perm[r] = r;
+    }
 
-  template<typename T, unsigned int M>
-  T computeDetDetExclude(const Matrix<T, M, M>& m1, int excludeRow, int excludeCol) {
-    bool flags[M] = {0};
-    int inverseNumbers[M] = {0};
-    T sum = T(0);
-    T colsum = T(1);
-    computeDet<T, M>(m1, sum, colsum, 0, flags, inverseNumbers, excludeRow, excludeCol);
-    return sum;
-  }
+    for (unsigned int k = 0; k < M; ++k) {
+      unsigned int pivot = k;
+      for (unsigned int r = k + 1; r < M; ++r) {
+        if (std::fabs(lu[r][k]) > std::fabs(lu[pivot][k])) {
+          pivot = r;
+        }
+      }
 
-  template<typename T, unsigned int M>
-  void computeDet(const Matrix<T, M, M>& m1, T& sum, T colsum, int currentRow, bool flags[M], int inverseNumbers[M]) {
-    if (currentRow == M) {
-      if (computeInverseNumbers(inverseNumbers, M) % 2 > 0) { 
-        sum -= colsum;
-      } else {
-        sum += colsum;
+      if (lu[pivot][k] == F(0)) {
+        return 0;
+      }
+
+      if (pivot != k) {
+        std::swap_ranges(lu[k], lu[k] + M, lu[pivot]);
+        std::swap(perm[k], perm[pivot]);
+        sign = -sign;
       }
-      
-      return;
-    }
 
-    for (int i = 0; i < M; ++i) {
-      if (flags[i]) {
-        continue;
+      for (unsigned int r = k + 1; r < M; ++r) {
+        const F f = lu[r][k] /= lu[k][k];
+        for (unsigned int c = k + 1; c < M; ++c) {
+          lu[r][c] -= f * lu[k][c];
+        }
       }
-      flags[i] = true;
-      inverseNumbers[currentRow] = i + 1;
-      const T tmpsum = colsum * m1[currentRow][i];
-      computeDet<T, M>(m1, sum, tmpsum, currentRow + 1, flags, inverseNumbers);
-      flags[i] = false;
     }
+
+    return sign;
   }
 
-  template<typename T, unsigned int M>
-  void computeDetExclude(const Matrix<T, M, M>& m1, T& sum, T colsum, int currentRow, bool flags[M], int inverseNumbers[M], 
-                         int excludeRow, int excludeCol) {
-    if (currentRow == M || (excludeRow == M - 1) && (currentRow == excludeRow)) {
-      if (computeInverseNumbers(inverseNumbers, M) % 2 > 0) {
-        sum -= colsum;
-      } else {
-        sum += colsum;
+  template<typename T, unsigned int M, typename F>
+  F luFactor(const Matrix<T, M, M>& m1, F lu[M][M], unsigned int perm[M]) {
+    for (unsigned int r = 0; r < M; ++r) {
+      for (unsigned int c = 0; c < M; ++c) {
+        lu[r][c] = F(m1[r][c]);
       }
-
-      return;
     }
 
-    if (currentRow == excludeRow) {
-      inverseNumbers[currentRow] = -1;
-      computeDet<T, M>(m1, sum, colsum, currentRow + 1, flags, inverseNumbers, excludeRow, excludeCol);
-      return;
+    F det = F(luDecompose<F, M>(lu, perm));
+    for (unsigned int i = 0; i < M; ++i) {
+      det *= lu[i][i];
     }
+    return det;
+  }
 
-    for (int i = 0; i < M; ++i) {
-      if (i == excludeCol) {
-        continue;
-      }
-      if (flags[i]) {
-        continue;
-      }
-      flags[i] = true;
-      inverseNumbers[currentRow] = i + 1;
-      const T tmpsum = colsum * m1[currentRow][i];
-      computeDet<T, M>(m1, sum, tmpsum, currentRow + 1, flags, inverseNumbers, excludeRow, excludeCol);
-      flags[i] = false;
-    }
+  //the 4x4 adjugate from the twelve 2x2 determinants of the top and bottom row pairs
+  template<typename T>
+  Matrix<T, 4U, 4U> adjoint4x4(const Matrix<T, 4U, 4U>& m1, T& det) {
+    const T s0 = m1[0][0] * m1[1][1] - m1[1][0] * m1[0][1];
+    const T s1 = m1[0][0] * m1[1][2] - m1[1][0] * m1[0][2];
+    const T s2 = m1[0][0] * m1[1][3] - m1[1][0] * m1[0][3];
+    const T s3 = m1[0][1] * m1[1][2] - m1[1][1] * m1[0][2];
+    const T s4 = m1[0][1] * m1[1][3] - m1[1][1] * m1[0][3];
+    const T s5 = m1[0][2] * m1[1][3] - m1[1][2] * m1[0][3];
+
+    const T c5 = m1[2][2] * m1[3][3] - m1[3][2] * m1[2][3];
+    const T c4 = m1[2][1] * m1[3][3] - m1[3][1] * m1[2][3];
+    const T c3 = m1[2][1] * m1[3][2] - m1[3][1] * m1[2][2];
+    const T c2 = m1[2][0] * m1[3][3] - m1[3][0] * m1[2][3];
+    const T c1 = m1[2][0] * m1[3][2] - m1[3][0] * m1[2][2];
+    const T c0 = m1[2][0] * m1[3][1] - m1[3][0] * m1[2][1];
+
+    det = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+
+    Matrix<T, 4U, 4U> mat(kMatrixUninitialized);
+    mat[0][0] = m1[1][1] * c5 - m1[1][2] * c4 + m1[1][3] * c3;
+    mat[0][1] = -m1[0][1] * c5 + m1[0][2] * c4 - m1[0][3] * c3;
+    mat[0][2] = m1[3][1] * s5 - m1[3][2] * s4 + m1[3][3] * s3;
+    mat[0][3] = -m1[2][1] * s5 + m1[2][2] * s4 - m1[2][3] * s3;
+
+    mat[1][0] = -m1[1][0] * c5 + m1[1][2] * c2 - m1[1][3] * c1;
+    mat[1][1] = m1[0][0] * c5 - m1[0][2] * c2 + m1[0][3] * c1;
+    mat[1][2] = -m1[3][0] * s5 + m1[3][2] * s2 - m1[3][3] * s1;
+    mat[1][3] = m1[2][0] * s5 - m1[2][2] * s2 + m1[2][3] * s1;
+
+    mat[2][0] = m1[1][0] * c4 - m1[1][1] * c2 + m1[1][3] * c0;
+    mat[2][1] = -m1[0][0] * c4 + m1[0][1] * c2 - m1[0][3] * c0;
+    mat[2][2] = m1[3][0] * s4 - m1[3][1] * s2 + m1[3][3] * s0;
+    mat[2][3] = -m1[2][0] * s4 + m1[2][1] * s2 - m1[2][3] * s0;
+
+    mat[3][0] = -m1[1][0] * c3 + m1[1][1] * c1 - m1[1][2] * c0;
+    mat[3][1] = m1[0][0] * c3 - m1[0][1] * c1 + m1[0][2] * c0;
+    mat[3][2] = -m1[3][0] * s3 + m1[3][1] * s1 - m1[3][2] * s0;
+    mat[3][3] = m1[2][0] * s3 - m1[2][1] * s1 + m1[2][2] * s0;
+
+    return mat;
   }
 }
 
+template<typename T>
+T matrixDet(const Matrix<T, 4U, 4U>& m1) {
+  T det;
+  matrix_impl::adjoint4x4(m1, det);
+  return det;
+}
+
+//product of the LU pivots, O(M^3)
 template<typename T, unsigned int M>
-inline T matrixDet(const Matrix<T, M, M>& m1) {
-  return matrix_impl::computeDet<T, M>(m1);
+T matrixDet(const Matrix<T, M, M>& m1) {
+  typedef typename matrix_impl::FactorType<T>::type F;
+  F lu[M][M];
+  unsigned int perm[M];
+  return matrix_impl::fromFactor<T>(matrix_impl::luFactor(m1, lu, perm));
 }
 
 template<typename T, unsigned int M>
 inline Matrix<T, M, M> matrixTranspose(const Matrix<T, M, M>& m1) {
-  Matrix<T, M, M> rm;
+  Matrix<T, M, M> rm(kMatrixUninitialized);
   for (unsigned int r = 0; r < M; ++r) {
     for (unsigned int c = 0; c < M; ++c) {
-      rm[c][r] = m1[c][r];
+      rm[c][r] = m1[r][c];
     }
   }
   return rm;
@@ -351,7 +613,7 @@ inline Matrix<T, M, M> matrixTranspose(const Matrix<T, M, M>& m1) {
 
 template<typename T>
 inline Matrix<T, 2U, 2U> matrixAdjoint(const Matrix<T, 2U, 2U>& m1) {
-  Matrix<T, 2U, 2U> mat;
+  Matrix<T, 2U, 2U> mat(kMatrixUninitialized);
   mat[0][0] = m1[1][1];
   mat[0][1] = -m1[0][1];
   mat[1][0] = -m1[1][0];
@@ -361,7 +623,7 @@ inline Matrix<T, 2U, 2U> matrixAdjoint(const Matrix<T, 2U, 2U>& m1) {
 
 template<typename T>
 Matrix<T, 3U, 3U> matrixAdjoint(const Matrix<T, 3U, 3U>& m1) {
-  Matrix<T, 3U, 3U> mat;
+  Matrix<T, 3U, 3U> mat(kMatrixUninitialized);
 
   mat[0][0] = (m1[1][1] * m1[2][2] - m1[2][1] * m1[1][2]);
   mat[1][0] = -(m1[1][0] * m1[2][2] - m1[2][0] * m1[1][2]);
@@ -378,47 +640,173 @@ Matrix<T, 3U, 3U> matrixAdjoint(const Matrix<T, 3U, 3U>& m1) {
   return mat;
 }
 
+template<typename T>
+inline Matrix<T, 4U, 4U> matrixAdjoint(const Matrix<T, 4U, 4U>& m1) {
+  T det;
+  return matrix_impl::adjoint4x4(m1, det);
+}
+
+//cofactors from the determinants of the minors, which also works when m1 is singular
 template<typename T, unsigned int M>
 Matrix<T, M, M> matrixAdjoint(const Matrix<T, M, M>& m1) {
-  Matrix<T, M, M> mat;
-  
+  Matrix<T, M, M> mat(kMatrixUninitialized);
+  Matrix<T, M - 1, M - 1> sub(kMatrixUninitialized);
+
   for (unsigned int r = 0; r < M; ++r) {
     for (unsigned int c = 0; c < M; ++c) {
-      if ((r + c) % 2 == 0) {
-        rm[c][r] = matrix_impl::computeDetDetExclude(m1, r, c);
-      } else {
-        rm[c][r] = -matrix_impl::computeDetDetExclude(m1, r, c);
+      for (unsigned int i = 0, mr = 0; i < M; ++i) {
+        if (i == r) {
+          continue;
+        }
+        for (unsigned int j = 0, mc = 0; j < M; ++j) {
+          if (j != c) {
+            sub[mr][mc++] = m1[i][j];
+          }
+        }
+        ++mr;
       }
+
+      const T cofactor = matrixDet(sub);
+      mat[c][r] = (r + c) % 2 == 0 ? cofactor : -cofactor;
     }
   }
 
   return mat;
 }
 
-template<typename T, unsigned int M>
-Matrix<T, M, M> matrixInverse(const Matrix<T, M, M>& m1) {
-  const auto det = matrixDet(m1);
+template<typename T>
+Matrix<T, 4U, 4U> matrixInverse(const Matrix<T, 4U, 4U>& m1) {
+  T det;
+  Matrix<T, 4U, 4U> adjoint = matrix_impl::adjoint4x4(m1, det);
   if (matrix_impl::equalZero(det)) {
     throw MatrixInverseException("matrixInverse det is zero");
   }
 
-  const auto detInverse = T(1.0) / det;
-
-  Matrix<T, M, M> adjoint = matrixAdjoint(m1);
-  adjoint *= detInverse;
+  adjoint *= T(1.0) / det;
   return adjoint;
 }
 
+namespace matrix_impl
+{
+  template<typename T, unsigned int M>
+  Matrix<T, M, M> inverseByAdjoint(const Matrix<T, M, M>& m1) {
+    const auto det = matrixDet(m1);
+    if (equalZero(det)) {
+      throw MatrixInverseException("matrixInverse det is zero");
+    }
+
+    Matrix<T, M, M> adjoint = matrixAdjoint(m1);
+    adjoint *= T(1.0) / det;
+    return adjoint;
+  }
+
+  //the columns of the inverse solved from one LU factorization
+  template<typename T, unsigned int M>
+  Matrix<T, M, M> inverseByLU(const Matrix<T, M, M>& m1) {
+    typedef typename FactorType<T>::type F;
+    F lu[M][M];
+    unsigned int perm[M];
+    const F det = luFactor(m1, lu, perm);
+    if (equalZero(fromFactor<T>(det))) {
+      throw MatrixInverseException("matrixInverse det is zero");
+    }
+
+    Matrix<T, M, M> rm(kMatrixUninitialized);
+    F x[M];
+    for (unsigned int c = 0; c < M; ++c) {
+      //L * y = P * e_c, then U * x = y
+      for (unsigned int r = 0; r < M; ++r) {
+        F sum = perm[r] == c ? F(1) : F(0);
+        for (unsigned int i = 0; i < r; ++i) {
+          sum -= lu[r][i] * x[i];
+        }
+        x[r] = sum;
+      }
+
+      for (unsigned int r = M; r-- > 0;) {
+        F sum = x[r];
+        for (unsigned int i = r + 1; i < M; ++i) {
+          sum -= lu[r][i] * x[i];
+        }
+        x[r] = sum / lu[r][r];
+      }
+
+      for (unsigned int r = 0; r < M; ++r) {
+        rm[r][c] = T(x[r]);
+      }
+    }
+
+    return rm;
+  }
+}
+
+//closed form up to 3x3, partial pivot LU above 4x4. only the chosen one is instantiated
+template<typename T, unsigned int M>
+inline typename std::enable_if<(M <= 3), Matrix<T, M, M>>::type matrixInverse(const Matrix<T, M, M>& m1) {
+  return matrix_impl::inverseByAdjoint(m1);
+}
+
+template<typename T, unsigned int M>
+inline typename std::enable_if<(M > 4), Matrix<T, M, M>>::type matrixInverse(const Matrix<T, M, M>& m1) {
+  return matrix_impl::inverseByLU(m1);
+}
+
+//inverse of an affine transform for row vectors, the last column (0, 0, 0, 1).
+//the 3x3 part is inverted alone and the translation becomes -t * inverse(A).
+//throws MatrixInverseException
+template<typename T>
+Matrix<T, 4U, 4U> matrixInverseAffine(const Matrix<T, 4U, 4U>& m1) {
+  assert(matrix_impl::equalZero(m1[0][3]) && matrix_impl::equalZero(m1[1][3]) && matrix_impl::equalZero(m1[2][3]));
+
+  Matrix<T, 3U, 3U> a;
+  for (unsigned int r = 0; r < 3; ++r) {
+    std::copy(m1[r], m1[r] + 3, a[r]);
+  }
+
+  const T det = matrixDet(a);
+  if (matrix_impl::equalZero(det)) {
+    throw MatrixInverseException("matrixInverseAffine det is zero");
+  }
+
+  a = matrixAdjoint(a);
+  a *= T(1.0) / det;
+
+  Matrix<T, 4U, 4U> rm;
+  for (unsigned int c = 0; c < 3; ++c) {
+    for (unsigned int r = 0; r < 3; ++r) {
+      rm[r][c] = a[r][c];
+    }
+    rm[3][c] = -(m1[3][0] * a[0][c] + m1[3][1] * a[1][c] + m1[3][2] * a[2][c]);
+  }
+  rm[3][3] = T(1);
+  return rm;
+}
+
+//inverse of a rotation plus translation: the rotation transposed, the
+//translation -t * transpose(R). m1 must not scale or shear
+template<typename T>
+Matrix<T, 4U, 4U> matrixInverseRigid(const Matrix<T, 4U, 4U>& m1) {
+  Matrix<T, 4U, 4U> rm;
+  for (unsigned int c = 0; c < 3; ++c) {
+    for (unsigned int r = 0; r < 3; ++r) {
+      rm[r][c] = m1[c][r];
+    }
+    rm[3][c] = -(m1[3][0] * m1[c][0] + m1[3][1] * m1[c][1] + m1[3][2] * m1[c][2]);
+  }
+  rm[3][3] = T(1);
+  return rm;
+}
+
 template<typename T, unsigned int Rows, unsigned int Cols>
 inline T Matrix<T, Rows, Cols>::det() const {
   static_assert(Rows == Cols, "Matrix::det Rows != Cols");
-  return matrixDet<T, Rows>(*this);
+  return matrixDet(*this);
 }
 
 template<typename T, unsigned int Rows, unsigned int Cols>
 inline Matrix<T, Rows, Cols> Matrix<T, Rows, Cols>::inverse() const {
   static_assert(Rows == Cols, "Matrix::inverse Rows != Cols");
-  return matrixInverse<T, Rows>(*this);
+  return matrixInverse(*this);
 }
 
 template<typename T, unsigned int Rows, unsigned int Cols>
@@ -444,13 +832,13 @@ bool Matrix<T, Rows, Cols>::isIdentify() const {
 template<typename T, unsigned int Rows, unsigned int Cols>
 inline Matrix<T, Rows, Cols> Matrix<T, Rows, Cols>::transpose() const {
   static_assert(Rows == Cols, "Matrix::transpose Rows != Cols");
-  return matrixTranspose<T, Rows, Cols>(*this);
+  return matrixTranspose(*this);
 }
 
 template<typename T, unsigned int Rows, unsigned int Cols>
 inline Matrix<T, Rows, Cols> Matrix<T, Rows, Cols>::adjoint() const {
   static_assert(Rows == Cols, "Matrix::adjoint Rows != Cols");
-  return matrixAdjoint<T, Rows, Cols>(*this);
+  return matrixAdjoint(*this);
 }
 
 //throws MatrixInverseException
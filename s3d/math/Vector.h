@@ -12,9 +12,26 @@
 namespace s3d
 {
 
-class VectorDivideZeroException : public std::exception {
+namespace vector_impl
+{
+
+  inline bool equalZero(int a) {
+    return a == 0;
+  }
+
+  inline bool equalZero(float a) {
+    return ::fabs(a) < 1E-5;
+  }
+
+  inline bool equalZero(double a) {
+    return ::fabs(a) < 1E-13;
+  }
+
+}// vector_impl
+
+class VectorDivideZeroException : public std::runtime_error {
 public:
-  VectorDivideZeroException(const char * const & msg) : exception(msg) {
+  VectorDivideZeroException(const char * const & msg) : std::runtime_error(msg) {
   }
 };
 
@@ -25,10 +42,10 @@ public:
   T y_;
 
 public:
-  Vector2() : x_(T(0)), y_(T(0)) {
+  constexpr Vector2() : x_(T(0)), y_(T(0)) {
   }
 
-  Vector2(T x, T y) : x_(x), y_(y) {
+  constexpr Vector2(T x, T y) : x_(x), y_(y) {
   }
 
   Vector2(const std::initializer_list<T>& ilist) {
@@ -40,7 +57,7 @@ public:
   }
 
   typedef Vector2 Point2;
-  Vector2(const Point2& p0, const Point2& p1) : x_(p1.x_ - p0.x_), y_(p1.y_ - p0.y_) {
+  constexpr Vector2(const Point2& p0, const Point2& p1) : x_(p1.x_ - p0.x_), y_(p1.y_ - p0.y_) {
   }
 
   T length() const;
@@ -70,10 +87,10 @@ public:
   T z_;
 
 public:
-  Vector3() : x_(T(0)), y_(T(0)), z_(T(0)) {
+  constexpr Vector3() : x_(T(0)), y_(T(0)), z_(T(0)) {
   }
 
-  Vector3(T x, T y, T z) : x_(x), y_(y), z_(z) {
+  constexpr Vector3(T x, T y, T z) : x_(x), y_(y), z_(z) {
   }
 
   Vector3(const std::initializer_list<T>& ilist) {
@@ -86,7 +103,7 @@ public:
   }
 
   template<typename POINT>
-  Vector3(const POINT& p0, const POINT& p1) : x_(p1.x_ - p0.x_), y_(p1.y_ - p0.y_), z_(p1.z_ - p0.z_) {
+  constexpr Vector3(const POINT& p0, const POINT& p1) : x_(p1.x_ - p0.x_), y_(p1.y_ - p0.y_), z_(p1.z_ - p0.z_) {
   }
 
   T length() const;
@@ -121,13 +138,18 @@ public:
   T w_;
 
 public:
-  Vector4() : x_(T(0)), y_(T(0)), z_(T(0)), w_(T(1)) {
+  constexpr Vector4() : x_(T(0)), y_(T(0)), z_(T(0)), w_(T(1)) {
+  }
+
+  constexpr Vector4(T x, T y, T z) : x_(x), y_(y), z_(z), w_(T(1)) {
   }
 
-  Vector4(T x, T y, T z) : x_(x), y_(y), z_(z), w_(T(1)) {
+  constexpr explicit Vector4(const Vector3<T>& v3) : x_(v3.x_), y_(v3.y_), z_(v3.z_), w_(T(1)) {
   }
 
-  explicit Vector4(const Vector3<T>& v3) : x_(v3.x_), y_(v3.y_), z_(v3.z_), w_(T(1)) {
+  //between float and double
+  template<typename U>
+  constexpr explicit Vector4(const Vector4<U>& v4) : x_(T(v4.x_)), y_(T(v4.y_)), z_(T(v4.z_)), w_(T(v4.w_)) {
   }
 
   Vector4(const std::initializer_list<T>& ilist) {
@@ -141,7 +163,7 @@ public:
   }
 
   template<typename POINT>
-  Vector4(const POINT& p0, const POINT& p1) : x_(p1.x_ - p0.x_), y_(p1.y_ - p0.y_), z_(p1.z_ - p0.z_), w_(T(1)) {
+  constexpr Vector4(const POINT& p0, const POINT& p1) : x_(p1.x_ - p0.x_), y_(p1.y_ - p0.y_), z_(p1.z_ - p0.z_), w_(T(1)) {
   }
 
   T length() const;
@@ -166,23 +188,6 @@ public:
   Vector4 crossProduct(const Vector4& v) const;
 };
 
-namespace vector_impl
-{
-
-  inline bool equalZero(int a) {
-    return a == 0;
-  }
-
-  inline bool equalZero(float a) {
-    return ::fabs(a) < 1E-5;
-  }
-
-  inline bool equalZero(double a) {
-    return ::fabs(a) < 1E-13;
-  }
-
-}// vector_impl
-
 template<typename T>
 bool operator == (const Vector2<T>& v1, const Vector2<T>& v2) {
   return vector_impl::equalZero(v1.x_ - v2.x_) && vector_impl::equalZero(v1.y_ - v2.y_);
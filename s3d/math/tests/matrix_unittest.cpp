@@ -7,6 +7,60 @@
 #include <string>
 
 using namespace s3d;
+
+namespace
+{
+
+int computeInverseNumbers(const unsigned int* array, unsigned int size) {
+  int sum = 0;
+  for (unsigned int i = 1; i < size; ++i) {
+    for (unsigned int j = 0; j < i; ++j) {
+      if (array[i] < array[j]) {
+        sum++;
+      }
+    }
+  }
+  return sum;
+}
+
+template<typename T, unsigned int M>
+void computeDet(const Matrix<T, M, M>& m1, T& sum, T colsum, unsigned int currentRow, bool flags[M], unsigned int inverseNumbers[M]) {
+  if (currentRow == M) {
+    if (computeInverseNumbers(inverseNumbers, M) % 2 > 0) {
+      sum -= colsum;
+    } else {
+      sum += colsum;
+    }
+
+    return;
+  }
+
+  for (unsigned int i = 0; i < M; ++i) {
+    if (flags[i]) {
+      continue;
+    }
+    flags[i] = true;
+    inverseNumbers[currentRow] = i + 1;
+    const T tmpsum = colsum * m1[currentRow][i];
+    computeDet<T, M>(m1, sum, tmpsum, currentRow + 1, flags, inverseNumbers);
+    flags[i] = false;
+  }
+}
+
+//the determinant by the permutation expansion. O(M!), the exact reference
+//matrixDet's factored versions are checked against
+template<typename T, unsigned int M>
+T computeDet(const Matrix<T, M, M>& m1) {
+  bool flags[M] = {0};
+  unsigned int inverseNumbers[M] = {0};
+  T sum = T(0);
+  T colsum = T(1);
+  computeDet<T, M>(m1, sum, colsum, 0, flags, inverseNumbers);
+  return sum;
+}
+
+}
+
 //const char str[] = "12345";
 //bool mat[5] = {false};
 //int cnum = 0;
@@ -80,9 +134,9 @@ BOOST_AUTO_TEST_CASE(testMatrix2x2) {
 
 
     BOOST_CHECK_EQUAL(matrixDet(m1), -2);
-    BOOST_CHECK_EQUAL(matrixDet(m1), matrix_impl::computeDet(m1));
+    BOOST_CHECK_EQUAL(matrixDet(m1), computeDet(m1));
 
-    BOOST_CHECK_EQUAL(matrixDet(m5), matrix_impl::computeDet(m5));
+    BOOST_CHECK_EQUAL(matrixDet(m5), computeDet(m5));
 
     {
       auto m  = matrixInverse(m1);
@@ -159,12 +213,12 @@ BOOST_AUTO_TEST_CASE(testMatrix3x3) {
       BOOST_CHECK(m == 12 * m1);
     }
 
-    BOOST_CHECK_EQUAL(matrixDet(m1), matrix_impl::computeDet(m1));
-    BOOST_CHECK_EQUAL(m1.det(), matrix_impl::computeDet(m1));
+    BOOST_CHECK_EQUAL(matrixDet(m1), computeDet(m1));
+    BOOST_CHECK_EQUAL(m1.det(), computeDet(m1));
 
     BOOST_CHECK_EQUAL(matrixDet(m4), 8);
-    BOOST_CHECK_EQUAL(matrixDet(m4), matrix_impl::computeDet(m4));
-    BOOST_CHECK_EQUAL(matrixDet(m3), matrix_impl::computeDet(m3));
+    BOOST_CHECK_EQUAL(matrixDet(m4), computeDet(m4));
+    BOOST_CHECK_EQUAL(matrixDet(m3), computeDet(m3));
 
 
 
@@ -202,8 +256,102 @@ BOOST_AUTO_TEST_CASE(testMatrix4x4) {
   {
     const Matrix4x4F m1 = {1, 2, 3, 4, 5, 6, 7, 8, 9, 11, 12, 13, 14, 11, 12, 13};
     {
-      BOOST_CHECK_EQUAL(matrixDet(m1), matrix_impl::computeDet(m1));
-      BOOST_CHECK_EQUAL(m1.det(), matrix_impl::computeDet(m1));
+      BOOST_CHECK_EQUAL(matrixDet(m1), computeDet(m1));
+      BOOST_CHECK_EQUAL(m1.det(), computeDet(m1));
+    }
+
+    {
+      const Matrix4x4F m3 = {2, 1, 0, 3, 4, 0, 1, 1, 0, 5, 2, 1, 1, 1, 1, 6};
+      BOOST_CHECK_EQUAL(m3.det(), computeDet(m3));
+
+      auto m = m3.inverse();
+      BOOST_CHECK((m3 * m).isIdentify());
+      BOOST_CHECK(m3.adjoint() * (1.f / m3.det()) == m);
+      BOOST_CHECK(m1.transpose().transpose() == m1);
+      BOOST_CHECK_EQUAL(m1.transpose()[0][3], 14);
+    }
+
+    {
+      const Matrix4x4F m2 = {1, 2, 3, 4, 2, 4, 6, 8, 0, 1, 0, 1, 5, 0, 0, 1};
+      BOOST_CHECK_EQUAL(m2.det(), 0);
+      BOOST_CHECK_THROW(m2.inverse(), MatrixInverseException);
     }
   }
-}
\ No newline at end of file
+
+  {
+    //rotation by 90 degrees about z, then a translation, for row vectors
+    const Matrix4x4F rigid = {0, 1, 0, 0, -1, 0, 0, 0, 0, 0, 1, 0, 3, -4, 5, 1};
+    const Matrix4x4F inverse = rigid.inverse();
+    BOOST_CHECK(matrixInverseRigid(rigid) == inverse);
+    BOOST_CHECK(matrixInverseAffine(rigid) == inverse);
+
+    const Matrix4x4F affine = {2, 0, 1, 0, 0, 3, 0, 0, 1, 0, 4, 0, 7, 8, 9, 1};
+    BOOST_CHECK((affine * matrixInverseAffine(affine)).isIdentify());
+    BOOST_CHECK(matrixInverseAffine(affine) == affine.inverse());
+  }
+}
+
+BOOST_AUTO_TEST_CASE(testMatrix5x5) {
+  const Matrix<double, 5U, 5U> m1 = {2, 1, 0, 3, 1,
+                                     4, 0, 1, 1, 2,
+                                     0, 5, 2, 1, 0,
+                                     1, 1, 1, 6, 3,
+                                     3, 0, 2, 1, 7};
+  BOOST_CHECK_CLOSE(m1.det(), computeDet(m1), 1e-9);
+
+  const auto m = m1.inverse();
+  BOOST_CHECK((m1 * m).isIdentify());
+  BOOST_CHECK((m * m1).isIdentify());
+  BOOST_CHECK(m1.adjoint() * (1.0 / m1.det()) == m);
+
+  const Matrix<int, 5U, 5U> m2 = {2, 1, 0, 3, 1,
+                                  4, 0, 1, 1, 2,
+                                  0, 5, 2, 1, 0,
+                                  1, 1, 1, 6, 3,
+                                  3, 0, 2, 1, 7};
+  BOOST_CHECK_EQUAL(m2.det(), computeDet(m2));
+
+  Matrix<double, 5U, 5U> singular = m1;
+  std::copy(m1[1], m1[1] + 5, singular[4]);
+  BOOST_CHECK_THROW(singular.inverse(), MatrixInverseException);
+}
+BOOST_AUTO_TEST_CASE(testMatrixExpr) {
+  static_assert(std::is_trivially_copyable<Matrix4x4FD>::value, "Matrix copies are plain memory copies");
+  static_assert(sizeof(Matrix4x4FD) == 16 * sizeof(double), "MatrixExpr base adds no size");
+
+  constexpr Matrix2x2F zero;
+  static_assert(zero[1][1] == 0.f, "default Matrix is zero in a constant expression");
+#if __cplusplus >= 201402L
+  constexpr Matrix2x2F constant = {1, 2, 3, 4};
+  static_assert(constant[1][0] == 3.f && constant(0, 1) == 2.f, "initializer list in a constant expression");
+#endif
+
+  const Matrix2x2FD m1 = {1, 2, 3, 4};
+  const Matrix2x2FD m2 = {11, 12, 13, 14};
+  const Matrix2x2FD m3 = {0.5, 1.5, 2.5, 3.5};
+
+  //one pass, the same values as one operator at a time
+  const Matrix2x2FD fused = m1 + m2 * 2. - 0.5 * m3;
+  for (unsigned int r = 0; r < 2; ++r) {
+    for (unsigned int c = 0; c < 2; ++c) {
+      BOOST_CHECK_EQUAL(fused[r][c], m1[r][c] + m2[r][c] * 2. - 0.5 * m3[r][c]);
+    }
+  }
+
+  //temporaries in an expression kept with auto are held by value
+  const auto kept = m1.transpose() + Matrix2x2FD{1, 1, 1, 1};
+  BOOST_CHECK(kept == Matrix2x2FD({2, 4, 3, 5}));
+
+  //the target may be an operand
+  Matrix2x2FD m = m1;
+  m = m2 - m;
+  BOOST_CHECK(m == Matrix2x2FD({10, 10, 10, 10}));
+  m += m1 - m3;
+  BOOST_CHECK(m == Matrix2x2FD({10.5, 10.5, 10.5, 10.5}));
+  m -= m1 * 2.;
+  BOOST_CHECK(m == Matrix2x2FD({8.5, 6.5, 4.5, 2.5}));
+
+  //products of expressions evaluate their operands first
+  BOOST_CHECK((m1 + m2) * m3 == Matrix2x2FD(m1 + m2) * m3);
+  BOOST_CHECK(m1 * (m2 - m3) == m1 * Matrix2x2FD(m2 - m3));
+}
@@ -0,0 +1,176 @@
+#include "../BinnedRenderer.h"
+#include "../OffscreenBuffer.h"
+#include "../DepthBuffer.h"
+#include "../Texture.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstdlib>
+#include <vector>
+
+using namespace s3d;
+
+namespace
+{
+
+//random triangles, some far outside the raster range to hit the span fallback
+std::vector<Point3<double>> randomTriangles(int count, int w, int h) {
+  std::vector<Point3<double>> vertices;
+  for (int n = 0; n < count * 3; ++n) {
+    if (n % 61 == 0) {
+      vertices.push_back(Point3<double>(kRasterMaxCoord + 1000., -kRasterMaxCoord - 1000., 0.5));
+      continue;
+    }
+    vertices.push_back(Point3<double>((rand() % 10000 / 10000. * 1.4 - 0.2) * w,
+                                      (rand() % 10000 / 10000. * 1.4 - 0.2) * h,
+                                      rand() % 1000 / 1000.));
+  }
+  return vertices;
+}
+
+bool sameDepth(const DepthBuffer& a, const DepthBuffer& b) {
+  for (int y = 0; y < a.getHeight(); ++y) {
+    for (int x = 0; x < a.getWidth(); ++x) {
+      if (a.getDepth(x, y) != b.getDepth(x, y))
+        return false;
+    }
+  }
+  return true;
+}
+
+int countDifferences(const RendererBuffer& a, const RendererBuffer& b) {
+  int count = 0;
+  for (int y = 0; y < a.getHeight(); ++y) {
+    for (int x = 0; x < a.getWidth(); ++x) {
+      if (a.getPixel(x, y) != b.getPixel(x, y))
+        ++count;
+    }
+  }
+  return count;
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(Renderer_scissor_unittest) {
+  OffscreenRendererBuffer target(40, 30);
+  Renderer renderer(target);
+  renderer.setScissor(RectI(10, 5, 9, 9));
+  renderer.fillTriangle2D_SubPixel({-5, -5}, {100, -5}, {-5, 100}, Color(1U));
+
+  int inside = 0, outside = 0;
+  for (int y = 0; y < 30; ++y) {
+    for (int x = 0; x < 40; ++x) {
+      if (target.getPixel(x, y) == 1U) {
+        if (x >= 10 && x <= 19 && y >= 5 && y <= 14)
+          ++inside;
+        else
+          ++outside;
+      }
+    }
+  }
+  BOOST_CHECK_EQUAL(inside, 100);
+  BOOST_CHECK_EQUAL(outside, 0);
+
+  //scissor is clipped to the buffer
+  renderer.setScissor(RectI(30, 20, 100, 100));
+  BOOST_CHECK_EQUAL(renderer.getScissor().getRight(), 39);
+  BOOST_CHECK_EQUAL(renderer.getScissor().getBottom(), 29);
+}
+
+BOOST_AUTO_TEST_CASE(BinnedRenderer_unittest) {
+  const int w = 211, h = 149;
+  srand(5);
+  const std::vector<Point3<double>> vertices = randomTriangles(300, w, h);
+  const Point2<double> uv0(0., 0.), uv1(2., 0.5), uv2(-0.5, 1.5);
+  Texture texture(16, 8);
+  for (int v = 0; v < 8; ++v) {
+    for (int u = 0; u < 16; ++u) {
+      texture.setTexel(u, v, uint32_t(u * 31 + v * 977));
+    }
+  }
+
+  for (int withDepth = 0; withDepth < 2; ++withDepth) {
+    OffscreenRendererBuffer serialTarget(w, h);
+    DepthBuffer serialDepth(w, h, kDepth32);
+    Renderer serial(serialTarget);
+    if (withDepth)
+      serial.setDepthBuffer(&serialDepth);
+
+    for (size_t n = 0; n < vertices.size(); n += 3) {
+      if (n % 9 == 0)
+        serial.fillTriangle3D_Gouraud(vertices[n], vertices[n + 1], vertices[n + 2], Color(0xff0000U), Color(0xff00U), Color(uint32_t(n)));
+      else if (n % 9 == 3)
+        serial.fillTriangle3D_Textured(vertices[n], vertices[n + 1], vertices[n + 2], uv0, uv1, uv2, texture);
+      else
+        serial.fillTriangle3D_Depth(vertices[n], vertices[n + 1], vertices[n + 2], Color(uint32_t(n + 1)));
+    }
+
+    const int threadCounts[] = {1, 3, 8};
+    for (int threads : threadCounts) {
+      OffscreenRendererBuffer target(w, h);
+      DepthBuffer depth(w, h, kDepth32);
+      BinnedRenderer binned(target, threads);
+      BOOST_CHECK_EQUAL(binned.getThreadCount(), threads);
+      if (withDepth)
+        binned.setDepthBuffer(&depth);
+
+      //two flushes, the second one draws over the first
+      const size_t half = vertices.size() / 6 * 3;
+      for (size_t n = 0; n < vertices.size(); n += 3) {
+        if (n % 9 == 0)
+          binned.fillTriangle3D_Gouraud(vertices[n], vertices[n + 1], vertices[n + 2], Color(0xff0000U), Color(0xff00U), Color(uint32_t(n)));
+        else if (n % 9 == 3)
+          binned.fillTriangle3D_Textured(vertices[n], vertices[n + 1], vertices[n + 2], uv0, uv1, uv2, texture);
+        else
+          binned.fillTriangle3D_Depth(vertices[n], vertices[n + 1], vertices[n + 2], Color(uint32_t(n + 1)));
+        if (n + 3 == half)
+          binned.flush();
+      }
+      binned.flush();
+
+      BOOST_CHECK_EQUAL(countDifferences(serialTarget, target), 0);
+      BOOST_CHECK(sameDepth(serialDepth, depth));
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(BinnedRenderer_polygons_unittest) {
+  const int w = 211, h = 149;
+  srand(11);
+
+  //planar overlapping quads, each filled from one depth plane on both paths
+  std::vector<Point4<double>> vertices;
+  std::vector<uint32_t> indices;
+  std::vector<uint8_t> counts;
+  std::vector<Color> colors;
+  for (int n = 0; n < 400; ++n) {
+    const double x = rand() % 10000 / 10000. * 1.2 * w - 0.1 * w, y = rand() % 10000 / 10000. * 1.2 * h - 0.1 * h;
+    const double ax = rand() % 60 + 5., ay = rand() % 40 - 20., bx = rand() % 40 - 20., by = rand() % 60 + 5.;
+    const double z = 0.1 + rand() % 800 / 1000., dzx = (rand() % 200 - 100) / 100000., dzy = (rand() % 200 - 100) / 100000.;
+    const double corners[4][2] = {{0., 0.}, {ax, ay}, {ax + bx, ay + by}, {bx, by}};
+    for (const auto& corner : corners) {
+      indices.push_back(static_cast<uint32_t>(vertices.size()));
+      vertices.push_back(Point4<double>(x + corner[0], y + corner[1], z + corner[0] * dzx + corner[1] * dzy));
+    }
+    counts.push_back(4);
+    colors.push_back(Color(uint32_t(n * 7919 + 1)));
+  }
+
+  OffscreenRendererBuffer serialTarget(w, h);
+  DepthBuffer serialDepth(w, h, kDepth32);
+  Renderer serial(serialTarget);
+  serial.setDepthBuffer(&serialDepth);
+  serial.drawIndexedPolygons(vertices.data(), static_cast<int>(vertices.size()), indices.data(), counts.data(),
+                             static_cast<int>(counts.size()), colors.data());
+
+  OffscreenRendererBuffer target(w, h);
+  DepthBuffer depth(w, h, kDepth32);
+  BinnedRenderer binned(target, 4);
+  binned.setDepthBuffer(&depth);
+  binned.drawIndexedPolygons(vertices.data(), static_cast<int>(vertices.size()), indices.data(), counts.data(),
+                             static_cast<int>(counts.size()), colors.data());
+  binned.flush();
+
+  BOOST_CHECK_EQUAL(countDifferences(serialTarget, target), 0);
+  BOOST_CHECK(sameDepth(serialDepth, depth));
+}
@@ -1,5 +1,6 @@
 #include "../Object.h"
 #include "../Camera.h"
+#include "../Pipeline.h"
 
 #include <boost/test/unit_test.hpp>
 #include <iostream>
@@ -50,4 +51,98 @@ BOOST_AUTO_TEST_CASE(CameraUVN_unittest) {
     BOOST_CHECK_EQUAL(ptTrans.w_, 1);
   }
 
-}
\ No newline at end of file
+}
+
+BOOST_AUTO_TEST_CASE(Pipeline_nearClip_unittest) {
+  CameraUVN camera({0, 0, 0}, {0, 0, 1}, 90, 10, 1000, 100, 100);
+
+  //two vertices behind the camera, one in front of the near plane, one past far
+  ObjectFD obj(0, "clip");
+  obj.addVertex({0, 20, 40});
+  obj.addVertex({20, -20, -5});
+  obj.addVertex({-20, -20, -5});
+  obj.addVertex({0, 20, 2000});
+  obj.addPolygon({0, 1, 2});
+  obj.addPolygon({0, 1, 3});
+  obj.vertexColors_ = {Color(200, 0, 0), Color(0, 100, 0), Color(0, 100, 0), Color(0, 0, 50)};
+  addToWorld(obj, 0, 0, 0);
+
+  BOOST_REQUIRE(objectToScreen(obj, camera, 100));
+  BOOST_REQUIRE_EQUAL(obj.transPolygons_.size(), 2U);
+  BOOST_CHECK_EQUAL(obj.transPolygons_[0].size(), 3U);
+  BOOST_CHECK_EQUAL(obj.transPolygons_[1].size(), 4U);
+  BOOST_CHECK_EQUAL(obj.transVertexColors_.size(), obj.transVertexList_.size());
+
+  //nothing left behind near, z_ is near / z
+  for (const auto& poly : obj.transPolygons_) {
+    for (auto index : poly) {
+      const auto& pt = obj.transVertexList_[index];
+      BOOST_CHECK_LE(pt.z_, 1. + 1e-12);
+      BOOST_CHECK_LT(std::abs(pt.x_), 1000.);
+      BOOST_CHECK_LT(std::abs(pt.y_), 1000.);
+    }
+  }
+
+  //edge 0-1 meets the near plane two thirds of the way, at camera x 40 / 3
+  const auto cut = obj.transVertexList_[obj.transPolygons_[0][1]];
+  BOOST_CHECK_CLOSE(cut.z_, 1., 1e-9);
+  BOOST_CHECK_CLOSE(cut.x_, 49.5 + 49.5 * 4. / 3., 1e-9);
+  BOOST_CHECK_CLOSE(cut.y_, 49.5 + 49.5 * 2. / 3., 1e-9);
+  BOOST_CHECK_EQUAL(obj.transVertexColors_[obj.transPolygons_[0][1]].getGreen(), 67);
+
+  //both polygons cut their shared edge at the very same point
+  const auto cut2 = obj.transVertexList_[obj.transPolygons_[1][1]];
+  BOOST_CHECK_EQUAL(cut2.x_, cut.x_);
+  BOOST_CHECK_EQUAL(cut2.y_, cut.y_);
+
+  //the wireframe edges are cut too, the back facing 1-2 between two vertices behind
+  //the camera is gone, the other four keep an end on the near plane
+  BOOST_REQUIRE(obj.transEdgesClipped_);
+  BOOST_CHECK_EQUAL(obj.transEdgeList_.size(), 2U * (obj.getEdgeList().size() / 2 - 1));
+  for (auto index : obj.transEdgeList_) {
+    BOOST_CHECK_LE(obj.transVertexList_[index].z_, 1. + 1e-12);
+    BOOST_CHECK_GT(obj.transVertexList_[index].z_, 0.);
+  }
+
+  //with the far plane as well, vertex 3 goes and the second polygon grows a side
+  addToWorld(obj, 0, 0, 0);
+  BOOST_REQUIRE(objectToScreen(obj, camera, 100, true));
+  BOOST_REQUIRE_EQUAL(obj.transPolygons_.size(), 2U);
+  BOOST_CHECK_EQUAL(obj.transPolygons_[1].size(), 5U);
+  for (const auto& poly : obj.transPolygons_) {
+    for (auto index : poly) {
+      BOOST_CHECK_GE(obj.transVertexList_[index].z_, 10. / 1000. - 1e-12);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(Pipeline_floatGeometry_unittest) {
+  CameraUVN camera({0, 0, 0}, {0, 0, 1}, 90, 10, 1000, 100, 100);
+
+  //the same clipped scene through float and double geometry
+  ObjectF objF(0, "float");
+  ObjectFD objFD(1, "double");
+  const Point4FD vertices[] = {{0, 20, 40}, {20, -20, -5}, {-20, -20, -5}, {0, 20, 60}, {-10, 5, 30}};
+  for (const auto& pt : vertices) {
+    objF.addVertex(pt);
+    objFD.addVertex(pt);
+  }
+  objF.addPolygon({0, 1, 2});
+  objF.addPolygon({0, 3, 4});
+  objFD.addPolygon({0, 1, 2});
+  objFD.addPolygon({0, 3, 4});
+  addToWorld(objF, buildRotateMatrix4x4(0., 0.3, 0.), 0, 0, 10);
+  addToWorld(objFD, buildRotateMatrix4x4(0., 0.3, 0.), 0, 0, 10);
+
+  BOOST_REQUIRE_EQUAL(objectToScreen(objF, camera, 100), objectToScreen(objFD, camera, 100));
+  BOOST_REQUIRE_EQUAL(objF.transPolygons_.size(), objFD.transPolygons_.size());
+  BOOST_REQUIRE_EQUAL(objF.transVertexList_.size(), objFD.transVertexList_.size());
+  for (std::size_t i = 0; i < objF.transPolygons_.size(); ++i) {
+    BOOST_CHECK_EQUAL(objF.transPolygons_[i].size(), objFD.transPolygons_[i].size());
+  }
+  for (std::size_t i = 0; i < objF.transVertexList_.size(); ++i) {
+    BOOST_CHECK_CLOSE(objF.transVertexList_[i].x_, objFD.transVertexList_[i].x_, 1e-3);
+    BOOST_CHECK_CLOSE(objF.transVertexList_[i].y_, objFD.transVertexList_[i].y_, 1e-3);
+    BOOST_CHECK_CLOSE(objF.transVertexList_[i].z_, objFD.transVertexList_[i].z_, 1e-3);
+  }
+}
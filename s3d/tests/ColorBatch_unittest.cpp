@@ -0,0 +1,66 @@
+#include "../ColorBatch.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+using namespace s3d;
+
+namespace
+{
+
+uint32_t channel(uint32_t p, int c) {
+  return (p >> (c * 8)) & 0xff;
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(ColorBatch_unittest) {
+  //odd count so every path runs its scalar tail, extremes at the front
+  const int count = 45;
+  srand(3);
+  std::vector<uint32_t> a(count), b(count);
+  std::vector<uint16_t> intensities(count);
+  for (int i = 0; i < count; ++i) {
+    a[i] = uint32_t(rand()) << 16 ^ uint32_t(rand());
+    b[i] = uint32_t(rand()) << 16 ^ uint32_t(rand());
+    intensities[i] = static_cast<uint16_t>(rand() % 1024);
+  }
+  a[0] = 0xffffffffU;
+  b[0] = 0xffffffffU;
+  a[1] = 0;
+  b[1] = 0xffffffffU;
+  intensities[0] = 65535;
+  intensities[1] = 256;
+  intensities[2] = 0;
+
+  const SimdLevel levels[] = {kSimdNone, kSimdSSE2, kSimdAVX2};
+  for (SimdLevel level : levels) {
+    selectColorBatch(level);
+    std::vector<uint32_t> modulated(count), added(count), lerped(count), scaled(count);
+    modulateColors(modulated.data(), a.data(), b.data(), count);
+    addColorsSaturate(added.data(), a.data(), b.data(), count);
+    lerpColors(lerped.data(), a.data(), b.data(), 77, count);
+    scaleColors(scaled.data(), a.data(), intensities.data(), count);
+
+    for (int i = 0; i < count; ++i) {
+      for (int c = 0; c < 4; ++c) {
+        const uint32_t ca = channel(a[i], c), cb = channel(b[i], c);
+        BOOST_CHECK_EQUAL(channel(modulated[i], c), uint32_t(std::floor(ca * cb / 255. + 0.5)));
+        BOOST_CHECK_EQUAL(channel(added[i], c), std::min(ca + cb, 255U));
+        BOOST_CHECK_EQUAL(channel(lerped[i], c), uint32_t(std::floor((ca * 179 + cb * 77) / 256. + 0.5)));
+        BOOST_CHECK_EQUAL(channel(scaled[i], c), c == 3 ? ca : std::min(ca * intensities[i] / 256, 255U));
+      }
+    }
+
+    //in place, and the ends of the lerp
+    std::vector<uint32_t> inPlace = a;
+    lerpColors(inPlace.data(), inPlace.data(), b.data(), 256, count);
+    BOOST_CHECK(inPlace == b);
+    lerpColors(inPlace.data(), a.data(), inPlace.data(), 0, count);
+    BOOST_CHECK(inPlace == a);
+  }
+  selectColorBatch(kSimdAVX2);
+}
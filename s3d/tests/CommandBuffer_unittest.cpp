@@ -0,0 +1,179 @@
+#include "../CommandBuffer.h"
+#include "../OffscreenBuffer.h"
+#include "../DepthBuffer.h"
+#include "../Texture.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstdlib>
+#include <vector>
+
+using namespace s3d;
+
+namespace
+{
+
+int countDifferences(const RendererBuffer& a, const RendererBuffer& b) {
+  int count = 0;
+  for (int y = 0; y < a.getHeight(); ++y) {
+    for (int x = 0; x < a.getWidth(); ++x) {
+      if (a.getPixel(x, y) != b.getPixel(x, y))
+        ++count;
+    }
+  }
+  return count;
+}
+
+//the same mix of draws into a Renderer or a CommandBuffer
+template<typename Target>
+void drawScene(Target& target, const std::vector<Point3<double>>& vertices, const Texture& texture) {
+  const Point2<double> uv0(0., 0.), uv1(2., 0.5), uv2(-0.5, 1.5);
+  for (size_t n = 0; n + 4 <= vertices.size(); n += 4) {
+    switch (n / 4 % 4) {
+    case 0:
+      target.fillTriangle3D_Gouraud(vertices[n], vertices[n + 1], vertices[n + 2], Color(0xff0000U), Color(0xff00U), Color(uint32_t(n)));
+      break;
+    case 1:
+      target.fillTriangle3D_Textured(vertices[n], vertices[n + 1], vertices[n + 2], uv0, uv1, uv2, texture);
+      break;
+    case 2: {
+      //a parallelogram, convex whatever the random corners
+      const Point3<double> quad[4] = {vertices[n], vertices[n + 1],
+                                      Point3<double>(vertices[n + 1].x_ + vertices[n + 2].x_ - vertices[n].x_,
+                                                     vertices[n + 1].y_ + vertices[n + 2].y_ - vertices[n].y_,
+                                                     vertices[n].z_),
+                                      vertices[n + 2]};
+      target.fillConvexPolygon3D_Depth(quad, 4, Color(uint32_t(n % 3 * 0x404040U)));
+      break;
+    }
+    default:
+      target.fillTriangle3D_Depth(vertices[n], vertices[n + 1], vertices[n + 2], Color(uint32_t(n % 5 * 0x10101U)));
+      break;
+    }
+  }
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(CommandBuffer_unittest) {
+  const int w = 173, h = 121;
+  srand(11);
+  std::vector<Point3<double>> vertices;
+  //every draw at its own constant depth, so no two ever tie and the order they
+  //come in does not matter once depth tested
+  for (int n = 0; n < 400; ++n) {
+    vertices.push_back(Point3<double>((rand() % 10000 / 10000. * 1.4 - 0.2) * w,
+                                      (rand() % 10000 / 10000. * 1.4 - 0.2) * h,
+                                      (n / 4 * 7 % 100 + 1) / 101.));
+  }
+  Texture texture(8, 8);
+  for (int v = 0; v < 8; ++v) {
+    for (int u = 0; u < 8; ++u) {
+      texture.setTexel(u, v, uint32_t(u * 37 + v * 1151));
+    }
+  }
+
+  OffscreenRendererBuffer directTarget(w, h);
+  DepthBuffer directDepth(w, h, kDepth32);
+  Renderer direct(directTarget);
+  direct.setDepthBuffer(&directDepth);
+  drawScene(direct, vertices, texture);
+
+  CommandBuffer commands;
+  drawScene(commands, vertices, texture);
+  BOOST_CHECK_EQUAL(commands.size(), vertices.size() / 4);
+
+  //replayed as recorded, twice, into fresh buffers: the same frame each time
+  for (int frame = 0; frame < 2; ++frame) {
+    OffscreenRendererBuffer target(w, h);
+    DepthBuffer depth(w, h, kDepth32);
+    Renderer renderer(target);
+    renderer.setDepthBuffer(&depth);
+    commands.execute(renderer);
+    BOOST_CHECK_EQUAL(countDifferences(directTarget, target), 0);
+  }
+
+  //depth tested, so sorting by state does not change the frame either
+  commands.sortByState();
+  {
+    OffscreenRendererBuffer target(w, h);
+    DepthBuffer depth(w, h, kDepth32);
+    Renderer renderer(target);
+    renderer.setDepthBuffer(&depth);
+    commands.execute(renderer);
+    BOOST_CHECK_EQUAL(countDifferences(directTarget, target), 0);
+  }
+
+  //handed to the binned renderer instead
+  {
+    OffscreenRendererBuffer target(w, h);
+    DepthBuffer depth(w, h, kDepth32);
+    BinnedRenderer binned(target, 2);
+    binned.setDepthBuffer(&depth);
+    commands.execute(binned);
+    binned.flush();
+    BOOST_CHECK_EQUAL(countDifferences(directTarget, target), 0);
+  }
+
+  commands.clear();
+  BOOST_CHECK(commands.empty());
+}
+
+BOOST_AUTO_TEST_CASE(CommandBuffer_sortBlend_unittest) {
+  //two overlapping source-over squares recorded before an opaque one. sorted,
+  //the opaque square goes first and the blended ones keep their order
+  const Point3<double> square[4] = {{1., 1., 0.5}, {9., 1., 0.5}, {9., 9., 0.5}, {1., 9., 0.5}};
+  const Point3<double> corner[4] = {{0., 0., 0.5}, {4., 0., 0.5}, {4., 4., 0.5}, {0., 4., 0.5}};
+  CommandBuffer commands;
+  commands.setBlendMode(kBlendSourceOver);
+  commands.fillConvexPolygon3D_Depth(square, 4, Color(255, 0, 0, 128));
+  commands.fillConvexPolygon3D_Depth(square, 4, Color(0, 0, 255, 128));
+  commands.setBlendMode(kBlendReplace);
+  commands.fillConvexPolygon3D_Depth(corner, 4, Color(0, 255, 0, 255));
+  commands.sortByState();
+
+  OffscreenRendererBuffer target(10, 10);
+  Renderer renderer(target);
+  renderer.setBlendMode(kBlendAdditive);
+  target.clear(0);
+  commands.execute(renderer);
+  BOOST_CHECK_EQUAL(renderer.getBlendMode(), kBlendAdditive);
+
+  //green under red under blue where they meet, red under blue elsewhere
+  const Color mixed(target.getPixel(2, 2));
+  BOOST_CHECK(mixed.getGreen() > 0 && mixed.getRed() > 0 && mixed.getBlue() > mixed.getRed());
+  const Color plain(target.getPixel(6, 6));
+  BOOST_CHECK_EQUAL(plain.getGreen(), 0);
+  BOOST_CHECK(plain.getBlue() > plain.getRed() && plain.getRed() > 0);
+
+  //additive, source-over, additive do not commute. sorted they replay in the
+  //order recorded, the same as the unsorted buffer with the opaque draw first
+  CommandBuffer mixedModes, reference;
+  reference.fillConvexPolygon3D_Depth(corner, 4, Color(0, 255, 0, 255));
+  for (CommandBuffer* buffer : {&mixedModes, &reference}) {
+    buffer->setBlendMode(kBlendAdditive);
+    buffer->fillConvexPolygon3D_Depth(square, 4, Color(96, 0, 0, 255));
+    buffer->setBlendMode(kBlendSourceOver);
+    buffer->fillConvexPolygon3D_Depth(square, 4, Color(0, 0, 255, 128));
+    buffer->setBlendMode(kBlendAdditive);
+    buffer->fillConvexPolygon3D_Depth(square, 4, Color(96, 0, 0, 255));
+  }
+  mixedModes.setBlendMode(kBlendReplace);
+  mixedModes.fillConvexPolygon3D_Depth(corner, 4, Color(0, 255, 0, 255));
+  mixedModes.sortByState();
+
+  OffscreenRendererBuffer expected(10, 10);
+  Renderer expectedRenderer(expected);
+  target.clear(0);
+  expected.clear(0);
+  mixedModes.execute(renderer);
+  reference.execute(expectedRenderer);
+  int mismatches = 0;
+  for (int y = 0; y < 10; ++y) {
+    for (int x = 0; x < 10; ++x) {
+      if (target.getPixel(x, y) != expected.getPixel(x, y))
+        ++mismatches;
+    }
+  }
+  BOOST_CHECK_EQUAL(mismatches, 0);
+}
@@ -0,0 +1,95 @@
+#include "../FramePipeline.h"
+#include "../OffscreenBuffer.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <stdexcept>
+#include <vector>
+
+using namespace s3d;
+
+namespace
+{
+
+uint32_t checksum(const RendererBuffer& buffer) {
+  uint32_t sum = 0;
+  for (int y = 0; y < buffer.getHeight(); ++y) {
+    for (int x = 0; x < buffer.getWidth(); ++x) {
+      sum = sum * 31 + buffer.getPixel(x, y);
+    }
+  }
+  return sum;
+}
+
+//frame n: a few triangles moving with n
+template<typename Target>
+void drawFrame(Target& target, int frame) {
+  for (int i = 0; i < 6; ++i) {
+    const double x = (frame * 7 + i * 13) % 50, y = (frame * 3 + i * 11) % 30;
+    target.fillTriangle3D_Depth(Point3<double>(x, y, 0.5), Point3<double>(x + 20., y + 3., 0.5),
+                                Point3<double>(x + 5., y + 17., 0.5), Color(uint32_t(frame * 0x10203U + i)));
+  }
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(FramePipeline_unittest) {
+  const int frames = 9;
+  std::vector<uint32_t> serial, pipelined;
+  OffscreenRendererBuffer target(64, 48);
+  Renderer renderer(target);
+  for (int frame = 0; frame < frames; ++frame) {
+    target.clear(0);
+    drawFrame(renderer, frame);
+    serial.push_back(checksum(target));
+  }
+
+  {
+    std::vector<int> order;
+    FramePipeline pipeline([&](const CommandBuffer& commands, int frame) {
+      order.push_back(frame);
+      target.clear(0);
+      commands.execute(renderer);
+      pipelined.push_back(checksum(target));
+    });
+
+    for (int frame = 0; frame < frames; ++frame) {
+      CommandBuffer& commands = pipeline.beginFrame();
+      BOOST_CHECK(commands.empty());
+      drawFrame(commands, frame);
+      pipeline.submitFrame();
+    }
+    pipeline.finish();
+
+    BOOST_CHECK_EQUAL(pipeline.getFrameCount(), frames);
+    BOOST_REQUIRE_EQUAL(order.size(), size_t(frames));
+    for (int frame = 0; frame < frames; ++frame) {
+      BOOST_CHECK_EQUAL(order[frame], frame);
+    }
+  }
+
+  BOOST_CHECK(serial == pipelined);
+}
+
+BOOST_AUTO_TEST_CASE(FramePipeline_error_unittest) {
+  //frame 1 fails and finish() reports it, the pipeline carries on afterwards
+  int drawn = 0;
+  FramePipeline pipeline([&](const CommandBuffer&, int frame) {
+    if (frame == 1)
+      throw std::runtime_error("raster failed");
+    ++drawn;
+  });
+
+  for (int frame = 0; frame < 2; ++frame) {
+    pipeline.beginFrame();
+    pipeline.submitFrame();
+  }
+
+  BOOST_CHECK_THROW(pipeline.finish(), std::runtime_error);
+  BOOST_CHECK_EQUAL(drawn, 1);
+
+  pipeline.beginFrame();
+  pipeline.submitFrame();
+  pipeline.finish();
+  BOOST_CHECK_EQUAL(drawn, 2);
+}
@@ -0,0 +1,116 @@
+#include "../FrameTiles.h"
+#include "../BinnedRenderer.h"
+#include "../OffscreenBuffer.h"
+
+#include <boost/test/unit_test.hpp>
+
+using namespace s3d;
+
+namespace
+{
+
+int countDifferences(const RendererBuffer& a, const RendererBuffer& b) {
+  int count = 0;
+  for (int y = 0; y < a.getHeight(); ++y) {
+    for (int x = 0; x < a.getWidth(); ++x) {
+      if (a.getPixel(x, y) != b.getPixel(x, y))
+        ++count;
+    }
+  }
+  return count;
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(FrameTiles_unittest) {
+  const int w = 200, h = 150;
+  OffscreenRendererBuffer target(w, h), reference(w, h);
+  FrameTiles tiles(target);
+  BOOST_CHECK_EQUAL(tiles.getColumns(), 4);
+  BOOST_CHECK_EQUAL(tiles.getRows(), 3);
+
+  Renderer renderer(target), referenceRenderer(reference);
+  renderer.setFrameTiles(&tiles);
+
+  //garbage to begin with, the first frame clears all of it
+  target.clear(0xdeadbeefU);
+  tiles.beginFrame(0x10U);
+  renderer.fillTriangle2D_SubPixel({10.5, 10.5}, {50.25, 20.}, {20., 55.75}, Color(0xff0000U));
+  RectI written;
+  BOOST_REQUIRE(tiles.getWrittenRect(written));
+  BOOST_CHECK_EQUAL(written.getLeft(), 0);
+  BOOST_CHECK_EQUAL(written.getRight(), 63);
+  BOOST_CHECK_EQUAL(written.getBottom(), 63);
+
+  RectI changed;
+  BOOST_REQUIRE(tiles.endFrame(changed));
+  BOOST_CHECK_EQUAL(changed.getRight(), w - 1);
+  BOOST_CHECK_EQUAL(changed.getBottom(), h - 1);
+
+  reference.clear(0x10U);
+  referenceRenderer.fillTriangle2D_SubPixel({10.5, 10.5}, {50.25, 20.}, {20., 55.75}, Color(0xff0000U));
+  BOOST_CHECK_EQUAL(countDifferences(target, reference), 0);
+
+  //a tile that holds the clear color and stays untouched is not filled again
+  target.setPixel(150, 100, 0x1234U);
+  tiles.beginFrame(0x10U);
+  renderer.fillSpan2D(130, 190, 70, 0xffU);
+  renderer.drawLine2D({70, 140}, {120, 140}, Color(0xff00U));
+  BOOST_REQUIRE(tiles.endFrame(changed));
+  BOOST_CHECK_EQUAL(target.getPixel(150, 100), 0x1234U);
+
+  //changed covers the new draws and the tile the triangle was erased from
+  BOOST_CHECK_EQUAL(changed.getLeft(), 0);
+  BOOST_CHECK_EQUAL(changed.getTop(), 0);
+  BOOST_CHECK_EQUAL(changed.getRight(), 191);
+  BOOST_CHECK_EQUAL(changed.getBottom(), h - 1);
+  BOOST_REQUIRE(tiles.getWrittenRect(written));
+  BOOST_CHECK_EQUAL(written.getLeft(), 64);
+  BOOST_CHECK_EQUAL(written.getTop(), 64);
+
+  reference.clear(0x10U);
+  reference.setPixel(150, 100, 0x1234U);
+  referenceRenderer.fillSpan2D(130, 190, 70, 0xffU);
+  referenceRenderer.drawLine2D({70, 140}, {120, 140}, Color(0xff00U));
+  BOOST_CHECK_EQUAL(countDifferences(target, reference), 0);
+
+  //nothing drawn and nothing stale
+  target.setPixel(150, 100, 0x10U);
+  tiles.beginFrame(0x10U);
+  tiles.endFrame(changed);
+  tiles.beginFrame(0x10U);
+  BOOST_CHECK(!tiles.endFrame(changed));
+  BOOST_CHECK(!tiles.getWrittenRect(written));
+
+  //a new clear color refills every tile
+  tiles.beginFrame(0x20U);
+  BOOST_CHECK(tiles.endFrame(changed));
+  reference.clear(0x20U);
+  BOOST_CHECK_EQUAL(countDifferences(target, reference), 0);
+}
+
+BOOST_AUTO_TEST_CASE(FrameTiles_binned_unittest) {
+  const int w = 300, h = 200;
+  OffscreenRendererBuffer target(w, h), reference(w, h);
+  FrameTiles tiles(target);
+  BinnedRenderer binned(target, 4);
+  binned.setFrameTiles(&tiles);
+
+  target.clear(0xdeadbeefU);
+  for (int frame = 0; frame < 3; ++frame) {
+    tiles.beginFrame(0U);
+    reference.clear(0U);
+    Renderer referenceRenderer(reference);
+    for (int n = 0; n < 20; ++n) {
+      const double x = (n * 37 + frame * 101) % w, y = (n * 53 + frame * 29) % h;
+      const Point3<double> p0(x, y, 0.5), p1(x + 40., y + 10., 0.5), p2(x + 5., y + 35., 0.5);
+      binned.fillTriangle3D_Depth(p0, p1, p2, Color(uint32_t(n + 1)));
+      referenceRenderer.fillTriangle3D_Depth(p0, p1, p2, Color(uint32_t(n + 1)));
+    }
+    binned.flush();
+
+    RectI changed;
+    BOOST_CHECK(tiles.endFrame(changed));
+    BOOST_CHECK_EQUAL(countDifferences(target, reference), 0);
+  }
+}
@@ -0,0 +1,140 @@
+#include "../MatrixSimd.h"
+#include "../math/Math.h"
+#include "../Object.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using namespace s3d;
+
+namespace
+{
+
+template<typename M>
+M randomMatrix() {
+  M m;
+  for (unsigned int r = 0; r < 4; ++r) {
+    for (unsigned int c = 0; c < 4; ++c) {
+      m[r][c] = typename M::value_type(rand() % 2001 - 1000) / 64;
+    }
+  }
+  return m;
+}
+
+//the generic triple loop, which the kernels must match bit for bit
+template<typename T>
+Matrix<T, 4U, 4U> multiplyReference(const Matrix<T, 4U, 4U>& a, const Matrix<T, 4U, 4U>& b) {
+  Matrix<T, 4U, 4U> rm;
+  for (unsigned int r = 0; r < 4; ++r) {
+    for (unsigned int c = 0; c < 4; ++c) {
+      rm[r][c] = a[r][0] * b[0][c] + a[r][1] * b[1][c] + a[r][2] * b[2][c] + a[r][3] * b[3][c];
+    }
+  }
+  return rm;
+}
+
+template<typename T>
+void checkKernels() {
+  typedef Matrix<T, 4U, 4U> M;
+  const M a = randomMatrix<M>(), b = randomMatrix<M>();
+  const M expected = multiplyReference(a, b);
+  const M product = a * b;
+  BOOST_CHECK(memcmp(&product, &expected, sizeof(M)) == 0);
+
+  M concat = a;
+  concat *= b;
+  BOOST_CHECK(memcmp(&concat, &expected, sizeof(M)) == 0);
+
+  Point4<T> pt(T(1.5), T(-2.25), T(3));
+  pt.w_ = T(0.75);
+  Point4<T> rowVector;
+  for (unsigned int c = 0; c < 4; ++c) {
+    const T* v = &pt.x_;
+    (&rowVector.x_)[c] = v[0] * b[0][c] + v[1] * b[1][c] + v[2] * b[2][c] + v[3] * b[3][c];
+  }
+
+  const Point4<T> homogeneous = transformHomogeneous(pt, b);
+  BOOST_CHECK(memcmp(&homogeneous, &rowVector, sizeof(pt)) == 0);
+
+  const Point4<T> projected = pt * b;
+  BOOST_CHECK_EQUAL(projected.x_, rowVector.x_ / rowVector.w_);
+  BOOST_CHECK_EQUAL(projected.y_, rowVector.y_ / rowVector.w_);
+  BOOST_CHECK_EQUAL(projected.z_, rowVector.z_ / rowVector.w_);
+  BOOST_CHECK_EQUAL(projected.w_, T(1));
+}
+
+//odd count so every width runs its scalar tail
+template<typename T>
+void checkVertexKernels() {
+  typedef Matrix<T, 4U, 4U> M;
+  M m = randomMatrix<M>();
+  m[0][3] = T(0.125);
+  m[3][3] = T(40);
+
+  const int count = 131;
+  std::vector<T> x(count), y(count), z(count);
+  std::vector<Point4<T>> points(count);
+  for (int i = 0; i < count; ++i) {
+    x[i] = points[i].x_ = T(rand() % 2001 - 1000) / 8;
+    y[i] = points[i].y_ = T(rand() % 2001 - 1000) / 8;
+    z[i] = points[i].z_ = T(rand() % 2001 - 1000) / 8;
+  }
+
+  std::vector<T> outX(count), outY(count), outZ(count), outW(count);
+  transformVertices(m, x.data(), y.data(), z.data(), outX.data(), outY.data(), outZ.data(), outW.data(), count, false);
+  std::vector<Point4<T>> transformed(count);
+  transformVertices(m, points.data(), transformed.data(), count, false);
+  for (int i = 0; i < count; ++i) {
+    const Point4<T> expected = transformHomogeneous(points[i], m);
+    BOOST_CHECK(outX[i] == expected.x_ && outY[i] == expected.y_ && outZ[i] == expected.z_ && outW[i] == expected.w_);
+    BOOST_CHECK(memcmp(&transformed[i], &expected, sizeof(expected)) == 0);
+  }
+
+  //divided in place, outW not needed
+  transformVertices(m, x.data(), y.data(), z.data(), x.data(), y.data(), z.data(), nullptr, count, true);
+  transformVertices(m, points.data(), points.data(), count, true);
+  for (int i = 0; i < count; ++i) {
+    BOOST_CHECK_EQUAL(x[i], outX[i] / outW[i]);
+    BOOST_CHECK_EQUAL(y[i], outY[i] / outW[i]);
+    BOOST_CHECK_EQUAL(z[i], outZ[i] / outW[i]);
+    BOOST_CHECK(points[i].x_ == x[i] && points[i].y_ == y[i] && points[i].z_ == z[i] && points[i].w_ == T(1));
+  }
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(MatrixSimd_unittest) {
+  //the inline 4x4 products, then the batch kernels of every level against them
+  srand(5);
+  checkKernels<float>();
+  checkKernels<double>();
+  const SimdLevel levels[] = {kSimdNone, kSimdSSE2, kSimdAVX2};
+  for (SimdLevel level : levels) {
+    selectMatrixSimd(level);
+    srand(5);
+    checkVertexKernels<float>();
+    checkVertexKernels<double>();
+  }
+  selectMatrixSimd(kSimdAVX2);
+}
+
+BOOST_AUTO_TEST_CASE(MatrixSimd_addToWorld) {
+  //rotating the local vertices and then moving them gives the same bits as the fused pass
+  const Matrix4x4FD rotate = buildRotateMatrix4x4(0.3, 1.1, -0.7);
+  ObjectFD fused(0, "fused"), separate(1, "separate");
+  srand(9);
+  for (int i = 0; i < 37; ++i) {
+    const Point4FD pt(rand() % 201 - 100, rand() % 201 - 100, rand() % 201 - 100);
+    fused.addVertex(pt);
+    separate.addVertex(pt * rotate);
+  }
+
+  addToWorld(fused, rotate, 1.5, -2, 30);
+  addToWorld(separate, 1.5, -2, 30);
+  BOOST_CHECK_EQUAL(fused.transVertexList_.size(), separate.transVertexList_.size());
+  BOOST_CHECK(memcmp(fused.transVertexList_.data(), separate.transVertexList_.data(), 37 * sizeof(Point4FD)) == 0);
+  BOOST_CHECK_EQUAL(fused.worldPosition_.z_, 30);
+}
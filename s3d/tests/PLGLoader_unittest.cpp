@@ -0,0 +1,53 @@
+#include "../PLGLoader.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstdio>
+#include <fstream>
+
+using namespace s3d;
+
+namespace
+{
+
+const char* const kTestFile = "PLGLoader_unittest.plg";
+
+void writeTriangle(const char* polygonLine) {
+  std::ofstream out(kTestFile);
+  out << "# test triangle\n"
+      << "tri 3 1\n"
+      << "0 0 0\n"
+      << "1 0 0\n"
+      << "0 1 0\n"
+      << polygonLine << "\n";
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(PLGLoader_polygonIndices_unittest) {
+  PLGLoader loader;
+  std::string name;
+  VertexList<Point4<double>> vlist;
+  std::vector<Polygon<kMaxPolygonVertices>> polys;
+
+  writeTriangle("0xd0f0 3 0 1 2");
+  loader.parse(kTestFile, name, vlist, polys, 1.f);
+  BOOST_CHECK_EQUAL(name, "tri");
+  BOOST_CHECK_EQUAL(vlist.size(), 3U);
+  BOOST_REQUIRE_EQUAL(polys.size(), 1U);
+  BOOST_CHECK_EQUAL(polys[0].at(2), 2U);
+
+  //index past the vertex list
+  writeTriangle("0xd0f0 3 0 1 3");
+  vlist.clear();
+  polys.clear();
+  BOOST_CHECK_THROW(loader.parse(kTestFile, name, vlist, polys, 1.f), PLGLoaderException);
+
+  //fewer indices than the vertex count says
+  writeTriangle("0xd0f0 3 0 1");
+  vlist.clear();
+  polys.clear();
+  BOOST_CHECK_THROW(loader.parse(kTestFile, name, vlist, polys, 1.f), PLGLoaderException);
+
+  std::remove(kTestFile);
+}
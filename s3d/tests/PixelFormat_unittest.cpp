@@ -0,0 +1,150 @@
+#include "../PixelFormat.h"
+#include "../OffscreenBuffer.h"
+#include "../AlignedMemory.h"
+#include "../DepthBuffer.h"
+#include "../BinnedRenderer.h"
+
+#include <boost/test/unit_test.hpp>
+
+using namespace s3d;
+
+BOOST_AUTO_TEST_CASE(PixelFormat_convert_unittest) {
+  BOOST_CHECK_EQUAL(packRGB565(0xffffffffU), 0xffffU);
+  BOOST_CHECK_EQUAL(packRGB565(0x00ff0000U), 0xf800U);
+  BOOST_CHECK_EQUAL(packRGB565(0x0000ff00U), 0x07e0U);
+  BOOST_CHECK_EQUAL(packRGB565(0x000000ffU), 0x001fU);
+  BOOST_CHECK_EQUAL(unpackRGB565(0xffffU), 0xffffffU);
+  BOOST_CHECK_EQUAL(unpackRGB565(0x0000U), 0U);
+
+  //every level gives the scalar result, odd counts run the tails
+  uint32_t src[37];
+  for (int i = 0; i < 37; ++i) {
+    src[i] = 0x9e3779b9U * (i + 1);
+  }
+  const SimdLevel levels[] = {kSimdNone, kSimdSSE2, kSimdAVX2};
+  for (SimdLevel level : levels) {
+    selectPixelConvert(level);
+    uint16_t dst[37];
+    g_convertRowRGB565(dst, src, 37);
+    for (int i = 0; i < 37; ++i) {
+      BOOST_CHECK_EQUAL(dst[i], packRGB565(src[i]));
+    }
+  }
+  selectPixelConvert(kSimdAVX2);
+
+  //the default palette is a 3-3-2 cube, its own entries map back to themselves
+  Palette palette;
+  BOOST_CHECK_EQUAL(palette.getEntry(0), 0U);
+  BOOST_CHECK_EQUAL(palette.getEntry(255), 0xffffffU);
+  for (int i = 0; i < 256; ++i) {
+    BOOST_CHECK_EQUAL(palette.findNearest(palette.getEntry(i)), i);
+  }
+
+  palette.setEntry(7, 0x123456U);
+  BOOST_CHECK_EQUAL(palette.findNearest(0x133557U), 7);
+}
+
+BOOST_AUTO_TEST_CASE(PixelBuffer_unittest) {
+  const int w = 70, h = 9;
+  OffscreenRendererBuffer frame(w, h);
+  Renderer renderer(frame);
+  frame.clear(0x000000ffU);
+  renderer.fillTriangle2D_SubPixel(Point2<double>(0., 0.), Point2<double>(60., 0.), Point2<double>(0., 8.), Color(0xffff00U));
+
+  const PixelFormat formats[] = {kPixelFormatARGB8888, kPixelFormatRGB565, kPixelFormatIndexed8};
+  for (PixelFormat format : formats) {
+    PixelBuffer buffer(w, h, format);
+    BOOST_CHECK_EQUAL(buffer.getPitch() % kSurfaceAlignment, 0);
+    BOOST_CHECK_GE(buffer.getPitch(), w * getBytesPerPixel(format));
+
+    //yellow and blue are exact in all three formats
+    buffer.present(frame);
+    for (int y = 0; y < h; ++y) {
+      for (int x = 0; x < w; ++x) {
+        BOOST_CHECK_EQUAL(buffer.getPixel(x, y), frame.getPixel(x, y));
+      }
+    }
+
+    //only the rect is converted
+    frame.fillRect(RectI(10, 2, 3, 3), 0xff0000U);
+    buffer.present(frame, RectI(10, 2, 1, 1));
+    BOOST_CHECK_EQUAL(buffer.getPixel(11, 3), 0xff0000U);
+    BOOST_CHECK_EQUAL(buffer.getPixel(12, 3), 0xffff00U);
+    frame.fillRect(RectI(10, 2, 3, 3), 0xffff00U);
+
+    //native fills clip like RendererBuffer's
+    buffer.fillRect(RectI(-5, 7, 10, 10), 0xffffffU);
+    BOOST_CHECK_EQUAL(buffer.getPixel(0, 8), 0xffffffU);
+    BOOST_CHECK_EQUAL(buffer.getPixel(5, 8), 0xffffffU);
+    BOOST_CHECK_EQUAL(buffer.getPixel(6, 8), 0x0000ffU);
+    buffer.setPixel(w - 1, 0, 0x00ff00U);
+    BOOST_CHECK_EQUAL(buffer.getPixel(w - 1, 0), 0x00ff00U);
+  }
+}
+
+namespace
+{
+
+template<typename TargetRenderer>
+void drawFlatScene(TargetRenderer& renderer) {
+  renderer.fillTriangle3D_Depth(Point3<double>(2., 3., 0.4), Point3<double>(80., 10., 0.4), Point3<double>(30., 60., 0.4), Color(200, 30, 90));
+  renderer.fillTriangle3D_Depth(Point3<double>(10., 50., 0.6), Point3<double>(70., 5., 0.2), Point3<double>(85., 65., 0.5), Color(20, 180, 240));
+  const Point3<double> quad[4] = {{40., 20., 0.7}, {75., 25., 0.7}, {70., 55., 0.3}, {35., 50., 0.3}};
+  renderer.fillConvexPolygon3D_Depth(quad, 4, Color(250, 250, 10));
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(Renderer_pixelTarget_unittest) {
+  //flat fills straight into each format give the 32-bit frame presented into it
+  const int w = 90, h = 70;
+  const PixelFormat formats[] = {kPixelFormatARGB8888, kPixelFormatRGB565, kPixelFormatIndexed8};
+  for (PixelFormat format : formats) {
+    OffscreenRendererBuffer frame(w, h), unused(w, h);
+    frame.clear(0);
+    unused.clear(0x123456U);
+    DepthBuffer frameDepth(w, h, kDepth32), nativeDepth(w, h, kDepth32), binnedDepth(w, h, kDepth32);
+    frameDepth.clear();
+    nativeDepth.clear();
+    binnedDepth.clear();
+
+    Renderer reference(frame);
+    reference.setDepthBuffer(&frameDepth);
+    drawFlatScene(reference);
+    reference.setDepthBuffer(NULL);
+    reference.fillSpan2D(3, 86, 66, Color(0, 255, 0).getABGRValue());
+    PixelBuffer expected(w, h, format);
+    expected.present(frame);
+
+    PixelBuffer native(w, h, format);
+    Renderer renderer(unused);
+    renderer.setDepthBuffer(&nativeDepth);
+    renderer.setPixelTarget(&native);
+    drawFlatScene(renderer);
+    renderer.setDepthBuffer(NULL);
+    renderer.fillSpan2D(3, 86, 66, Color(0, 255, 0).getABGRValue());
+
+    PixelBuffer binnedTarget(w, h, format);
+    BinnedRenderer binned(unused, 3);
+    binned.setDepthBuffer(&binnedDepth);
+    binned.setPixelTarget(&binnedTarget);
+    drawFlatScene(binned);
+    binned.flush();
+    Renderer spans(unused);
+    spans.setPixelTarget(&binnedTarget);
+    spans.fillSpan2D(3, 86, 66, Color(0, 255, 0).getABGRValue());
+
+    int mismatches = 0, binnedMismatches = 0, written = 0;
+    for (int y = 0; y < h; ++y) {
+      for (int x = 0; x < w; ++x) {
+        mismatches += native.getPixel(x, y) != expected.getPixel(x, y);
+        binnedMismatches += binnedTarget.getPixel(x, y) != expected.getPixel(x, y);
+        written += unused.getPixel(x, y) != 0x123456U;
+      }
+    }
+    BOOST_CHECK_EQUAL(mismatches, 0);
+    BOOST_CHECK_EQUAL(binnedMismatches, 0);
+    BOOST_CHECK_EQUAL(written, 0);
+    BOOST_CHECK(expected.getPixel(45, 66) != 0U);
+  }
+}
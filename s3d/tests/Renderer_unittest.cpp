@@ -0,0 +1,967 @@
+#include "../OffscreenBuffer.h"
+#include "../Renderer.h"
+#include "../AlignedMemory.h"
+#include "../Rasterizer.h"
+#include "../DepthBuffer.h"
+#include "../Texture.h"
+#include "../Multisample.h"
+#include "../math/MathBase.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cmath>
+#include <vector>
+
+using namespace s3d;
+
+namespace
+{
+
+int countPixels(const RendererBuffer& buffer, uint32_t p) {
+  int count = 0;
+  for (int y = 0; y < buffer.getHeight(); ++y) {
+    for (int x = 0; x < buffer.getWidth(); ++x) {
+      if (buffer.getPixel(x, y) == p)
+        ++count;
+    }
+  }
+  return count;
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(OffscreenRendererBuffer_unittest) {
+  OffscreenRendererBuffer target(37, 21);
+  BOOST_CHECK_EQUAL(target.getWidth(), 37);
+  BOOST_CHECK_EQUAL(target.getHeight(), 21);
+  BOOST_CHECK(target.getPitch() >= target.getWidth());
+  BOOST_CHECK_EQUAL((target.getPitch() * sizeof(uint32_t)) % kSurfaceAlignment, 0U);
+
+  for (int y = 0; y < target.getHeight(); ++y) {
+    BOOST_CHECK_EQUAL(reinterpret_cast<uintptr_t>(target.getRow(y)) % kSurfaceAlignment, 0U);
+  }
+
+  BOOST_CHECK_EQUAL(countPixels(target, 0), 37 * 21);
+
+  target.clear(0xff00ff00);
+  BOOST_CHECK_EQUAL(countPixels(target, 0xff00ff00), 37 * 21);
+}
+
+BOOST_AUTO_TEST_CASE(Renderer_offscreen_unittest) {
+  OffscreenRendererBuffer target(64, 64);
+  Renderer renderer(target);
+  const Color c(255, 0, 0);
+
+  renderer.fillTriangle2D({10, 10}, {50, 10}, {10, 50}, c);
+  BOOST_CHECK_EQUAL(target.getPixel(12, 12), c.getABGRValue());
+  BOOST_CHECK_EQUAL(target.getPixel(60, 60), 0U);
+  BOOST_CHECK(countPixels(target, c.getABGRValue()) > 0);
+
+  //partly off screen, must be clipped
+  renderer.fillTriangle2D({-40, -40}, {100, 30}, {30, 100}, c);
+  BOOST_CHECK_EQUAL(target.getPixel(0, 0), c.getABGRValue());
+}
+
+namespace
+{
+
+//reference coverage of 28.4 vertices, pixel (x, y) sampled at (x, y).
+//pixels exactly on an edge belong to top and left edges only.
+bool isCoveredReference(Point2<int> p0, Point2<int> p1, Point2<int> p2, int x, int y) {
+  const int64_t area = int64_t(p1.x_ - p0.x_) * (p2.y_ - p0.y_) - int64_t(p1.y_ - p0.y_) * (p2.x_ - p0.x_);
+  if (area == 0)
+    return false;
+  if (area < 0)
+    std::swap(p1, p2);
+
+  const int sx = x * kSubPixelScale;
+  const int sy = y * kSubPixelScale;
+  const Point2<int> v[3] = {p0, p1, p2};
+  for (int i = 0; i < 3; ++i) {
+    const Point2<int>& a = v[i];
+    const Point2<int>& b = v[(i + 1) % 3];
+    const int64_t e = int64_t(b.x_ - a.x_) * (sy - a.y_) - int64_t(b.y_ - a.y_) * (sx - a.x_);
+    const bool topLeft = (a.y_ - b.y_) > 0 || ((a.y_ - b.y_) == 0 && (b.x_ - a.x_) > 0);
+    if (e < 0 || (e == 0 && !topLeft))
+      return false;
+  }
+  return true;
+}
+
+int countMismatches(const RendererBuffer& buffer, uint32_t c,
+                    const Point2<int>& f0, const Point2<int>& f1, const Point2<int>& f2) {
+  int mismatches = 0;
+  for (int y = 0; y < buffer.getHeight(); ++y) {
+    for (int x = 0; x < buffer.getWidth(); ++x) {
+      const bool covered = buffer.getPixel(x, y) == c;
+      if (covered != isCoveredReference(f0, f1, f2, x, y))
+        ++mismatches;
+    }
+  }
+  return mismatches;
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(Renderer_halfspace_unittest) {
+  OffscreenRendererBuffer target(83, 61);
+  Renderer renderer(target);
+  const uint32_t c = 0x00ff0000;
+
+  srand(7);
+  for (int n = 0; n < 200; ++n) {
+    const Point2<int> p0(rand() % 140 - 30, rand() % 120 - 30);
+    const Point2<int> p1(rand() % 140 - 30, rand() % 120 - 30);
+    const Point2<int> p2(rand() % 140 - 30, rand() % 120 - 30);
+
+    target.clear(0);
+    renderer.fillTriangle2D_HalfSpace(p0, p1, p2, Color(c));
+    BOOST_CHECK_EQUAL(countMismatches(target, c, toFixed28_4(p0), toFixed28_4(p1), toFixed28_4(p2)), 0);
+  }
+
+  for (int n = 0; n < 200; ++n) {
+    const Point2<double> p0(rand() % 14000 / 100. - 30, rand() % 12000 / 100. - 30);
+    const Point2<double> p1(rand() % 14000 / 100. - 30, rand() % 12000 / 100. - 30);
+    const Point2<double> p2(rand() % 14000 / 100. - 30, rand() % 12000 / 100. - 30);
+
+    target.clear(0);
+    renderer.fillTriangle2D_SubPixel(p0, p1, p2, Color(c));
+    BOOST_CHECK_EQUAL(countMismatches(target, c, toFixed28_4(p0), toFixed28_4(p1), toFixed28_4(p2)), 0);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(Renderer_topleft_unittest) {
+  //a fan around a sub-pixel center: every pixel inside is owned by exactly one triangle
+  OffscreenRendererBuffer target(64, 64);
+  Renderer renderer(target);
+  std::vector<int> coverage(64 * 64, 0);
+
+  const Point2<double> center(31.3, 30.7);
+  const int kSegments = 13;
+  for (int i = 0; i < kSegments; ++i) {
+    const double a0 = kPI_MUL_2 * i / kSegments;
+    const double a1 = kPI_MUL_2 * (i + 1) / kSegments;
+    const Point2<double> v0(center.x_ + 25 * cos(a0), center.y_ + 25 * sin(a0));
+    const Point2<double> v1(center.x_ + 25 * cos(a1), center.y_ + 25 * sin(a1));
+
+    target.clear(0);
+    renderer.fillTriangle2D_SubPixel(center, v0, v1, Color(1U));
+    for (int y = 0; y < 64; ++y) {
+      for (int x = 0; x < 64; ++x) {
+        coverage[y * 64 + x] += target.getPixel(x, y);
+      }
+    }
+  }
+
+  int overdraw = 0, holes = 0;
+  for (int y = 0; y < 64; ++y) {
+    for (int x = 0; x < 64; ++x) {
+      const double dx = x - center.x_, dy = y - center.y_;
+      if (coverage[y * 64 + x] > 1)
+        ++overdraw;
+      if (dx * dx + dy * dy < 23 * 23 && coverage[y * 64 + x] == 0)
+        ++holes;
+    }
+  }
+  BOOST_CHECK_EQUAL(overdraw, 0);
+  BOOST_CHECK_EQUAL(holes, 0);
+}
+
+BOOST_AUTO_TEST_CASE(RendererBuffer_fillSpan_unittest) {
+  OffscreenRendererBuffer target(77, 9);
+  const SimdLevel levels[] = {kSimdNone, kSimdSSE2, kSimdAVX2};
+  for (auto level : levels) {
+    selectSpanFill(level);
+    for (int x0 = -3; x0 < 40; x0 += 3) {
+      for (int count = 0; count < 45; ++count) {
+        target.clear(0);
+        const int x1 = x0 + count - 1;
+        target.fillSpan(x0, x1, 4, 0x12345678);
+
+        int mismatches = 0;
+        for (int y = 0; y < target.getHeight(); ++y) {
+          for (int x = 0; x < target.getWidth(); ++x) {
+            const bool expected = y == 4 && x >= x0 && x <= x1;
+            if ((target.getPixel(x, y) == 0x12345678) != expected)
+              ++mismatches;
+          }
+        }
+        BOOST_CHECK_EQUAL(mismatches, 0);
+      }
+    }
+  }
+  selectSpanFill(detectSimdLevel());
+
+  target.clear(0);
+  target.fillRect(RectI(70, -2, 20, 4), 0xff);
+  BOOST_CHECK_EQUAL(countPixels(target, 0xff), 7 * 3);
+}
+
+BOOST_AUTO_TEST_CASE(DepthBuffer_unittest) {
+  DepthBuffer depth16(37, 21, kDepth16);
+  BOOST_CHECK_EQUAL(depth16.getTileColumns(), 5);
+  BOOST_CHECK_EQUAL(depth16.getTileRows(), 3);
+  BOOST_CHECK_EQUAL(depth16.getDepth(36, 20), 0U);
+  BOOST_CHECK_EQUAL(DepthBuffer::encode(kDepth16, 1.f), 65535U);
+  BOOST_CHECK_EQUAL(DepthBuffer::encode(kDepth16, 2.f), 65535U);
+  BOOST_CHECK_EQUAL(DepthBuffer::encode(kDepth16, -1.f), 0U);
+
+  //float bits keep the order of the values
+  BOOST_CHECK(DepthBuffer::encode(kDepth32, 0.25f) < DepthBuffer::encode(kDepth32, 0.5f));
+  BOOST_CHECK_EQUAL(DepthBuffer::encode(kDepth32, 0.f), 0U);
+
+  //only the selected pixels that are closer get written
+  DepthBuffer depth32(37, 21, kDepth32);
+  BOOST_CHECK_EQUAL(depth32.testAndWriteRow(8, 3, 0x0F, 0.5f, 0.f, 0.5f, 0.5f, true), 0x0FU);
+  BOOST_CHECK_EQUAL(depth32.testAndWriteRow(8, 3, 0xFF, 0.5f, 0.f, 0.5f, 0.5f, true), 0xF0U);
+  BOOST_CHECK_EQUAL(depth32.testAndWriteRow(8, 3, 0xFF, 0.25f, 0.f, 0.25f, 0.25f, true), 0U);
+  BOOST_CHECK_EQUAL(depth32.getDepth(11, 3), DepthBuffer::encode(kDepth32, 0.5f));
+  BOOST_CHECK_EQUAL(depth32.getDepth(16, 3), 0U);
+
+  depth32.clear();
+  BOOST_CHECK_EQUAL(depth32.getDepth(11, 3), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(Renderer_depth_unittest) {
+  //each pixel shows the nearest triangle covering it, in any draw order
+  const DepthFormat formats[] = {kDepth16, kDepth32};
+  for (DepthFormat format : formats) {
+    OffscreenRendererBuffer target(71, 53);
+    DepthBuffer depth(71, 53, format);
+    Renderer renderer(target);
+    renderer.setDepthBuffer(&depth);
+
+    srand(11);
+    const int kTriangles = 40;
+    std::vector<Point3<double>> vertices;
+    for (int n = 0; n < kTriangles * 3; ++n) {
+      vertices.push_back(Point3<double>(rand() % 9000 / 100. - 10, rand() % 7000 / 100. - 10, 0.));
+    }
+    for (int n = 0; n < kTriangles; ++n) {
+      const double q = (n + 1) / double(kTriangles + 1);
+      vertices[n * 3].z_ = vertices[n * 3 + 1].z_ = vertices[n * 3 + 2].z_ = q;
+    }
+
+    std::vector<uint32_t> forward;
+    for (int order = 0; order < 2; ++order) {
+      target.clear(0);
+      depth.clear();
+      for (int i = 0; i < kTriangles; ++i) {
+        const int n = order == 0 ? i : kTriangles - 1 - i;
+        renderer.fillTriangle3D_Depth(vertices[n * 3], vertices[n * 3 + 1], vertices[n * 3 + 2], Color(uint32_t(n + 1)));
+      }
+
+      int mismatches = 0;
+      for (int y = 0; y < 53; ++y) {
+        for (int x = 0; x < 71; ++x) {
+          uint32_t expected = 0;
+          for (int n = kTriangles - 1; n >= 0 && !expected; --n) {
+            const Point2<int> f0 = toFixed28_4(Point2<double>(vertices[n * 3].x_, vertices[n * 3].y_));
+            const Point2<int> f1 = toFixed28_4(Point2<double>(vertices[n * 3 + 1].x_, vertices[n * 3 + 1].y_));
+            const Point2<int> f2 = toFixed28_4(Point2<double>(vertices[n * 3 + 2].x_, vertices[n * 3 + 2].y_));
+            if (isCoveredReference(f0, f1, f2, x, y))
+              expected = n + 1;
+          }
+          if (target.getPixel(x, y) != expected)
+            ++mismatches;
+        }
+      }
+      BOOST_CHECK_EQUAL(mismatches, 0);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(Renderer_depth_reject_unittest) {
+  OffscreenRendererBuffer target(64, 64);
+  DepthBuffer depth(64, 64, kDepth16);
+  Renderer renderer(target);
+  renderer.setDepthBuffer(&depth);
+
+  //a near quad fills whole tiles, raising their minimum
+  renderer.fillTriangle3D_Depth({-1, -1, 0.9}, {70, -1, 0.9}, {-1, 70, 0.9}, Color(1U));
+  renderer.fillTriangle3D_Depth({70, -1, 0.9}, {70, 70, 0.9}, {-1, 70, 0.9}, Color(1U));
+  BOOST_CHECK_EQUAL(depth.getTileMin(3, 3), DepthBuffer::encode(kDepth16, 0.9f));
+  BOOST_CHECK_EQUAL(countPixels(target, 1), 64 * 64);
+
+  //a sloped triangle behind it is hidden, one poking through shows up
+  renderer.fillTriangle3D_Depth({3.5, 2, 0.2}, {60, 10, 0.8}, {20, 61, 0.5}, Color(2U));
+  BOOST_CHECK_EQUAL(countPixels(target, 2), 0);
+  renderer.fillTriangle3D_Depth({3.5, 2, 0.2}, {60, 10, 1.0}, {20, 61, 0.5}, Color(2U));
+  BOOST_CHECK(countPixels(target, 2) > 0);
+  BOOST_CHECK_EQUAL(target.getPixel(4, 3), 1U);
+
+  //without a depth buffer the triangle is simply drawn
+  renderer.setDepthBuffer(NULL);
+  renderer.fillTriangle3D_Depth({0, 0, 0.}, {63, 0, 0.}, {0, 63, 0.}, Color(3U));
+  BOOST_CHECK_EQUAL(target.getPixel(1, 1), 3U);
+}
+
+BOOST_AUTO_TEST_CASE(Renderer_indexed_unittest) {
+  //a jittered grid mesh sharing vertices, plus one triangle out of raster range
+  const int kGrid = 9;
+  std::vector<Point4<double>> vertices;
+  srand(13);
+  for (int j = 0; j < kGrid; ++j) {
+    for (int i = 0; i < kGrid; ++i) {
+      vertices.push_back(Point4<double>(i * 9.3 - 5 + rand() % 100 / 50., j * 7.1 - 3 + rand() % 100 / 50.,
+                                        rand() % 1000 / 1000.));
+    }
+  }
+  vertices.push_back(Point4<double>(kRasterMaxCoord * 2., 20., 0.5));
+
+  std::vector<uint32_t> indices;
+  std::vector<Color> colors;
+  for (int j = 0; j + 1 < kGrid; ++j) {
+    for (int i = 0; i + 1 < kGrid; ++i) {
+      const uint32_t v = j * kGrid + i;
+      const uint32_t quad[] = {v, v + 1, v + kGrid, v + 1, v + kGrid + 1, v + kGrid};
+      indices.insert(indices.end(), quad, quad + 6);
+      colors.push_back(Color(uint32_t(colors.size() + 1)));
+      colors.push_back(Color(uint32_t(colors.size() + 1)));
+    }
+  }
+  const uint32_t far[] = {0, static_cast<uint32_t>(vertices.size() - 1), kGrid * 3};
+  indices.insert(indices.end(), far, far + 3);
+  colors.push_back(Color(0xffU));
+
+  for (int withDepth = 0; withDepth < 2; ++withDepth) {
+    OffscreenRendererBuffer single(67, 53), batched(67, 53);
+    DepthBuffer singleDepth(67, 53, kDepth16), batchedDepth(67, 53, kDepth16);
+    Renderer singleRenderer(single), batchedRenderer(batched);
+    if (withDepth) {
+      singleRenderer.setDepthBuffer(&singleDepth);
+      batchedRenderer.setDepthBuffer(&batchedDepth);
+    }
+
+    for (size_t t = 0; t < colors.size(); ++t) {
+      const Point4<double>& v0 = vertices[indices[t * 3]];
+      const Point4<double>& v1 = vertices[indices[t * 3 + 1]];
+      const Point4<double>& v2 = vertices[indices[t * 3 + 2]];
+      singleRenderer.fillTriangle3D_Depth(Point3<double>(v0.x_, v0.y_, v0.z_), Point3<double>(v1.x_, v1.y_, v1.z_),
+                                          Point3<double>(v2.x_, v2.y_, v2.z_), colors[t]);
+    }
+    batchedRenderer.drawIndexedTriangles(vertices.data(), static_cast<int>(vertices.size()),
+                                         indices.data(), static_cast<int>(colors.size()), colors.data());
+
+    int mismatches = 0;
+    for (int y = 0; y < 53; ++y) {
+      for (int x = 0; x < 67; ++x) {
+        if (single.getPixel(x, y) != batched.getPixel(x, y))
+          ++mismatches;
+      }
+    }
+    BOOST_CHECK_EQUAL(mismatches, 0);
+    BOOST_CHECK(countPixels(batched, 0xffU) > 0);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(Renderer_gouraud_unittest) {
+  OffscreenRendererBuffer flat(61, 47), shaded(61, 47);
+  Renderer flatRenderer(flat), shadedRenderer(shaded);
+
+  //constant vertex colors match the flat fill exactly
+  srand(17);
+  for (int n = 0; n < 50; ++n) {
+    const Point3<double> p0(rand() % 8000 / 100. - 10, rand() % 6000 / 100. - 10, 0.);
+    const Point3<double> p1(rand() % 8000 / 100. - 10, rand() % 6000 / 100. - 10, 0.);
+    const Point3<double> p2(rand() % 8000 / 100. - 10, rand() % 6000 / 100. - 10, 0.);
+    const Color c(uint8_t(rand() % 256), uint8_t(rand() % 256), uint8_t(rand() % 256), uint8_t(rand() % 256));
+    flatRenderer.fillTriangle3D_Depth(p0, p1, p2, c);
+    shadedRenderer.fillTriangle3D_Gouraud(p0, p1, p2, c, c, c);
+  }
+  int differences = 0;
+  for (int y = 0; y < 47; ++y) {
+    for (int x = 0; x < 61; ++x) {
+      if (flat.getPixel(x, y) != shaded.getPixel(x, y))
+        ++differences;
+    }
+  }
+  BOOST_CHECK_EQUAL(differences, 0);
+
+  //a gradient stays within one step of the exact barycentric color
+  const Point3<double> p0(2.5, 1.25, 0.), p1(58.75, 10.5, 0.), p2(20.25, 45.5, 0.);
+  const Color c0(255, 0, 0, 255), c1(0, 255, 0, 128), c2(0, 0, 255, 0);
+  shaded.clear(0);
+  shadedRenderer.fillTriangle3D_Gouraud(p0, p1, p2, c0, c1, c2);
+
+  const double area = (p1.x_ - p0.x_) * (p2.y_ - p0.y_) - (p2.x_ - p0.x_) * (p1.y_ - p0.y_);
+  int covered = 0, wrong = 0;
+  for (int y = 0; y < 47; ++y) {
+    for (int x = 0; x < 61; ++x) {
+      const double w1 = ((x - p0.x_) * (p2.y_ - p0.y_) - (p2.x_ - p0.x_) * (y - p0.y_)) / area;
+      const double w2 = ((p1.x_ - p0.x_) * (y - p0.y_) - (x - p0.x_) * (p1.y_ - p0.y_)) / area;
+      const double w0 = 1. - w1 - w2;
+      if (w0 < 0.01 || w1 < 0.01 || w2 < 0.01)
+        continue;
+
+      ++covered;
+      const Color pixel(shaded.getPixel(x, y));
+      for (int c = 0; c < 4; ++c) {
+        const double expected = w0 * c0.getValue(c) + w1 * c1.getValue(c) + w2 * c2.getValue(c);
+        if (std::fabs(pixel.getValue(c) - expected) > 1.)
+          ++wrong;
+      }
+    }
+  }
+  BOOST_CHECK(covered > 500);
+  BOOST_CHECK_EQUAL(wrong, 0);
+}
+
+BOOST_AUTO_TEST_CASE(Rasterizer_toFixed16_16_unittest) {
+  BOOST_CHECK_EQUAL(toFixed16_16(1.5), 0x18000);
+  BOOST_CHECK_EQUAL(toFixed16_16(-1.5), -0x18000);
+  BOOST_CHECK_EQUAL(toFixed16_16(32767.), 32767 * 65536);
+
+  //past +-32767 it saturates instead of overflowing the cast
+  BOOST_CHECK_EQUAL(toFixed16_16(32768.), INT32_MAX);
+  BOOST_CHECK_EQUAL(toFixed16_16(1e12), INT32_MAX);
+  BOOST_CHECK_EQUAL(toFixed16_16(-32768.), INT32_MIN);
+  BOOST_CHECK_EQUAL(toFixed16_16(-1e12), INT32_MIN);
+
+  //saturated channels clamp like any other out of range color, the steps wrap
+  const int32_t start[4] = {toFixed16_16(1e12), toFixed16_16(-1e12), toFixed16_16(128.5), 0};
+  const int32_t step[4] = {0, 0, 0, toFixed16_16(1e12)};
+  uint32_t row[kRasterBlockSize] = {};
+  shadeMaskedRow(row, 5, 0x1f, start, step);
+  BOOST_CHECK_EQUAL(row[0], 0x008000ffU);
+  BOOST_CHECK_EQUAL(row[1], 0xff8000ffU);
+}
+
+BOOST_AUTO_TEST_CASE(Texture_unittest) {
+  BOOST_CHECK_THROW(Texture(48, 64), TextureException);
+  BOOST_CHECK_THROW(Texture(2, 2), TextureException);
+
+  Texture texture(32, 16);
+  std::vector<uint32_t> image(32 * 16);
+  for (int i = 0; i < 32 * 16; ++i) {
+    image[i] = i * 2654435761U;
+  }
+  texture.upload(image.data(), 32);
+
+  int wrong = 0;
+  for (int v = 0; v < 16; ++v) {
+    for (int u = 0; u < 32; ++u) {
+      if (texture.getTexel(u, v) != image[v * 32 + u] || texture.getTexel(u - 32, v + 16) != image[v * 32 + u])
+        ++wrong;
+    }
+  }
+  BOOST_CHECK_EQUAL(wrong, 0);
+
+  texture.setTexel(33, -1, 0x12345678U);
+  BOOST_CHECK_EQUAL(texture.getTexel(1, 15), 0x12345678U);
+}
+
+BOOST_AUTO_TEST_CASE(Renderer_textured_unittest) {
+  //every texel holds its own coordinates
+  Texture texture(64, 64);
+  for (int v = 0; v < 64; ++v) {
+    for (int u = 0; u < 64; ++u) {
+      texture.setTexel(u, v, uint32_t(u | (v << 8)));
+    }
+  }
+
+  OffscreenRendererBuffer buffer(71, 59);
+  Renderer renderer(buffer);
+  buffer.clear(0xffffffffU);
+
+  //depth varies 4:1, affine mapping would be off by many texels
+  const Point3<double> p0(3.5, 2.25, 1.), p1(68.75, 8.5, 0.25), p2(12.25, 56.5, 0.5);
+  const Point2<double> uv0(0., 0.), uv1(1., 0.25), uv2(0.125, 1.);
+  renderer.fillTriangle3D_Textured(p0, p1, p2, uv0, uv1, uv2, texture);
+
+  const double area = (p1.x_ - p0.x_) * (p2.y_ - p0.y_) - (p2.x_ - p0.x_) * (p1.y_ - p0.y_);
+  int covered = 0, wrong = 0, affineWrong = 0;
+  for (int y = 0; y < 59; ++y) {
+    for (int x = 0; x < 71; ++x) {
+      const double w1 = ((x - p0.x_) * (p2.y_ - p0.y_) - (p2.x_ - p0.x_) * (y - p0.y_)) / area;
+      const double w2 = ((p1.x_ - p0.x_) * (y - p0.y_) - (x - p0.x_) * (p1.y_ - p0.y_)) / area;
+      const double w0 = 1. - w1 - w2;
+      if (w0 < 0.01 || w1 < 0.01 || w2 < 0.01)
+        continue;
+
+      //exact per pixel divide
+      ++covered;
+      const double q = w0 * p0.z_ + w1 * p1.z_ + w2 * p2.z_;
+      const double u = (w0 * p0.z_ * uv0.x_ + w1 * p1.z_ * uv1.x_ + w2 * p2.z_ * uv2.x_) / q * 64.;
+      const double v = (w0 * p0.z_ * uv0.y_ + w1 * p1.z_ * uv1.y_ + w2 * p2.z_ * uv2.y_) / q * 64.;
+
+      //the 8 pixel steps between divides may round one texel further
+      const uint32_t texel = buffer.getPixel(x, y);
+      const int du = (int(texel & 0xff) - int(::floor(u))) & 63;
+      const int dv = (int((texel >> 8) & 0xff) - int(::floor(v))) & 63;
+      if ((du > 2 && du < 62) || (dv > 2 && dv < 62))
+        ++wrong;
+
+      const double affineU = (w0 * uv0.x_ + w1 * uv1.x_ + w2 * uv2.x_) * 64.;
+      const double affineV = (w0 * uv0.y_ + w1 * uv1.y_ + w2 * uv2.y_) * 64.;
+      if (std::fabs(affineU - u) > 2. || std::fabs(affineV - v) > 2.)
+        ++affineWrong;
+    }
+  }
+  BOOST_CHECK(covered > 1000);
+  BOOST_CHECK_EQUAL(wrong, 0);
+  BOOST_CHECK(affineWrong > covered / 2);
+}
+
+BOOST_AUTO_TEST_CASE(Renderer_indexedLines_unittest) {
+  OffscreenRendererBuffer single(83, 61), batched(83, 61);
+  Renderer singleRenderer(single), batchedRenderer(batched);
+  singleRenderer.setScissor(RectI(5, 3, 70, 50));
+  batchedRenderer.setScissor(RectI(5, 3, 70, 50));
+
+  //vertices inside and around the scissor, plus one far outside that no line uses,
+  //lines to such vertices are checked in Renderer_drawIndexedLinesFar_unittest
+  srand(23);
+  std::vector<Point4<double>> vertices;
+  for (int i = 0; i < 41; ++i) {
+    vertices.push_back(Point4<double>(rand() % 1500 / 10. - 35., rand() % 1100 / 10. - 25., 1.));
+  }
+  vertices.push_back(Point4<double>(1e9, 20., 1.));
+
+  std::vector<uint32_t> indices;
+  for (int l = 0; l < 120; ++l) {
+    const uint32_t i0 = rand() % (vertices.size() - 1), i1 = rand() % (vertices.size() - 1);
+    indices.push_back(i0);
+    indices.push_back(i1);
+    singleRenderer.drawLine2D({int(::floor(vertices[i0].x_ + 0.5)), int(::floor(vertices[i0].y_ + 0.5))},
+                              {int(::floor(vertices[i1].x_ + 0.5)), int(::floor(vertices[i1].y_ + 0.5))}, Color(uint32_t(l + 1)));
+  }
+  for (int l = 0; l < 120; ++l) {
+    batchedRenderer.drawIndexedLines(vertices.data(), static_cast<int>(vertices.size()), &indices[l * 2], 1, Color(uint32_t(l + 1)));
+  }
+
+  int mismatches = 0;
+  for (int y = 0; y < 61; ++y) {
+    for (int x = 0; x < 83; ++x) {
+      if (single.getPixel(x, y) != batched.getPixel(x, y))
+        ++mismatches;
+    }
+  }
+  BOOST_CHECK_EQUAL(mismatches, 0);
+  BOOST_CHECK(countPixels(batched, 0U) < 83 * 61);
+
+  //the whole list in one batch, against the per line reference in one color
+  single.clear(0);
+  batched.clear(0);
+  for (int l = 0; l < 120; ++l) {
+    const uint32_t i0 = indices[l * 2], i1 = indices[l * 2 + 1];
+    singleRenderer.drawLine2D({int(::floor(vertices[i0].x_ + 0.5)), int(::floor(vertices[i0].y_ + 0.5))},
+                              {int(::floor(vertices[i1].x_ + 0.5)), int(::floor(vertices[i1].y_ + 0.5))}, Color(0xffU));
+  }
+  batchedRenderer.drawIndexedLines(vertices.data(), static_cast<int>(vertices.size()), indices.data(), 120, Color(0xffU));
+  BOOST_CHECK_EQUAL(countPixels(single, 0xffU), countPixels(batched, 0xffU));
+  BOOST_CHECK_EQUAL(countPixels(batched, 0xffU) + countPixels(batched, 0U), 83 * 61);
+}
+
+BOOST_AUTO_TEST_CASE(Renderer_drawIndexedLinesFar_unittest) {
+  OffscreenRendererBuffer target(83, 61);
+  Renderer renderer(target);
+  renderer.setScissor(RectI(5, 3, 70, 50));
+
+  //too far out to round, the visible part is still drawn
+  const Point4<double> vertices[] = {{40., 30., 1.}, {1e12, 30., 1.}, {20., 10., 1.}, {20., -1e15, 1.},
+                                     {-1e9, 45., 1.}, {1e9, 45., 1.}, {1e9, -1e9, 1.}, {2e9, -5e8, 1.}};
+  const uint32_t indices[] = {0, 1, 2, 3, 4, 5, 6, 7};
+  renderer.drawIndexedLines(vertices, 8, indices, 4, Color(0xffU));
+
+  //the same as the lines ending on the scissor edges, the last one is off it
+  OffscreenRendererBuffer reference(83, 61);
+  Renderer referenceRenderer(reference);
+  referenceRenderer.setScissor(RectI(5, 3, 70, 50));
+  referenceRenderer.drawLine2D({40, 30}, {75, 30}, Color(0xffU));
+  referenceRenderer.drawLine2D({20, 10}, {20, 3}, Color(0xffU));
+  referenceRenderer.drawLine2D({5, 45}, {75, 45}, Color(0xffU));
+
+  int mismatches = 0;
+  for (int y = 0; y < 61; ++y) {
+    for (int x = 0; x < 83; ++x) {
+      if (target.getPixel(x, y) != reference.getPixel(x, y))
+        ++mismatches;
+    }
+  }
+  BOOST_CHECK_EQUAL(mismatches, 0);
+  BOOST_CHECK_EQUAL(target.getPixel(75, 30), 0xffU);
+  BOOST_CHECK_EQUAL(target.getPixel(5, 45), 0xffU);
+}
+
+BOOST_AUTO_TEST_CASE(Renderer_drawIndexedLinesHuge_unittest) {
+  //the scissor inside the buffer, anything drawn past it lands in the margin
+  OffscreenRendererBuffer target(700, 540);
+  Renderer renderer(target);
+  const RectI scissor(30, 30, 639, 479);
+  renderer.setScissor(scissor);
+
+  //the far end of a sloped line at 1e18, and lines between two such ends
+  const Point4<double> vertices[] = {{320., 240., 1.}, {1e18, 3e17, 1.}, {9.29e17, 8.02e17, 1.}, {1.72e17, 7.36e17, 1.},
+                                     {-1e18, -7e17, 1.}, {1.1e18, 8e17, 1.}, {-3e18, 2e18, 1.}, {5e17, -9e17, 1.}};
+  const uint32_t indices[] = {0, 1, 1, 0, 2, 0, 3, 0, 4, 5, 6, 7};
+
+  //(320, 240) to the right edge at x 669, y 240 + 0.3 * 349, from either end
+  OffscreenRendererBuffer reference(700, 540);
+  Renderer referenceRenderer(reference);
+  referenceRenderer.setScissor(scissor);
+  for (int reversed = 0; reversed < 2; ++reversed) {
+    target.clear(0);
+    reference.clear(0);
+    renderer.drawIndexedLines(vertices, 8, indices + reversed * 2, 1, Color(0xffU));
+    if (reversed)
+      referenceRenderer.drawLine2D({669, 345}, {320, 240}, Color(0xffU));
+    else
+      referenceRenderer.drawLine2D({320, 240}, {669, 345}, Color(0xffU));
+
+    int mismatches = 0;
+    for (int y = 0; y < target.getHeight(); ++y) {
+      for (int x = 0; x < target.getWidth(); ++x) {
+        if (target.getPixel(x, y) != reference.getPixel(x, y))
+          ++mismatches;
+      }
+    }
+    BOOST_CHECK_EQUAL(mismatches, 0);
+    BOOST_CHECK(countPixels(target, 0xffU) >= 349);
+  }
+
+  renderer.drawIndexedLines(vertices, 8, indices + 4, 4, Color(0xffU));
+  int outside = 0;
+  for (int y = 0; y < target.getHeight(); ++y) {
+    for (int x = 0; x < target.getWidth(); ++x) {
+      const bool inScissor = x >= scissor.getLeft() && x <= scissor.getRight() && y >= scissor.getTop() && y <= scissor.getBottom();
+      if (!inScissor && target.getPixel(x, y) != 0U)
+        ++outside;
+    }
+  }
+  BOOST_CHECK_EQUAL(outside, 0);
+}
+
+BOOST_AUTO_TEST_CASE(Blend_unittest) {
+  //per channel against the exact formula
+  srand(31);
+  int wrong = 0;
+  for (int n = 0; n < 2000; ++n) {
+    const uint32_t src = uint32_t(rand()) << 16 ^ uint32_t(rand()), dst = uint32_t(rand()) << 16 ^ uint32_t(rand());
+    const uint32_t a = src >> 24;
+    const uint32_t over = blendPixel(src, dst, kBlendSourceOver);
+    const uint32_t add = blendPixel(src, dst, kBlendAdditive);
+    const uint32_t mul = blendPixel(src, dst, kBlendMultiply);
+    for (int c = 0; c < 32; c += 8) {
+      const uint32_t s = (src >> c) & 0xff, d = (dst >> c) & 0xff;
+      const double sw = c == 24 ? 255. : a;
+      if (((over >> c) & 0xff) != uint32_t(::floor((s * sw + d * (255. - a)) / 255. + 0.5)) ||
+          ((add >> c) & 0xff) != std::min(s + d, 255U) ||
+          ((mul >> c) & 0xff) != uint32_t(::floor(s * d / 255. + 0.5)))
+        ++wrong;
+    }
+  }
+  BOOST_CHECK_EQUAL(wrong, 0);
+  BOOST_CHECK_EQUAL(blendPixel(0xff102030U, 0x80405060U, kBlendSourceOver), 0xff102030U);
+  BOOST_CHECK_EQUAL(blendPixel(0x00102030U, 0x80405060U, kBlendSourceOver), 0x80405060U);
+
+  //every code path matches the scalar pixel, any length and alignment
+  std::vector<uint32_t> background(64), row(64);
+  for (auto& p : background) {
+    p = uint32_t(rand()) << 16 ^ uint32_t(rand());
+  }
+  const BlendMode modes[] = {kBlendSourceOver, kBlendAdditive, kBlendMultiply};
+  const SimdLevel levels[] = {kSimdNone, kSimdSSE2, kSimdAVX2};
+  int mismatches = 0;
+  for (auto level : levels) {
+    selectBlendSpan(level);
+    for (auto mode : modes) {
+      for (int start = 0; start < 5; ++start) {
+        for (int count = 0; count < 40; ++count) {
+          row = background;
+          blendSpan32(&row[start], count, 0x9a5c30f0U, mode);
+          for (int i = 0; i < 64; ++i) {
+            const bool inside = i >= start && i < start + count;
+            if (row[i] != (inside ? blendPixel(0x9a5c30f0U, background[i], mode) : background[i]))
+              ++mismatches;
+          }
+        }
+      }
+    }
+  }
+  selectBlendSpan(detectSimdLevel());
+
+  for (auto mode : modes) {
+    for (unsigned mask = 0; mask < 256; mask += 7) {
+      row = background;
+      blendMaskedRow(&row[3], &background[40], 7, mask, mode);
+      for (int i = 0; i < 7; ++i) {
+        const bool selected = (mask & (1U << i)) != 0;
+        if (row[3 + i] != (selected ? blendPixel(background[40 + i], background[3 + i], mode) : background[3 + i]))
+          ++mismatches;
+      }
+    }
+  }
+  BOOST_CHECK_EQUAL(mismatches, 0);
+}
+
+BOOST_AUTO_TEST_CASE(Renderer_blend_unittest) {
+  //a blended fill is the replace fill blended pixel by pixel over the old contents
+  OffscreenRendererBuffer background(53, 41), replaced(53, 41), blended(53, 41);
+  Renderer backgroundRenderer(background), replacedRenderer(replaced), blendedRenderer(blended);
+  for (int y = 0; y < 41; ++y) {
+    backgroundRenderer.fillSpan2D(0, 52, y, 0x40000000U | uint32_t(y * 5 << 16) | uint32_t(y * 3));
+  }
+
+  const Point3<double> p0(1.5, 2.25, 0.), p1(50.75, 12.5, 0.), p2(14.25, 39.5, 0.);
+  const BlendMode modes[] = {kBlendSourceOver, kBlendAdditive, kBlendMultiply};
+  for (auto mode : modes) {
+    for (int gouraud = 0; gouraud < 2; ++gouraud) {
+      replaced.clear(0);
+      for (int y = 0; y < 41; ++y) {
+        for (int x = 0; x < 53; ++x) {
+          blended.setPixel(x, y, background.getPixel(x, y));
+        }
+      }
+
+      blendedRenderer.setBlendMode(mode);
+      if (gouraud) {
+        replacedRenderer.fillTriangle3D_Gouraud(p0, p1, p2, Color(255, 0, 0, 255), Color(0, 255, 0, 128), Color(0, 0, 255, 0));
+        blendedRenderer.fillTriangle3D_Gouraud(p0, p1, p2, Color(255, 0, 0, 255), Color(0, 255, 0, 128), Color(0, 0, 255, 0));
+      } else {
+        replacedRenderer.fillTriangle3D_Depth(p0, p1, p2, Color(200, 100, 50, 96));
+        blendedRenderer.fillTriangle3D_Depth(p0, p1, p2, Color(200, 100, 50, 96));
+      }
+      //spans take the blend as well
+      replacedRenderer.fillSpan2D(0, 52, 40, 0x80ff8000U);
+      blendedRenderer.fillSpan2D(0, 52, 40, 0x80ff8000U);
+
+      int covered = 0, wrong = 0;
+      for (int y = 0; y < 41; ++y) {
+        for (int x = 0; x < 53; ++x) {
+          const uint32_t src = replaced.getPixel(x, y);
+          const uint32_t expected = src ? blendPixel(src, background.getPixel(x, y), mode) : background.getPixel(x, y);
+          covered += src != 0;
+          if (blended.getPixel(x, y) != expected)
+            ++wrong;
+        }
+      }
+      BOOST_CHECK(covered > 500);
+      BOOST_CHECK_EQUAL(wrong, 0);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(Multisample_resolve_unittest) {
+  //every code path gives the rounded per channel average, odd width for the tails
+  MultisampleBuffer samples(37, 5);
+  srand(37);
+  for (int s = 0; s < kMultisampleCount; ++s) {
+    for (int y = 0; y < 5; ++y) {
+      for (int x = 0; x < 37; ++x) {
+        samples.getSampleBuffer(s).setPixel(x, y, uint32_t(rand()) << 16 ^ uint32_t(rand()));
+      }
+    }
+  }
+
+  OffscreenRendererBuffer target(37, 5);
+  const SimdLevel levels[] = {kSimdNone, kSimdSSE2, kSimdAVX2};
+  int wrong = 0;
+  for (auto level : levels) {
+    selectMultisampleResolve(level);
+    target.clear(0);
+    samples.resolve(target);
+    for (int y = 0; y < 5; ++y) {
+      for (int x = 0; x < 37; ++x) {
+        for (int c = 0; c < 32; c += 8) {
+          uint32_t sum = 0;
+          for (int s = 0; s < kMultisampleCount; ++s) {
+            sum += (samples.getSampleBuffer(s).getPixel(x, y) >> c) & 0xff;
+          }
+          if (((target.getPixel(x, y) >> c) & 0xff) != uint32_t(::floor(sum / 4. + 0.5)))
+            ++wrong;
+        }
+      }
+    }
+  }
+  selectMultisampleResolve(detectSimdLevel());
+  BOOST_CHECK_EQUAL(wrong, 0);
+}
+
+BOOST_AUTO_TEST_CASE(Renderer_multisample_unittest) {
+  //sample s is the single sample rasterizer with the triangle moved by minus the sample offset
+  OffscreenRendererBuffer single(40, 40), target(40, 40);
+  MultisampleBuffer samples(40, 40);
+  Renderer singleRenderer(single), renderer(target);
+  renderer.setMultisampleBuffer(&samples);
+
+  srand(41);
+  int covered = 0, wrong = 0;
+  for (int n = 0; n < 40; ++n) {
+    Point2<double> v[3];
+    for (auto& p : v) {
+      p = Point2<double>((rand() % 720) / 16., (rand() % 720) / 16.);
+    }
+
+    samples.clear(0);
+    renderer.fillTriangle2D_SubPixel(v[0], v[1], v[2], Color(0xffffffffU));
+    for (int s = 0; s < kMultisampleCount; ++s) {
+      const double ox = kSampleOffsetX[s] / 16., oy = kSampleOffsetY[s] / 16.;
+      single.clear(0);
+      singleRenderer.fillTriangle2D_SubPixel(Point2<double>(v[0].x_ - ox, v[0].y_ - oy), Point2<double>(v[1].x_ - ox, v[1].y_ - oy),
+                                             Point2<double>(v[2].x_ - ox, v[2].y_ - oy), Color(0xffffffffU));
+      for (int y = 0; y < 40; ++y) {
+        for (int x = 0; x < 40; ++x) {
+          covered += single.getPixel(x, y) != 0;
+          if (samples.getSampleBuffer(s).getPixel(x, y) != single.getPixel(x, y))
+            ++wrong;
+        }
+      }
+    }
+  }
+  BOOST_CHECK(covered > 10000);
+  BOOST_CHECK_EQUAL(wrong, 0);
+
+  //a fan shares its edges: additive, every sample inside ends up written exactly once
+  samples.clear(0);
+  renderer.setBlendMode(kBlendAdditive);
+  const Point2<double> center(19.3, 20.7);
+  const int kSegments = 11;
+  for (int i = 0; i < kSegments; ++i) {
+    const double a0 = kPI_MUL_2 * i / kSegments;
+    const double a1 = kPI_MUL_2 * (i + 1) / kSegments;
+    renderer.fillTriangle2D_SubPixel(center, Point2<double>(center.x_ + 17 * cos(a0), center.y_ + 17 * sin(a0)),
+                                     Point2<double>(center.x_ + 17 * cos(a1), center.y_ + 17 * sin(a1)), Color(0x01010101U));
+  }
+  int overdraw = 0, holes = 0;
+  for (int s = 0; s < kMultisampleCount; ++s) {
+    for (int y = 0; y < 40; ++y) {
+      for (int x = 0; x < 40; ++x) {
+        const uint32_t p = samples.getSampleBuffer(s).getPixel(x, y);
+        const double dx = x - center.x_, dy = y - center.y_;
+        overdraw += p != 0 && p != 0x01010101U;
+        holes += dx * dx + dy * dy < 15 * 15 && p == 0;
+      }
+    }
+  }
+  BOOST_CHECK_EQUAL(overdraw, 0);
+  BOOST_CHECK_EQUAL(holes, 0);
+
+  //shaded once per pixel: inside, the resolve is the single sample color, edges are mixed
+  renderer.setBlendMode(kBlendReplace);
+  samples.clear(0);
+  single.clear(0);
+  const Point3<double> p0(2.5, 3.25, 0.), p1(37.75, 9.5, 0.), p2(8.25, 36.5, 0.);
+  renderer.fillTriangle3D_Gouraud(p0, p1, p2, Color(255, 0, 0), Color(0, 255, 0), Color(0, 0, 255));
+  singleRenderer.fillTriangle3D_Gouraud(p0, p1, p2, Color(255, 0, 0), Color(0, 255, 0), Color(0, 0, 255));
+  samples.resolve(target);
+  int inside = 0, edge = 0;
+  wrong = 0;
+  for (int y = 0; y < 40; ++y) {
+    for (int x = 0; x < 40; ++x) {
+      int count = 0;
+      for (int s = 0; s < kMultisampleCount; ++s) {
+        count += samples.getSampleBuffer(s).getPixel(x, y) != 0;
+      }
+      if (count == kMultisampleCount) {
+        ++inside;
+        wrong += target.getPixel(x, y) != single.getPixel(x, y);
+      } else if (count) {
+        ++edge;
+      }
+    }
+  }
+  BOOST_CHECK(inside > 400 && edge > 40);
+  BOOST_CHECK_EQUAL(wrong, 0);
+}
+
+BOOST_AUTO_TEST_CASE(Renderer_convexPolygon_unittest) {
+  //a quad in one pass covers exactly the pixels of its two triangles
+  OffscreenRendererBuffer split(48, 48), whole(48, 48);
+  Renderer splitRenderer(split), wholeRenderer(whole);
+  const Point3<double> quad[4] = {Point3<double>(3.25, 5.5, 0.), Point3<double>(40.75, 2.125, 0.),
+                                  Point3<double>(44.5, 41.25, 0.), Point3<double>(6.0625, 37.5, 0.)};
+  splitRenderer.fillTriangle3D_Depth(quad[0], quad[1], quad[2], Color(7U));
+  splitRenderer.fillTriangle3D_Depth(quad[0], quad[2], quad[3], Color(7U));
+  wholeRenderer.fillConvexPolygon3D_Depth(quad, 4, Color(7U));
+  int wrong = 0;
+  for (int y = 0; y < 48; ++y) {
+    for (int x = 0; x < 48; ++x) {
+      wrong += split.getPixel(x, y) != whole.getPixel(x, y);
+    }
+  }
+  BOOST_CHECK(countPixels(whole, 7U) > 1000);
+  BOOST_CHECK_EQUAL(wrong, 0);
+
+  //hexagons and triangles tiling a fan share edges, additive: nothing is drawn twice
+  whole.clear(0);
+  wholeRenderer.setBlendMode(kBlendAdditive);
+  const Point2<double> center(23.7, 24.3);
+  const int kSegments = 18;
+  Point4<double> vertices[kSegments + 1];
+  vertices[kSegments] = Point4<double>(center.x_, center.y_, 0.5);
+  for (int i = 0; i < kSegments; ++i) {
+    const double a = kPI_MUL_2 * i / kSegments;
+    vertices[i] = Point4<double>(center.x_ + 20 * cos(a), center.y_ + 20 * sin(a), 0.5);
+  }
+  //slices of 3 to 8 vertices around the center, the second one in the other winding
+  const uint32_t indices[] = {18, 0, 1, 2, 3, 4, 18, 10, 9, 8, 7, 6, 5, 4, 18, 10, 11, 12, 13, 14,
+                              18, 14, 15, 16, 17, 18, 17, 0};
+  const uint8_t counts[] = {6, 8, 6, 5, 3};
+  const Color colors[] = {Color(0x01010101U), Color(0x01010101U), Color(0x01010101U), Color(0x01010101U), Color(0x01010101U)};
+  wholeRenderer.drawIndexedPolygons(vertices, kSegments + 1, indices, counts, 5, colors);
+  int overdraw = 0, holes = 0;
+  for (int y = 0; y < 48; ++y) {
+    for (int x = 0; x < 48; ++x) {
+      const double dx = x - center.x_, dy = y - center.y_;
+      overdraw += whole.getPixel(x, y) > 0x01010101U;
+      holes += dx * dx + dy * dy < 18 * 18 && whole.getPixel(x, y) == 0;
+    }
+  }
+  BOOST_CHECK_EQUAL(overdraw, 0);
+  BOOST_CHECK_EQUAL(holes, 0);
+}
+
+BOOST_AUTO_TEST_CASE(Renderer_guardBand_unittest) {
+  //vertices far past the guard band are clipped to it and still match an exact edge test
+  OffscreenRendererBuffer target(64, 48);
+  DepthBuffer depth(64, 48, kDepth32);
+  Renderer renderer(target);
+  renderer.setDepthBuffer(&depth);
+  const Point3<double> p0(-2.5e6, -1.1e6, 0.5), p1(3.1e6, 20.3, 0.5), p2(30.7, 4.3e5, 0.5);
+
+  //a nearer triangle drawn first keeps its pixels, the clipped one is depth tested too
+  renderer.fillTriangle3D_Depth(Point3<double>(10, 10, 0.9), Point3<double>(20, 10, 0.9), Point3<double>(10, 20, 0.9), Color(1U));
+  renderer.fillTriangle3D_Depth(p0, p1, p2, Color(2U));
+
+  int wrong = 0;
+  for (int y = 0; y < 48; ++y) {
+    for (int x = 0; x < 64; ++x) {
+      const auto edge = [&](const Point3<double>& a, const Point3<double>& b) {
+        return (b.x_ - a.x_) * (y - a.y_) - (b.y_ - a.y_) * (x - a.x_);
+      };
+      const bool inside = edge(p0, p1) > 0 && edge(p1, p2) > 0 && edge(p2, p0) > 0;
+      const bool near = x >= 10 && y >= 10 && x + y < 30;
+      const uint32_t expected = near ? 1U : (inside ? 2U : 0U);
+      wrong += target.getPixel(x, y) != expected;
+    }
+  }
+  BOOST_CHECK(countPixels(target, 2U) > 500);
+  BOOST_CHECK_EQUAL(wrong, 0);
+
+  //off one side of the scissor, even past the band: nothing drawn
+  target.clear(0);
+  renderer.fillTriangle3D_Depth(Point3<double>(-5e6, 0, 1.), Point3<double>(-1, 30, 1.), Point3<double>(-2, -4e6, 1.), Color(3U));
+  renderer.fillTriangle2D_SubPixel(Point2<double>(70, 0), Point2<double>(9e6, 30), Point2<double>(80, 9e6), Color(3U));
+  BOOST_CHECK_EQUAL(countPixels(target, 0U), 64 * 48);
+
+  //Gouraud attributes survive the clip, the colors follow the unclipped plane
+  target.clear(0);
+  depth.clear();
+  const Point3<double> g0(-4e5, -4e5, 0.5), g1(4e5, -4e5, 0.5), g2(0, 4e5, 0.5);
+  renderer.fillTriangle3D_Gouraud(g0, g1, g2, Color(0, 0, 0), Color(255, 0, 0), Color(0, 0, 255));
+  int off = 0;
+  for (int y = 0; y < 48; ++y) {
+    for (int x = 0; x < 64; ++x) {
+      //barycentric weights of (x, y)
+      const double w2 = (y - g0.y_) / (g2.y_ - g0.y_);
+      const double w1 = (x - g0.x_ - w2 * (g2.x_ - g0.x_)) / (g1.x_ - g0.x_);
+      const Color c(target.getPixel(x, y));
+      off += ::abs(c.getRed() - int(::floor(255 * w1 + 0.5))) > 1 || ::abs(c.getBlue() - int(::floor(255 * w2 + 0.5))) > 1;
+    }
+  }
+  BOOST_CHECK_EQUAL(off, 0);
+}
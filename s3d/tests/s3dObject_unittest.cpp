@@ -50,7 +50,7 @@ BOOST_AUTO_TEST_CASE(s3dObject_unittest) {
       BOOST_CHECK_EQUAL(res3.at(0, 3), 1);
   }
 
-  Object obj(1, "testobj");
+  ObjectFD obj(1, "testobj");
   obj.addVertex({0,4,3});
   obj.addVertex({4, -4, 3});
   obj.addVertex({-4, -4, 3});
@@ -179,4 +179,66 @@ BOOST_AUTO_TEST_CASE(s3dObject_unittest) {
   }
 
 
-}
\ No newline at end of file
+}
+BOOST_AUTO_TEST_CASE(Polygon_attr_unittest) {
+  Polygon<3> poly = {0, 1, 2};
+  BOOST_CHECK(!poly.hasAttr(kPolygonAttr2Side));
+
+  poly.setAttr(kPolygonAttr2Side);
+  poly.setAttr(kPolygonAttrShadeModeGOURAUDFlag);
+  BOOST_CHECK(poly.hasAttr(kPolygonAttr2Side));
+  BOOST_CHECK(poly.hasAttr(kPolygonAttrShadeModeGOURAUDFlag));
+  BOOST_CHECK(!poly.hasAttr(kPolygonAttrShadeModeFlatFlag));
+  BOOST_CHECK(!poly.hasAttr(kPolygonAttrShadeModePureFlag));
+}
+
+BOOST_AUTO_TEST_CASE(Object_edgeList_unittest) {
+  //unit cube, two triangles per face
+  Object cube(0, "cube");
+  for (int i = 0; i < 8; ++i) {
+    cube.addVertex(Point4<double>(i & 1, (i >> 1) & 1, (i >> 2) & 1));
+  }
+  const uint32_t faces[6][4] = {{0, 1, 3, 2}, {4, 6, 7, 5}, {0, 4, 5, 1}, {2, 3, 7, 6}, {0, 2, 6, 4}, {1, 5, 7, 3}};
+  for (const auto& f : faces) {
+    cube.addPolygon({f[0], f[1], f[2]});
+    cube.addPolygon({f[0], f[2], f[3]});
+  }
+
+  //12 cube edges plus one diagonal per face, each once
+  const std::vector<uint32_t>& edges = cube.getEdgeList();
+  BOOST_CHECK_EQUAL(edges.size(), 18U * 2);
+  for (size_t i = 0; i < edges.size(); i += 2) {
+    BOOST_CHECK(edges[i] < edges[i + 1]);
+    if (i > 0)
+      BOOST_CHECK(edges[i - 2] < edges[i] || (edges[i - 2] == edges[i] && edges[i - 1] < edges[i + 1]));
+  }
+
+  //rebuilt after the polygons change
+  cube.addPolygon({0, 7, 1});
+  BOOST_CHECK_EQUAL(cube.getEdgeList().size(), 19U * 2);
+}
+
+BOOST_AUTO_TEST_CASE(Object_mixedPolygons_unittest) {
+  //quads and triangles in one object, a Polygon<3> widens on the way in
+  Object cube(0, "cube");
+  for (int i = 0; i < 8; ++i) {
+    cube.addVertex(Point4<double>(i & 1, (i >> 1) & 1, (i >> 2) & 1));
+  }
+  cube.addPolygon({0, 1, 3, 2});
+  cube.addPolygon({4, 6, 7, 5});
+  cube.addPolygon({0, 4, 5, 1});
+  cube.addPolygon({2, 3, 7, 6});
+  cube.addPolygon({0, 2, 6, 4});
+  Polygon<3> triangle = {1, 5, 7};
+  triangle.setColor(Color(0x010203U));
+  cube.addPolygon(triangle);
+  cube.addPolygon({1, 7, 3});
+
+  BOOST_CHECK_EQUAL(cube.polygons_[0].size(), 4U);
+  BOOST_CHECK_EQUAL(cube.polygons_[5].size(), 3U);
+  BOOST_CHECK_EQUAL(cube.polygons_[5].getColor().getABGRValue(), 0x010203U);
+  BOOST_CHECK_THROW(cube.polygons_[5].at(3), std::out_of_range);
+
+  //12 cube edges and the one diagonal of the split face
+  BOOST_CHECK_EQUAL(cube.getEdgeList().size(), 13U * 2);
+}
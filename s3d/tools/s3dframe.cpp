@@ -0,0 +1,336 @@
+// s3dframe.cpp : headless frame dump driver.
+//
+// Loads a PLG model, spins it in front of a CameraUVN and renders every frame
+// into an OffscreenRendererBuffer, no window system involved. Frames are written
+// as binary PPM files and per stage timings are printed to stdout.
+//
+// usage: s3dframe model.plg [-w width] [-h height] [-n frames] [-s scale]
+//                           [-d distance] [-z 16|32] [-t threads] [-o prefix]
+//                           [-l] [-m] [-p] [-f 8888|565|8] [--no-write]
+//
+// -t draws through the tile binned renderer, 0 threads means one per core.
+// -l draws the wireframe, every shared edge once, instead of filling.
+// -m draws 4x multisampled and resolves every frame, not with -t or -z.
+// -p overlaps the geometry of each frame with the raster of the previous one
+//    on a second thread, through command buffers. not with -l.
+// -f draws into a 16-bit RGB565 or 8-bit palettized buffer and writes from there.
+//    filled frames are drawn into it directly (PLG models have flat polygons
+//    only), -l and -m frames are drawn 32-bit and converted, which counts as
+//    raster time.
+//
+// build (linux):
+//   g++ -std=c++11 -O2 -Is3d -Is3d/math s3d/tools/s3dframe.cpp s3d/Renderer.cpp
+//       s3d/OffscreenBuffer.cpp s3d/Pipeline.cpp s3d/Object.cpp s3d/Camera.cpp
+//       s3d/PLGLoader.cpp s3d/Rasterizer.cpp s3d/DepthBuffer.cpp s3d/SpanFill.cpp
+//       s3d/CpuFeatures.cpp s3d/BinnedRenderer.cpp s3d/Texture.cpp
+//       s3d/FrameTiles.cpp s3d/Blend.cpp s3d/Multisample.cpp s3d/CommandBuffer.cpp
+//       s3d/PixelFormat.cpp s3d/FramePipeline.cpp s3d/MatrixSimd.cpp
+//       -o s3dframe -lpthread
+//
+
+#include "../OffscreenBuffer.h"
+#include "../DepthBuffer.h"
+#include "../Renderer.h"
+#include "../Object.h"
+#include "../Camera.h"
+#include "../PLGLoader.h"
+#include "../Pipeline.h"
+#include "../BinnedRenderer.h"
+#include "../FrameTiles.h"
+#include "../Multisample.h"
+#include "../PixelFormat.h"
+#include "../FramePipeline.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace s3d;
+
+namespace
+{
+
+struct Options {
+  string model;
+  string prefix = "frame";
+  int width = 640;
+  int height = 480;
+  int frames = 1;
+  float scale = 1.f;
+  double distance = 100.;
+  int depthBits = 0;
+  int threads = -1;
+  bool wireframe = false;
+  bool multisample = false;
+  bool pipelined = false;
+  int formatBits = 32;
+  bool write = true;
+};
+
+void usage() {
+  cerr << "usage: s3dframe model.plg [-w width] [-h height] [-n frames] [-s scale]\n"
+          "                          [-d distance] [-z 16|32] [-t threads] [-o prefix]\n"
+          "                          [-l] [-m] [-p] [-f 8888|565|8] [--no-write]" << endl;
+}
+
+bool parseOptions(int argc, char* argv[], Options& opt) {
+  for (int i = 1; i < argc; ++i) {
+    const string arg = argv[i];
+    const bool hasValue = i + 1 < argc;
+    if (arg == "-w" && hasValue)
+      opt.width = atoi(argv[++i]);
+    else if (arg == "-h" && hasValue)
+      opt.height = atoi(argv[++i]);
+    else if (arg == "-n" && hasValue)
+      opt.frames = atoi(argv[++i]);
+    else if (arg == "-s" && hasValue)
+      opt.scale = static_cast<float>(atof(argv[++i]));
+    else if (arg == "-d" && hasValue)
+      opt.distance = atof(argv[++i]);
+    else if (arg == "-z" && hasValue)
+      opt.depthBits = atoi(argv[++i]);
+    else if (arg == "-t" && hasValue)
+      opt.threads = atoi(argv[++i]);
+    else if (arg == "-o" && hasValue)
+      opt.prefix = argv[++i];
+    else if (arg == "-l")
+      opt.wireframe = true;
+    else if (arg == "-m")
+      opt.multisample = true;
+    else if (arg == "-p")
+      opt.pipelined = true;
+    else if (arg == "-f" && hasValue) {
+      const string format = argv[++i];
+      opt.formatBits = format == "8888" ? 32 : format == "565" ? 16 : format == "8" ? 8 : 0;
+    }
+    else if (arg == "--no-write")
+      opt.write = false;
+    else if (!arg.empty() && arg[0] != '-' && opt.model.empty())
+      opt.model = arg;
+    else
+      return false;
+  }
+
+  return !opt.model.empty() && opt.width > 0 && opt.height > 0 && opt.frames > 0 &&
+         (opt.depthBits == 0 || opt.depthBits == 16 || opt.depthBits == 32) && opt.formatBits != 0 &&
+         !(opt.multisample && (opt.threads >= 0 || opt.depthBits != 0)) && !(opt.pipelined && opt.wireframe);
+}
+
+typedef chrono::high_resolution_clock Clock;
+
+double elapsedMs(Clock::time_point start) {
+  return chrono::duration<double, milli>(Clock::now() - start).count();
+}
+
+}// namespace
+
+int main(int argc, char* argv[]) {
+  Options opt;
+  if (!parseOptions(argc, argv, opt)) {
+    usage();
+    return 1;
+  }
+
+  string name;
+  VertexList<Point4<double>> vlist;
+  vector<Polygon<kMaxPolygonVertices>> polys;
+  try {
+    PLGLoader plgloader;
+    plgloader.parse(opt.model, name, vlist, polys, opt.scale);
+  } catch (const exception& e) {
+    cerr << "s3dframe: load " << opt.model << " failed: " << e.what() << endl;
+    return 1;
+  }
+
+  double radius = 0.;
+  for (auto pt : vlist) {
+    radius = max(radius, Vector4FD(pt.x_, pt.y_, pt.z_).length());
+  }
+
+  cout << "model " << name << ": " << vlist.size() << " vertices, " << polys.size()
+       << " polygons, radius " << radius << endl;
+
+  OffscreenRendererBuffer target(opt.width, opt.height);
+  FrameTiles frameTiles(target);
+  Renderer renderer(target);
+  //the resolve writes every pixel, so the lazy clear only runs without samples
+  unique_ptr<MultisampleBuffer> samples;
+  //the fills go straight to the -f buffer, the 32-bit target is not drawn
+  const bool native = opt.formatBits != 32 && !opt.wireframe && !opt.multisample;
+  if (opt.multisample) {
+    samples.reset(new MultisampleBuffer(opt.width, opt.height));
+    renderer.setMultisampleBuffer(samples.get());
+  } else if (!native) {
+    renderer.setFrameTiles(&frameTiles);
+  }
+  unique_ptr<DepthBuffer> depth;
+  if (opt.depthBits) {
+    depth.reset(new DepthBuffer(opt.width, opt.height, opt.depthBits == 16 ? kDepth16 : kDepth32));
+    renderer.setDepthBuffer(depth.get());
+  }
+
+  unique_ptr<PixelBuffer> presented;
+  if (opt.formatBits != 32)
+    presented.reset(new PixelBuffer(opt.width, opt.height, opt.formatBits == 16 ? kPixelFormatRGB565 : kPixelFormatIndexed8));
+  if (native)
+    renderer.setPixelTarget(presented.get());
+
+  unique_ptr<BinnedRenderer> binned;
+  if (opt.threads >= 0) {
+    binned.reset(new BinnedRenderer(target, opt.threads));
+    binned->setDepthBuffer(depth.get());
+    if (native)
+      binned->setPixelTarget(presented.get());
+    else
+      binned->setFrameTiles(&frameTiles);
+    cout << "binned rasterizer, " << binned->getThreadCount() << " threads" << endl;
+  }
+  CameraUVN camera({0, 0, 0}, {0, 0, 1}, 90, 10, 1000, opt.width, opt.height);
+
+  struct FrameStats {
+    unsigned polygons;
+    double geometryMs;
+    double rasterMs;
+    double writeMs;
+  };
+  vector<FrameStats> stats(opt.frames);
+
+  //clear, draw, resolve or lazy clear, present and write one frame.
+  //throws ImageWriteException
+  auto rasterFrame = [&](int frame, const function<void()>& draw) {
+    auto start = Clock::now();
+    if (native)
+      presented->clear(0);
+    else if (samples)
+      samples->clear(0);
+    else
+      frameTiles.beginFrame(0);
+    if (depth)
+      depth->clear();
+    draw();
+    const RectI whole(0, 0, opt.width - 1, opt.height - 1);
+    RectI changed = whole;
+    bool anyChanged = true;
+    if (samples)
+      samples->resolve(target);
+    else if (!native)
+      anyChanged = frameTiles.endFrame(changed);
+    //the first frame converts everything, later ones only the tiles that changed
+    if (presented && !native) {
+      if (frame == 0)
+        presented->present(target, whole);
+      else if (anyChanged)
+        presented->present(target, changed);
+    }
+    stats[frame].rasterMs = elapsedMs(start);
+
+    stats[frame].writeMs = 0.;
+    if (opt.write) {
+      ostringstream filename;
+      filename << opt.prefix << setw(4) << setfill('0') << frame << ".ppm";
+
+      start = Clock::now();
+      if (presented)
+        presented->saveToPPM(filename.str());
+      else
+        target.saveToPPM(filename.str());
+      stats[frame].writeMs = elapsedMs(start);
+    }
+  };
+
+  //-p: this thread records frame n + 1 while the pipeline thread rasterizes frame n
+  unique_ptr<FramePipeline> pipeline;
+  if (opt.pipelined) {
+    pipeline.reset(new FramePipeline([&](const CommandBuffer& commands, int frame) {
+      rasterFrame(frame, [&] {
+        if (binned) {
+          commands.execute(*binned);
+          binned->flush();
+        } else {
+          commands.execute(renderer);
+        }
+      });
+    }));
+  }
+
+  const auto runStart = Clock::now();
+  try {
+    for (int frame = 0; frame < opt.frames; ++frame) {
+      const auto start = Clock::now();
+
+      Object obj(frame, name);
+      for (auto pt : vlist) {
+        obj.addVertex(pt);
+      }
+
+      for (const auto& poly : polys) {
+        obj.addPolygon(poly);
+      }
+
+      const double angle = kPI_MUL_2 * frame / opt.frames;
+      addToWorld(obj, buildRotateMatrix4x4(0.5 * angle, angle, 0), 0, 0, opt.distance);
+      const bool visible = objectToScreen(obj, camera, radius);
+      stats[frame].polygons = static_cast<unsigned>(obj.transPolygons_.size());
+
+      if (pipeline) {
+        //the wait for a free buffer is not geometry time
+        const double transformMs = elapsedMs(start);
+        CommandBuffer& commands = pipeline->beginFrame();
+        const auto recordStart = Clock::now();
+        if (visible)
+          drawObject(commands, obj);
+        stats[frame].geometryMs = transformMs + elapsedMs(recordStart);
+        pipeline->submitFrame();
+        continue;
+      }
+
+      stats[frame].geometryMs = elapsedMs(start);
+      rasterFrame(frame, [&] {
+        if (visible && opt.wireframe) {
+          drawObjectWireframe(renderer, obj, Color(0xffffffU));
+        } else if (visible && binned) {
+          drawObject(*binned, obj);
+          binned->flush();
+        } else if (visible) {
+          drawObject(renderer, obj);
+        }
+      });
+    }
+
+    if (pipeline)
+      pipeline->finish();
+  } catch (const exception& e) {
+    cerr << "s3dframe: " << e.what() << endl;
+    return 1;
+  }
+  const double runMs = elapsedMs(runStart);
+
+  double totalGeometry = 0., totalRaster = 0., totalWrite = 0.;
+  for (int frame = 0; frame < opt.frames; ++frame) {
+    const FrameStats& frameStats = stats[frame];
+    printf("frame %4d: polygons %6u geometry %8.3f ms raster %8.3f ms write %8.3f ms\n",
+           frame, frameStats.polygons, frameStats.geometryMs, frameStats.rasterMs, frameStats.writeMs);
+
+    totalGeometry += frameStats.geometryMs;
+    totalRaster += frameStats.rasterMs;
+    totalWrite += frameStats.writeMs;
+  }
+
+  if (pipeline)
+    printf("pipelined: %.3f ms per frame wall clock (including write)\n", runMs / opt.frames);
+
+  const double frameMs = (totalGeometry + totalRaster) / opt.frames;
+  printf("average: geometry %.3f ms raster %.3f ms write %.3f ms, %.1f fps (excluding write)\n",
+         totalGeometry / opt.frames, totalRaster / opt.frames, totalWrite / opt.frames,
+         frameMs > 0. ? 1000. / frameMs : 0.);
+  return 0;
+}